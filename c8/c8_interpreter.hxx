@@ -39,6 +39,15 @@ namespace hydra::c8
             return &screen_color_data_[0];
         }
 
+        // Held keys are input and the timer follows the wall clock, neither is saved
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("CHP8", 1);
+            ar(regs_, screen_, screen_color_data_, i_, dt_, st_, stack_, mem_, pc_, sp_,
+               wait_keypress_, wait_reg_);
+        }
+
     private:
         std::array<uint8_t, 16> regs_{};
         std::array<uint64_t, 32> screen_{};
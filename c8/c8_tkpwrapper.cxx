@@ -1,5 +1,6 @@
 #include <c8/c8_tkpwrapper.hxx>
 #include <iostream>
+#include <state.hxx>
 
 namespace hydra::c8
 {
@@ -36,7 +37,19 @@ namespace hydra::c8
         inter_.reset();
     }
 
-    void Chip8_TKPWrapper::HandleKeyDown(uint32_t key)
+    bool Chip8_TKPWrapper::save_state(StateWriter& writer)
+    {
+        writer(inter_);
+        return true;
+    }
+
+    bool Chip8_TKPWrapper::load_state(StateReader& reader)
+    {
+        reader(inter_);
+        return true;
+    }
+
+    void Chip8_TKPWrapper::handle_key_down(uint32_t key)
     {
         for (int i = 0; i < 16; i++)
         {
@@ -48,7 +61,7 @@ namespace hydra::c8
         }
     }
 
-    void Chip8_TKPWrapper::HandleKeyUp(uint32_t key)
+    void Chip8_TKPWrapper::handle_key_up(uint32_t key)
     {
         for (int i = 0; i < 16; i++)
         {
@@ -14,5 +14,7 @@ namespace hydra::c8
     private:
         Interpreter inter_;
         c8Keys key_mappings_;
+        bool save_state(StateWriter& writer) override;
+        bool load_state(StateReader& reader) override;
     };
 } // namespace hydra::c8
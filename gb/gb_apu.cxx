@@ -29,6 +29,7 @@ namespace hydra::Gameboy
             // audio_sink_.reset();
             std::fill(samples_.begin(), samples_.end(), 0);
             sample_index_ = 0;
+            inner_clk_ = 0;
             return;
         }
         if (UseSound)
@@ -57,11 +58,10 @@ namespace hydra::Gameboy
         {
             if (sample_index_ < samples_.size())
             {
-                static int inner_clk = 0;
                 auto& chan1 = (*channel_array_ptr_)[0];
                 auto& chan2 = (*channel_array_ptr_)[1];
                 auto& chan4 = (*channel_array_ptr_)[3];
-                inner_clk += clk;
+                inner_clk_ += clk;
                 chan1.StepWaveGeneration(clk);
                 chan2.StepWaveGeneration(clk);
                 chan4.StepWaveGenerationCh4(clk);
@@ -71,12 +71,12 @@ namespace hydra::Gameboy
                                   chan2.GlobalVolume() * !!chan2.EnvelopeCurrentVolume;
                 double chan4out = (~chan4.LFSR & 0x01) * chan4.DACOutput * chan4.GlobalVolume() *
                                   !!chan4.EnvelopeCurrentVolume;
-                if (inner_clk >= RESAMPLED_RATE)
+                if (inner_clk_ >= RESAMPLED_RATE)
                 {
                     auto sample = (chan1out + chan2out + chan4out) / 3;
                     samples_[sample_index_++] = sample * AMPLITUDE;
                     // in case it's bigger
-                    inner_clk = inner_clk - RESAMPLED_RATE;
+                    inner_clk_ = inner_clk_ - RESAMPLED_RATE;
                 }
             }
             else
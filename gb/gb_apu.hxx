@@ -21,12 +21,22 @@ namespace hydra::Gameboy
             return samples_.empty();
         }
 
+        // Only the resampler's phase, the samples are output and not part of the state
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("GAPU", 1);
+            ar(inner_clk_);
+        }
+
         bool UseSound = false;
 
     private:
         // QAudioSink* audio_sink_;
         std::array<int16_t, 512> samples_;
         size_t sample_index_ = 0;
+        // Clocks since the last sample was taken
+        int inner_clk_ = 0;
         uint8_t& NR52_;
         ChannelArrayPtr channel_array_ptr_;
         bool init_ = false;
@@ -1393,7 +1393,7 @@ namespace hydra::Gameboy
 
     void Bus::battery_save()
     {
-        if (cartridge_.UsingBattery())
+        if (cartridge_.UsingBattery() && !curr_save_file_.empty())
         {
             std::ofstream of(curr_save_file_, std::ios::binary);
             if (cartridge_.GetRamSize() != 0)
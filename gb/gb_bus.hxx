@@ -76,6 +76,28 @@ namespace hydra::Gameboy
         uint8_t selected_rom_bank_ = 1;
         uint8_t selected_rom_bank_high_ = 0;
 
+        // The fast map points into the memories and is rebuilt, the ROM is left as loaded
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("GBUS", 1);
+            ar(BiosEnabled, BGPalettes, OBJPalettes, SoundEnabled, DIVReset, TMAChanged,
+               TIMAChanged, WriteToVram, OAMAccessible, UseCGB, CurScanlineX, selected_ram_bank_,
+               selected_rom_bank_, selected_rom_bank_high_);
+            ar(ram_enabled_, rtc_enabled_, banking_mode_, action_key_mode_, dma_transfer_,
+               dma_setup_, dma_fresh_bug_, hdma_source_, hdma_dest_, hdma_index_, hdma_size_,
+               hdma_transfer_, hdma_remaining_, use_gdma_, bg_palette_auto_increment_,
+               bg_palette_index_, obj_palette_auto_increment_, obj_palette_index_, vram_sel_bank_,
+               wram_sel_bank_, dma_index_, dma_offset_, dma_new_offset_);
+            ar(ram_banks_, hram_, eram_default_, wram_banks_, vram_banks_, oam_, bg_cram_,
+               obj_cram_);
+            if constexpr (Archive::Loading)
+            {
+                ScanlineChanges.clear();
+                fill_fast_map();
+            }
+        }
+
     private:
         bool ram_enabled_ = false;
         bool rtc_enabled_ = false;
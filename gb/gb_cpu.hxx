@@ -178,6 +178,14 @@ namespace hydra::Gameboy
         void Reset(bool skip);
         int Update();
 
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("GCPU", 1);
+            ar(A, B, C, D, E, H, L, F, PC, SP, last_instr_, ime_scheduled_, halt_bug_, tTemp,
+               tRemove, stop_, halt_, ime_, skip_next_, TClock, TotalClocks);
+        }
+
         uint8_t GetLastInstr()
         {
             return last_instr_;
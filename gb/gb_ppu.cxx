@@ -123,7 +123,10 @@ namespace hydra::Gameboy
                         clock_ += 8;
                     }
                     IF |= set_mode(MODE_HBLANK);
-                    draw_scanline();
+                    if (DrawScanlines)
+                    {
+                        draw_scanline();
+                    }
                     bus_.ScanlineChanges.clear();
                 }
             }
@@ -20,6 +20,8 @@ namespace hydra::Gameboy
         bool DrawBackground = true;
         bool DrawWindow = true;
         bool DrawSprites = true;
+        // Off for frames that are never shown, only their timing and interrupts are emulated
+        bool DrawScanlines = true;
         bool UseCGB = false;
         PPU(Bus& bus);
         void Update(uint8_t cycles);
@@ -27,6 +29,21 @@ namespace hydra::Gameboy
         uint8_t* GetScreenData();
         void FillTileset(float* pixels, size_t x_off = 0, size_t y_off = 0, uint16_t addr = 0x8000);
 
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("GPPU", 1);
+            // At most 10 sprites are picked per line, the count is saved ahead of them
+            uint8_t sprite_count = cur_scanline_sprites_.size();
+            ar(sprite_count);
+            if constexpr (Archive::Loading)
+            {
+                cur_scanline_sprites_.resize(sprite_count);
+            }
+            ar(cur_scanline_sprites_, screen_color_data_, screen_color_data_second_, ReadyToDraw,
+               UseCGB, window_internal_temp_, window_internal_, clock_, clock_target_);
+        }
+
     private:
         Bus& bus_;
         std::vector<uint8_t> screen_color_data_{};
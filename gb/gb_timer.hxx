@@ -13,6 +13,13 @@ namespace hydra::Gameboy
         void Reset();
         bool Update(uint8_t cycles, uint8_t old_if);
 
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("GTIM", 1);
+            ar(oscillator_, timer_counter_, tima_overflow_, just_overflown_);
+        }
+
     private:
         ChannelArrayPtr channel_array_ptr_;
         Bus& bus_;
@@ -5,6 +5,7 @@
 #include <filesystem>
 #include <gb/gb_tkpwrapper.hxx>
 #include <iostream>
+#include <state.hxx>
 
 namespace hydra::Gameboy
 {
@@ -80,6 +81,8 @@ namespace hydra::Gameboy
         apu_.UseSound = true;
         apu_.InitSound();
         instrs_per_frame_ = 70224;
+        // A frame is 70224 clocks of the 4 MiHz clock
+        frame_rate_ = 4194304.0 / 70224;
 
         width_ = 160;
         height_ = 144;
@@ -98,9 +101,32 @@ namespace hydra::Gameboy
         ppu_.Reset();
     }
 
+    // The audio channels are shared by the bus, timer and APU and saved once here
+    bool Gameboy_TKPWrapper::save_state(StateWriter& writer)
+    {
+        writer(bus_, timer_, ppu_, cpu_, *channel_array_ptr_, apu_);
+        return true;
+    }
+
+    bool Gameboy_TKPWrapper::load_state(StateReader& reader)
+    {
+        reader(bus_, timer_, ppu_, cpu_, *channel_array_ptr_, apu_);
+        return true;
+    }
+
     void Gameboy_TKPWrapper::update()
     {
         update_audio_sync();
+        if (ppu_.ReadyToDraw)
+        {
+            ppu_.ReadyToDraw = false;
+            end_frame();
+        }
+    }
+
+    void Gameboy_TKPWrapper::set_presenting(bool presenting)
+    {
+        ppu_.DrawScanlines = presenting;
     }
 
     void Gameboy_TKPWrapper::update_audio_sync()
@@ -131,7 +157,7 @@ namespace hydra::Gameboy
         }
     }
 
-    void Gameboy_TKPWrapper::HandleKeyDown(uint32_t key)
+    void Gameboy_TKPWrapper::handle_key_down(uint32_t key)
     {
         if (auto it_dir = std::find(direction_keys_.begin(), direction_keys_.end(), key);
             it_dir != direction_keys_.end())
@@ -149,7 +175,7 @@ namespace hydra::Gameboy
         }
     }
 
-    void Gameboy_TKPWrapper::HandleKeyUp(uint32_t key)
+    void Gameboy_TKPWrapper::handle_key_up(uint32_t key)
     {
         if (auto it_dir = std::find(direction_keys_.begin(), direction_keys_.end(), key);
             it_dir != direction_keys_.end())
@@ -168,6 +194,12 @@ namespace hydra::Gameboy
     bool Gameboy_TKPWrapper::load_file(const std::string& path)
     {
         auto loaded = bus_.LoadCartridge(path);
+        if (run_ahead_instance_)
+        {
+            // Battery RAM is written to the file when the bus is destroyed
+            bus_.curr_save_file_.clear();
+            apu_.UseSound = false;
+        }
         ppu_.UseCGB = bus_.UseCGB;
         return loaded;
     }
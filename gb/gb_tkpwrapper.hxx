@@ -62,6 +62,9 @@ namespace hydra::Gameboy
         GameboyKeys action_keys_;
         uint8_t &joypad_, &interrupt_flag_;
         inline void update_audio_sync();
+        bool save_state(StateWriter& writer) override;
+        bool load_state(StateReader& reader) override;
+        void set_presenting(bool presenting) override;
         friend class hydra::Gameboy::QA::TestGameboy;
         friend class ::MmioViewer;
     };
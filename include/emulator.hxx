@@ -2,38 +2,49 @@
 
 #include "emulator_data.hxx"
 #include "emulator_user_data.hxx"
+#include "rewind.hxx"
 #include <any>
 #include <atomic>
 #include <bitset>
+#include <chrono>
 #include <condition_variable>
 #include <fstream>
 #include <functional>
 #include <iosfwd>
+#include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <span>
+#include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 // Macro that adds the essential functions that every emulator must override
-#define TKP_EMULATOR(emulator)                 \
-                                               \
-public:                                        \
-    emulator();                                \
-    ~emulator() override;                      \
-    void* GetScreenData() override;            \
-    void HandleKeyDown(uint32_t key) override; \
-    void HandleKeyUp(uint32_t key) override;   \
-                                               \
-private:                                       \
-    void update() override;                    \
-    void reset() override;                     \
+#define TKP_EMULATOR(emulator)                   \
+                                                 \
+public:                                          \
+    emulator();                                  \
+    ~emulator() override;                        \
+    void* GetScreenData() override;              \
+                                                 \
+private:                                         \
+    void handle_key_down(uint32_t key) override; \
+    void handle_key_up(uint32_t key) override;   \
+    void update() override;                      \
+    void reset() override;                       \
     bool load_file(const std::string& path) override;
 
 namespace hydra
 {
+    class StateReader;
+    class StateWriter;
+
     class Emulator
     {
     public:
+        enum class ScreenFormat { RGBA8888, RGBA5551 };
+
         Emulator(){};
         virtual ~Emulator();
         Emulator(const Emulator&) = delete;
@@ -44,15 +55,53 @@ namespace hydra
         std::atomic_bool Step{};
         std::condition_variable StepCV{};
         std::atomic_bool Loaded{};
+        // Held to step back through the rewind history instead of running, one snapshot a frame
+        std::atomic_bool Rewinding{};
         bool SkipBoot = false;
         bool FastMode = false;
         void Start();
         void Reset();
-        virtual void HandleKeyDown(uint32_t keycode);
-        virtual void HandleKeyUp(uint32_t keycode);
-        virtual void HandleMouseMove(int x, int y);
+        // Input goes to the run-ahead instance too, so it runs ahead with the same input
+        void HandleKeyDown(uint32_t keycode);
+        void HandleKeyUp(uint32_t keycode);
+        void HandleMouseMove(int x, int y);
         bool LoadFromFile(std::string path);
         void CloseAndWait();
+        // Saves the whole emulator state into `buffer`, reusing its memory from the last save.
+        // Returns false for emulators without save states
+        bool SaveState(std::vector<uint8_t>& buffer);
+        // Returns false if the state is from another emulator, version of it or compiler, the
+        // emulator has to be reset then as it might have been partially loaded
+        bool LoadState(std::span<const uint8_t> buffer);
+        // Keeps up to `seconds` of snapshots, one every `interval` video frames, in `mebibytes`
+        // of memory. Either being 0 disables rewinding, which is the default
+        void SetRewindBudget(int seconds, int mebibytes, int interval = 2);
+        /**
+            Shows every frame `frames` video frames early, to hide that much of the game's own
+            input lag. After each frame the state is copied into `instance` which runs the frames
+            ahead with the current input and is what gets shown, its audio is muted and it
+            doesn't write to save files
+
+            @param instance a new emulator of the same type, it's loaded with the same file here
+            @return false if the instance can't be loaded, 0 frames or no instance disable it
+        */
+        bool SetRunAhead(int frames, std::shared_ptr<Emulator> instance);
+
+        // The instance whose screen is shown while running ahead, null otherwise. Holding on
+        // to it keeps it alive if running ahead is turned off meanwhile
+        std::shared_ptr<Emulator> GetRunAhead();
+
+        // Milliseconds the last frame took to emulate, running ahead included
+        double GetFrameTime() const
+        {
+            return frame_time_ms_.load(std::memory_order_relaxed);
+        }
+
+        // Milliseconds of the last frame that went into running ahead
+        double GetRunAheadTime() const
+        {
+            return run_ahead_time_ms_.load(std::memory_order_relaxed);
+        }
 
         virtual int GetWidth()
         {
@@ -66,6 +115,31 @@ namespace hydra
 
         virtual void* GetScreenData();
 
+        // Rows of the screen data that changed since the last call, as first row and count.
+        // Emulators that don't track them report the whole screen
+        virtual std::pair<int, int> TakeDirtyRows()
+        {
+            return {0, GetHeight()};
+        }
+
+        virtual ScreenFormat GetScreenFormat()
+        {
+            return ScreenFormat::RGBA8888;
+        }
+
+        // Pixels from one row of the screen data to the next
+        virtual int GetScreenRowLength()
+        {
+            return GetWidth();
+        }
+
+        // Whether TakeDirtyRows hands the frame over to the caller. GetScreenData can then be
+        // called without DataMutex, otherwise the emulator keeps drawing into it
+        virtual bool HandsOverScreenData()
+        {
+            return false;
+        }
+
         bool& IsReadyToDraw()
         {
             return should_draw_;
@@ -77,17 +151,68 @@ namespace hydra
 
     protected:
         void stop();
+        // Emulators call this when they finish a video frame. Those that don't, or don't in
+        // time, have their frames end after instrs_per_frame_ updates
+        void end_frame()
+        {
+            frame_ended_ = true;
+        }
+
         int instrs_per_frame_ = 0;
+        // Video frames a second, for budgets given in time
+        double frame_rate_ = 60;
         bool should_draw_ = false;
+        // Set on run-ahead instances before they load their file, they play frames that may
+        // never happen so they must not write saves or play audio
+        bool run_ahead_instance_ = false;
         int width_, height_;
 
     private:
         virtual void update() = 0;
+        // Called once per frame after DataMutex is released, emulators that pace themselves
+        // sleep here instead of while holding it
+        virtual void wait_for_next_frame() {}
+
+        // Frames run ahead are only shown if they're the last one, emulators can skip drawing
+        // or converting the others
+        virtual void set_presenting(bool) {}
         virtual void reset();
         virtual bool load_file(const std::string&);
-        int64_t last_frame_time_ms_;
+        virtual void handle_key_down(uint32_t keycode);
+        virtual void handle_key_up(uint32_t keycode);
+        virtual void handle_mouse_move(int x, int y);
+        // Emulators with save states serialize themselves here and return true
+        virtual bool save_state(StateWriter&)
+        {
+            return false;
+        }
+
+        virtual bool load_state(StateReader&)
+        {
+            return false;
+        }
+
+        // Loads the previous snapshot instead of running the frame while `rewinding`, saves
+        // one every rewind_interval_ frames otherwise
+        void rewind_frame(bool rewinding);
+        void run_ahead();
+        // The instance is swapped under its own lock, input and the frontend come from other
+        // threads
+        void set_run_ahead(std::shared_ptr<Emulator> instance);
+
+        RewindBuffer rewind_;
+        int rewind_interval_ = 0;
+        int rewind_frame_ = 0;
+        std::shared_ptr<Emulator> run_ahead_;
+        std::mutex run_ahead_mutex_;
+        int run_ahead_frames_ = 0;
+        std::vector<uint8_t> run_ahead_state_;
+        std::string path_;
+        std::atomic<double> frame_time_ms_ = 0;
+        std::atomic<double> run_ahead_time_ms_ = 0;
         int cur_instr_ = 0;
+        bool frame_ended_ = false;
         bool reset_flag_ = false;
-        std::chrono::system_clock::time_point frame_start_ = std::chrono::system_clock::now();
+        std::chrono::steady_clock::time_point frame_start_ = std::chrono::steady_clock::now();
     };
 } // namespace hydra
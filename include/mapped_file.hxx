@@ -0,0 +1,100 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hydra
+{
+    /**
+        A file mapped into memory. The mapping is private, writes through Data() change it but
+        never reach the file by themselves. Files opened with OpenWritable are replaced with
+        what's in memory by Sync
+
+        Sync writes a temporary file next to the file, flushes it to disk, renames it over the
+        file and flushes the directory. After a crash the file holds what it held after one Sync
+        or another, never a mix of the two, and what was written since the last Sync is lost. On
+        Windows nothing is flushed to disk, a crash of the system itself can lose the file.
+        SyncInBackground does the same with a copy on a helper thread, so the caller doesn't
+        wait for the disk
+
+        The mapping is padded with zeroes up to a multiple of the alignment passed to Open, so
+        fixed size pages that straddle the end of the file can be read in full. Writes to the
+        padding never reach the file. Pages are only read from disk when first touched
+    */
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        bool Open(const std::string& path, size_t alignment = 1);
+        // Files that don't exist yet are created `size` bytes long and filled with `fill`,
+        // shorter ones are padded to `size` with zeroes when they're synced
+        bool OpenWritable(const std::string& path, size_t size, size_t alignment = 1,
+                          uint8_t fill = 0);
+        // Replaces the file with the first Size() bytes of the mapping, does nothing for files
+        // opened with Open. Returns false if the file couldn't be replaced, it's left as it was.
+        // Waits for the helper thread first, so an older copy never lands after this one
+        bool Sync();
+        // Copies what Sync would write and hands it to the helper thread. A copy that's still
+        // waiting there is replaced by the new one
+        void SyncInBackground();
+        // Whether the last Sync or write back on the helper thread failed
+        bool SyncFailed();
+        // Doesn't sync, what wasn't synced is dropped. Waits for the copies handed to the helper
+        // thread to be written
+        void Close();
+
+        uint8_t* Data()
+        {
+            return data_;
+        }
+
+        // Size of the file
+        size_t Size() const
+        {
+            return size_;
+        }
+
+        // Size of the file padded up to the alignment
+        size_t MappedSize() const
+        {
+            return mapped_size_;
+        }
+
+    private:
+        bool open(const std::string& path, size_t alignment, size_t min_size);
+        void run();
+        void stop_thread();
+        void wait_idle(std::unique_lock<std::mutex>& lock);
+
+        uint8_t* data_ = nullptr;
+        size_t size_ = 0;
+        size_t mapped_size_ = 0;
+        // Set for files opened with OpenWritable
+        std::string path_;
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::thread thread_;
+        bool stop_ = false;
+        bool failed_ = false;
+        // A copy is waiting in staging_, or being written from writing_
+        bool pending_ = false;
+        bool writing_ = false;
+        std::string staging_path_;
+        std::vector<uint8_t> staging_;
+        std::vector<uint8_t> writing_buffer_;
+#ifdef _WIN32
+        // Read in whole instead of mapped
+        std::vector<uint8_t> contents_;
+#endif
+    };
+} // namespace hydra
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace hydra
+{
+    /**
+        History of save states to step back through
+
+        Only the newest state is kept whole. Every older one is kept as the XOR of itself and the
+        state after it, run length encoded, so the bytes that didn't change between two states
+        cost nothing. XOR goes both ways, so applying a delta to the newer state gives back the
+        older one
+
+        Deltas go in a ring buffer of fixed size, the oldest ones are dropped to make room. The
+        encoding happens on a helper thread, the emulation thread only saves into the staging
+        buffer and hands it over
+    */
+    class RewindBuffer
+    {
+    public:
+        RewindBuffer() = default;
+        RewindBuffer(const RewindBuffer&) = delete;
+        RewindBuffer& operator=(const RewindBuffer&) = delete;
+        ~RewindBuffer();
+
+        // Drops the history. 0 snapshots or bytes disable rewinding and stop the helper thread
+        void SetBudget(size_t max_snapshots, size_t bytes);
+        void Clear();
+
+        bool Enabled() const
+        {
+            return max_snapshots_ != 0;
+        }
+
+        // False while the helper thread is still going through the last state, the emulation
+        // thread skips a snapshot then instead of waiting
+        bool Idle();
+        // Buffer to save the next snapshot into, only to be touched while Idle
+        std::vector<uint8_t>& Staging()
+        {
+            return staging_;
+        }
+
+        void Push();
+        // Waits for the helper thread and returns the newest state, empty if there is none
+        std::span<const uint8_t> Newest();
+        // Drops the newest state, the one before it becomes the newest. The oldest is kept so
+        // rewinding past it stays there
+        void StepBack();
+        size_t Snapshots();
+
+        // The XOR of `previous` and `current` run length encoded into `delta`
+        static void EncodeDelta(std::span<const uint8_t> previous, std::span<const uint8_t> current,
+                                std::vector<uint8_t>& delta);
+        // Turns `state` back into the `previous` that `delta` was encoded from, returns false if
+        // the delta doesn't apply to it
+        static bool ApplyDelta(std::span<const uint8_t> delta, std::vector<uint8_t>& state);
+
+    private:
+        enum class Job { None, Push, StepBack };
+
+        struct Entry
+        {
+            size_t offset;
+            size_t size;
+        };
+
+        void run();
+        void push();
+        void step_back();
+        void start_job(Job job);
+        void wait_idle(std::unique_lock<std::mutex>& lock);
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::thread thread_;
+        Job job_ = Job::None;
+        bool stop_ = false;
+
+        size_t max_snapshots_ = 0;
+        std::vector<uint8_t> newest_;
+        std::vector<uint8_t> staging_;
+        std::vector<uint8_t> delta_;
+        // Deltas from the oldest to the newest, their bytes wrap around the ring
+        std::deque<Entry> entries_;
+        std::vector<uint8_t> ring_;
+    };
+} // namespace hydra
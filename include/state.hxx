@@ -0,0 +1,300 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <log.hxx>
+#include <span>
+#include <str_hash.hxx>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace hydra
+{
+    /**
+        Save states
+
+        Every component lists the fields that make up its state once, in a member template that
+        both archives go through:
+
+            template <class Archive>
+            void Serialize(Archive& ar)
+            {
+                ar.Section("CPU ", 1);
+                ar(pc_, regs_, memory_);
+                if constexpr (Archive::Loading)
+                {
+                    // rebuild pointers into memory_ here
+                }
+            }
+
+        Fields are copied with memcpy as they are in memory, so a state only loads on builds by
+        the same compiler for the same pointer size and byte order, which the header records.
+        Pointers are never saved, whatever they point into is rebuilt after loading. Sections
+        bump their version whenever their fields change, states from another version fail to
+        load instead of loading garbage
+    */
+    class StateWriter;
+
+    constexpr uint32_t state_build_id()
+    {
+#if defined(__VERSION__)
+        uint32_t id = str_hash(__VERSION__);
+#else
+        uint32_t id = str_hash("MSVC") ^ _MSC_FULL_VER;
+#endif
+        id = id * 33 + sizeof(void*);
+        return id * 33 + (std::endian::native == std::endian::little);
+    }
+
+    template <class T>
+    concept Serializable = requires(T& value, StateWriter& ar) { value.Serialize(ar); };
+
+    template <class T>
+    struct is_span : std::false_type
+    {
+    };
+
+    template <class T>
+    struct is_span<std::span<T>> : std::true_type
+    {
+    };
+
+    // Spans are trivially copyable too, but it's what they point to that's saved
+    template <class T>
+    concept TriviallySerializable = std::is_trivially_copyable_v<T> && !std::is_pointer_v<T> &&
+                                    !is_span<T>::value && !Serializable<T>;
+
+    // Writes a state into a buffer that's reused from one save to the next, so saving the same
+    // emulator again doesn't allocate
+    class StateWriter
+    {
+    public:
+        static constexpr bool Loading = false;
+
+        StateWriter(std::vector<uint8_t>& buffer) : buffer_(buffer)
+        {
+            Bytes(MAGIC, sizeof(MAGIC));
+            (*this)(state_build_id());
+        }
+
+        ~StateWriter()
+        {
+            buffer_.resize(offset_);
+        }
+
+        void Section(const char (&tag)[5], uint32_t version)
+        {
+            Bytes(tag, 4);
+            (*this)(version);
+        }
+
+        void Bytes(const void* data, size_t size)
+        {
+            if (offset_ + size > buffer_.size())
+            {
+                buffer_.resize(std::max(offset_ + size, buffer_.size() * 2));
+            }
+            std::memcpy(buffer_.data() + offset_, data, size);
+            offset_ += size;
+        }
+
+        template <class... T>
+        void operator()(const T&... values)
+        {
+            (write(values), ...);
+        }
+
+    private:
+        template <TriviallySerializable T>
+        void write(const T& value)
+        {
+            Bytes(&value, sizeof(T));
+        }
+
+        template <Serializable T>
+        void write(const T& value)
+        {
+            // Serialize is shared with loading so it can't be const
+            const_cast<T&>(value).Serialize(*this);
+        }
+
+        template <class T>
+        void write(const std::atomic<T>& value)
+        {
+            write(value.load());
+        }
+
+        template <class T, size_t N>
+            requires(!TriviallySerializable<std::array<T, N>>)
+        void write(const std::array<T, N>& values)
+        {
+            for (const auto& value : values)
+            {
+                write(value);
+            }
+        }
+
+        // std::pair isn't trivially copyable even when both of its members are
+        template <class T, class U>
+        void write(const std::pair<T, U>& value)
+        {
+            write(value.first);
+            write(value.second);
+        }
+
+        template <TriviallySerializable T>
+        void write(const std::vector<T>& values)
+        {
+            write(std::span<const T>(values));
+        }
+
+        template <TriviallySerializable T>
+        void write(std::span<T> values)
+        {
+            write(static_cast<uint64_t>(values.size()));
+            Bytes(values.data(), values.size_bytes());
+        }
+
+        static constexpr char MAGIC[4] = {'H', 'Y', 'S', 'T'};
+        std::vector<uint8_t>& buffer_;
+        // The buffer is only shrunk to what was written at the end
+        size_t offset_ = 0;
+    };
+
+    // Reads a state written by StateWriter. Once anything doesn't match the rest of the state
+    // is skipped and Ok returns false, fields that were already read keep their new values
+    class StateReader
+    {
+    public:
+        static constexpr bool Loading = true;
+
+        StateReader(std::span<const uint8_t> buffer) : buffer_(buffer)
+        {
+            char magic[4];
+            Bytes(magic, sizeof(magic));
+            uint32_t build_id = 0;
+            (*this)(build_id);
+            if (ok_ && std::memcmp(magic, "HYST", 4) != 0)
+            {
+                fail("Not a save state");
+            }
+            else if (ok_ && build_id != state_build_id())
+            {
+                fail("Save state is from a build by another compiler or for another platform");
+            }
+        }
+
+        bool Ok() const
+        {
+            return ok_ && offset_ == buffer_.size();
+        }
+
+        void Section(const char (&tag)[5], uint32_t version)
+        {
+            char saved_tag[4];
+            uint32_t saved_version = 0;
+            Bytes(saved_tag, 4);
+            (*this)(saved_version);
+            if (ok_ && (std::memcmp(saved_tag, tag, 4) != 0 || saved_version != version))
+            {
+                fail("Save state section {} version {} doesn't match {} version {}",
+                     std::string_view(saved_tag, 4), saved_version, tag, version);
+            }
+        }
+
+        void Bytes(void* data, size_t size)
+        {
+            if (!ok_ || offset_ + size > buffer_.size())
+            {
+                fail("Save state is truncated");
+                return;
+            }
+            std::memcpy(data, buffer_.data() + offset_, size);
+            offset_ += size;
+        }
+
+        // Also takes spans by value, they are read into
+        template <class... T>
+        void operator()(T&&... values)
+        {
+            (read(values), ...);
+        }
+
+    private:
+        template <TriviallySerializable T>
+        void read(T& value)
+        {
+            Bytes(&value, sizeof(T));
+        }
+
+        template <Serializable T>
+        void read(T& value)
+        {
+            value.Serialize(*this);
+        }
+
+        template <class T>
+        void read(std::atomic<T>& value)
+        {
+            T loaded = value.load();
+            read(loaded);
+            value.store(loaded);
+        }
+
+        template <class T, size_t N>
+            requires(!TriviallySerializable<std::array<T, N>>)
+        void read(std::array<T, N>& values)
+        {
+            for (auto& value : values)
+            {
+                read(value);
+            }
+        }
+
+        template <class T, class U>
+        void read(std::pair<T, U>& value)
+        {
+            read(value.first);
+            read(value.second);
+        }
+
+        template <TriviallySerializable T>
+        void read(std::vector<T>& values)
+        {
+            read(std::span<T>(values));
+        }
+
+        // Memories keep their size, a state with a different one is from another configuration
+        template <TriviallySerializable T>
+        void read(std::span<T> values)
+        {
+            uint64_t size = 0;
+            read(size);
+            if (ok_ && size != values.size())
+            {
+                fail("Save state has {} elements where {} are expected", size, values.size());
+                return;
+            }
+            Bytes(values.data(), values.size_bytes());
+        }
+
+        template <typename... T>
+        void fail(fmt::format_string<T...> fmt, T&&... args)
+        {
+            if (ok_)
+            {
+                Logger::Warn(fmt, std::forward<T>(args)...);
+            }
+            ok_ = false;
+        }
+
+        std::span<const uint8_t> buffer_;
+        size_t offset_ = 0;
+        bool ok_ = true;
+    };
+} // namespace hydra
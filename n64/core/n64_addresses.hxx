@@ -113,6 +113,10 @@ addr RDRAM_REGISTERS_END = 0x03F7'FFFF;
 addr RDRAM_BROADCAST_START = 0x03F8'0000;
 addr RDRAM_BROADCAST_END = 0x03FF'FFFF;
 
+// Cartridge ROM
+addr CART_ROM_START = 0x1000'0000;
+addr CART_ROM_END = 0x1FBF'FFFF;
+
 // ISVIEWER
 addr ISVIEWER_FLUSH = 0x13FF'0014;
 addr ISVIEWER_AREA_START = 0x13FF'0020;
@@ -125,5 +129,7 @@ addr N64DD_AREA_END = 0x05FF'FFFF;
 // SRAM
 addr SRAM_AREA_START = 0x0800'0000;
 addr SRAM_AREA_END = 0x0FFF'FFFF;
+// FlashRAM takes the place of SRAM. Its status is read at the start of the area, commands go here
+addr FLASHRAM_COMMAND = 0x0801'0000;
 
 #undef addr
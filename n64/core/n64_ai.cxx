@@ -11,64 +11,61 @@ namespace hydra::N64
     void hungry_for_more(ma_device* device, void* out, const void*, ma_uint32 frames)
     {
         auto& ai = *static_cast<Ai*>(device->pUserData);
-        if (ai.ai_frequency_ == 0)
+        uint32_t frequency = ai.ai_frequency_.load(std::memory_order_relaxed);
+        if (frequency == 0)
         {
             return;
         }
-        // frame: 2 channels * 2 bytes per sample
-        auto bytes_per_frame =
-            ma_get_bytes_per_frame(device->playback.format, device->playback.channels);
-        ma_resampler_config config = ma_resampler_config_init(ma_format_s16, 2,
-                                                              ai.ai_frequency_, // sample rate in
-                                                              HOST_SAMPLE_RATE, // sample rate out
-                                                              ma_resample_algorithm_linear);
-        ma_resampler resampler;
-
-        struct Deleter
-        {
-            Deleter(ma_resampler& resampler) : resampler_(resampler){};
-
-            ~Deleter()
-            {
-                ma_resampler_uninit(&resampler_, nullptr);
-            };
-
-        private:
-            ma_resampler& resampler_;
-        } deleter(resampler);
-
-        if (ma_result res = ma_resampler_init(&config, nullptr, &resampler))
+        // Dynamic rate control, the ring is drained up to MAX_RATE_ADJUSTMENT faster or slower
+        // depending on how far it is from the target latency. Whatever paces the emulator, the
+        // latency then stays bounded without underruns or stalls
+        size_t available = ai.ai_buffer_.Size();
+        double target = frequency * TARGET_LATENCY_MS / 1000.0;
+        double error = std::clamp((available - target) / target, -1.0, 1.0);
+        uint32_t rate = frequency * (1.0 + error * MAX_RATE_ADJUSTMENT);
+        if (rate != ai.resampler_rate_)
         {
-            Logger::Fatal("Failed to create resampler: {}", static_cast<int>(res));
+            // Only changes the ratio, the resampler keeps its filter state and doesn't allocate
+            ma_resampler_set_rate(&ai.resampler_, rate, HOST_SAMPLE_RATE);
+            ai.resampler_rate_ = rate;
         }
-        ma_uint64 frames_in = static_cast<float>(frames * ai.ai_frequency_) / HOST_SAMPLE_RATE;
-        if (ai.ai_buffer_.size() * sizeof(int16_t) < frames_in * bytes_per_frame * 3)
+        // The readable frames might wrap around the end of the ring, in which case they are
+        // resampled in two parts. On an underrun the rest of the output stays silent
+        int16_t* output = static_cast<int16_t*>(out);
+        ma_uint64 frames_left = frames;
+        while (frames_left != 0 && available != 0)
         {
-            ai.hungry_ = true;
-            if (ai.ai_buffer_.size() * sizeof(int16_t) < frames_in * bytes_per_frame)
+            size_t contiguous = available;
+            const int16_t* input = ai.ai_buffer_.Peek(contiguous);
+            ma_uint64 consumed = contiguous;
+            ma_uint64 produced = frames_left;
+            ma_result result = ma_resampler_process_pcm_frames(&ai.resampler_, input, &consumed,
+                                                               output, &produced);
+            if (result != MA_SUCCESS)
             {
-                return;
+                Logger::Fatal("Failed to resample: {}", static_cast<int>(result));
             }
+            if (consumed == 0 && produced == 0)
+            {
+                break;
+            }
+            ai.ai_buffer_.Pop(consumed);
+            available -= consumed;
+            output += produced * 2;
+            frames_left -= produced;
         }
-        else
-        {
-            ai.hungry_ = false;
-        }
-        ma_uint64 frames_out = frames;
-        std::vector<int16_t> buffer;
-        buffer.resize(frames_out * 2);
-        ma_result result = ma_resampler_process_pcm_frames(&resampler, ai.ai_buffer_.data(),
-                                                           &frames_in, buffer.data(), &frames_out);
-        if (result != MA_SUCCESS)
-        {
-            Logger::Fatal("Failed to resample: {}", static_cast<int>(result));
-        }
-        std::memcpy(out, buffer.data(), frames_out * 2 * 2);
-        ai.ai_buffer_.erase(ai.ai_buffer_.begin(), ai.ai_buffer_.begin() + frames_in * 2);
     }
 
     Ai::Ai()
     {
+        ma_resampler_config resampler_config =
+            ma_resampler_config_init(ma_format_s16, 2, resampler_rate_, HOST_SAMPLE_RATE,
+                                     ma_resample_algorithm_linear);
+        if (ma_result res = ma_resampler_init(&resampler_config, nullptr, &resampler_))
+        {
+            Logger::Fatal("Failed to create resampler: {}", static_cast<int>(res));
+        }
+
         ma_device_config config = ma_device_config_init(ma_device_type_playback);
         config.playback.format = ma_format_s16;
         config.playback.channels = 2;
@@ -86,6 +83,7 @@ namespace hydra::N64
     Ai::~Ai()
     {
         ma_device_uninit(&ai_device_);
+        ma_resampler_uninit(&resampler_, nullptr);
     }
 
     void Ai::Reset()
@@ -93,6 +91,19 @@ namespace hydra::N64
         ai_dma_count_ = 0;
     }
 
+    void Ai::SetMuted(bool muted)
+    {
+        muted_ = muted;
+        if (muted_)
+        {
+            ma_device_stop(&ai_device_);
+        }
+        else if (ai_enabled_)
+        {
+            ma_device_start(&ai_device_);
+        }
+    }
+
     void Ai::WriteWord(uint32_t addr, uint32_t data)
     {
         switch (addr)
@@ -124,7 +135,7 @@ namespace hydra::N64
             case AI_CONTROL:
             {
                 ai_enabled_ = data & 1;
-                if (ai_enabled_)
+                if (ai_enabled_ && !muted_)
                 {
                     ma_device_start(&ai_device_);
                 }
@@ -137,9 +148,10 @@ namespace hydra::N64
             case AI_DACRATE:
             {
                 uint32_t dac_rate = data & 0b11111111111111;
-                ai_frequency_ = std::max(1u, 93'750'000 / 2 / (dac_rate + 1)) * 1.037;
-                Logger::Warn("New sample rate: {}Hz", ai_frequency_);
-                ai_period_ = 93'750'000 / ai_frequency_;
+                uint32_t frequency = std::max(1u, 93'750'000 / 2 / (dac_rate + 1)) * 1.037;
+                Logger::Warn("New sample rate: {}Hz", frequency);
+                ai_period_ = 93'750'000 / frequency;
+                ai_frequency_.store(frequency, std::memory_order_relaxed);
                 break;
             }
             case AI_BITRATE:
@@ -181,6 +193,16 @@ namespace hydra::N64
         }
     }
 
+    double Ai::GetExcessLatency() const
+    {
+        uint32_t frequency = ai_frequency_.load(std::memory_order_relaxed);
+        if (frequency == 0)
+        {
+            return 0;
+        }
+        return static_cast<double>(ai_buffer_.Size()) / frequency - TARGET_LATENCY_MS / 1000.0;
+    }
+
     void Ai::Step()
     {
         ai_cycles_++;
@@ -196,11 +218,10 @@ namespace hydra::N64
             uint32_t data = *reinterpret_cast<uint32_t*>(rdram_ptr_ + address);
             int16_t left = (static_cast<int16_t>(data >> 16));
             int16_t right = (static_cast<int16_t>(data & 0xffff));
-            ai_buffer_.push_back(bswap16(left));
-            ai_buffer_.push_back(bswap16(right));
-            if (ai_buffer_.size() > 200000)
+            // The ring only fills up when running unthrottled, those frames are dropped
+            if (!muted_)
             {
-                Logger::Fatal("AI buffer overflow");
+                ai_buffer_.Push(bswap16(left), bswap16(right));
             }
             ai_dma_addresses_[0] += 4;
             ai_dma_lengths_[0] -= 4;
@@ -1,12 +1,13 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <cstring>
 #include <log.hxx>
 #include <miniaudio.h>
+#include <n64/core/n64_sample_ring.hxx>
 #include <n64/core/n64_types.hxx>
-#include <vector>
 
 namespace hydra::N64
 {
@@ -16,6 +17,10 @@ namespace hydra::N64
     void hungry_for_more(ma_device*, void*, const void*, ma_uint32);
 
     constexpr uint32_t HOST_SAMPLE_RATE = 48000;
+    // How much audio the ring should hold, dynamic rate control keeps it around this much
+    constexpr uint32_t TARGET_LATENCY_MS = 64;
+    // The most dynamic rate control speeds up or slows down playback by
+    constexpr double MAX_RATE_ADJUSTMENT = 0.005;
 
     class Ai
     {
@@ -38,20 +43,36 @@ namespace hydra::N64
         uint32_t ReadWord(uint32_t addr);
         void WriteWord(uint32_t addr, uint32_t data);
 
-        bool IsHungry() const
+        bool IsPlaying() const
         {
-            return hungry_;
+            return ai_enabled_ && ai_frequency_.load(std::memory_order_relaxed) != 0;
+        }
+
+        // Seconds of audio queued beyond TARGET_LATENCY_MS, negative when there is less
+        double GetExcessLatency() const;
+
+        // Samples are still timed and DMAs still interrupt, they just aren't played
+        void SetMuted(bool muted);
+
+        // Samples already queued for the host keep playing
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("N_AI", 1);
+            ar(ai_control_, ai_bitrate_, ai_frequency_, ai_period_, ai_enabled_, ai_dma_count_,
+               ai_cycles_, ai_dma_addresses_, ai_dma_lengths_);
         }
 
     private:
         uint32_t ai_control_ = 0;
         uint32_t ai_bitrate_ = 0;
-        uint32_t ai_frequency_ = 0;
+        // Also read by the audio callback
+        std::atomic<uint32_t> ai_frequency_ = 0;
         uint32_t ai_period_ = 93750000 / 44100;
         bool ai_enabled_ = false;
+        bool muted_ = false;
         uint8_t ai_dma_count_ = 0;
         uint32_t ai_cycles_ = 0;
-        bool hungry_ = true;
 
         std::array<uint32_t, 2> ai_dma_addresses_{};
         std::array<uint32_t, 2> ai_dma_lengths_{};
@@ -60,7 +81,11 @@ namespace hydra::N64
 
         ma_device ai_device_{};
         MIInterrupt* mi_interrupt_ = nullptr;
-        std::vector<int16_t> ai_buffer_{};
+        // 2^17 frames, a bit under 3 seconds at the highest sample rates
+        SampleRing ai_buffer_{1 << 17};
+        // Only touched by the audio callback after construction
+        ma_resampler resampler_{};
+        uint32_t resampler_rate_ = HOST_SAMPLE_RATE;
 
         friend class hydra::N64::RCP;
         friend class hydra::N64::CPU;
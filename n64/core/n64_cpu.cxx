@@ -1,4 +1,5 @@
 #include "n64/core/n64_addresses.hxx"
+#include <algorithm>
 #include <bitset>
 #include <cassert>
 #include <cmath>
@@ -88,9 +89,28 @@ namespace hydra::N64
             }
             case PI_RD_LEN:
             {
-                // std::memcpy(&cpubus_.rdram_[hydra::bswap32(cpubus_.pi_cart_addr_)],
-                // cpubus_.redirect_paddress(hydra::bswap32(cpubus_.pi_dram_addr_)), data + 1);
-                Logger::Warn("PI_RD_LEN write");
+                auto cart_addr = cpubus_.pi_cart_addr_ & 0xFFFFFFFE;
+                auto dram_addr = cpubus_.pi_dram_addr_ & 0x007FFFFE;
+                uint64_t length = (data & 0x00FFFFFF) + 1;
+                uint8_t* sram = cpubus_.redirect_paddress(cart_addr);
+                if (sram && cart_addr >= SRAM_AREA_START && cart_addr <= SRAM_AREA_END)
+                {
+                    // SRAM is a single page, games never write past it
+                    size_t offset = cart_addr & 0xFFFF;
+                    length = std::min<uint64_t>({length, 0x10000 - offset,
+                                                 cpubus_.rdram_.size() - dram_addr});
+                    std::memcpy(sram, &cpubus_.rdram_[dram_addr], length);
+                    cpubus_.save_written_ = true;
+                }
+                else if (cpubus_.save_type() == SaveType::FlashRam &&
+                         cart_addr >= SRAM_AREA_START && cart_addr <= SRAM_AREA_END)
+                {
+                    cpubus_.flash_dma_write(dram_addr, length);
+                }
+                else
+                {
+                    Logger::WarnOnce("PI_RD_LEN write to {:08x}", cart_addr);
+                }
                 cpubus_.mi_interrupt_.PI = true;
                 return;
             }
@@ -99,15 +119,18 @@ namespace hydra::N64
                 auto cart_addr = cpubus_.pi_cart_addr_ & 0xFFFFFFFE;
                 auto dram_addr = cpubus_.pi_dram_addr_ & 0x007FFFFE;
                 uint64_t length = data + 1;
-                if (cart_addr >= 0x8000000 && cart_addr < 0x10000000)
+                // The cartridge is only contiguous up to the end of the ROM, past it every page
+                // is the zero page. Unmapped SRAM pages read as zeroes the same way
+                if (cpubus_.save_type() == SaveType::FlashRam && cart_addr >= SRAM_AREA_START &&
+                    cart_addr <= SRAM_AREA_END)
                 {
-                    Logger::Warn("DMA to SRAM is unimplemented!");
-                    cpubus_.dma_busy_ = false;
-                    cpubus_.mi_interrupt_.PI = true;
-                    return;
+                    cpubus_.flash_dma_read(dram_addr, cart_addr, length);
                 }
-                std::memcpy(&cpubus_.rdram_[dram_addr], cpubus_.redirect_paddress(cart_addr),
-                            length);
+                else
+                {
+                    cpubus_.copy_paddresses(&cpubus_.rdram_[dram_addr], cart_addr, length);
+                }
+                rcp_.dirty_map_.Mark(dram_addr, length);
                 cpubus_.dma_busy_ = true;
                 // uint8_t domain = 0;
                 // if ((cart_addr >= 0x0800'0000 && cart_addr < 0x1000'0000) ||
@@ -215,6 +238,7 @@ namespace hydra::N64
                 pif_command();
                 std::memcpy(&cpubus_.rdram_[cpubus_.si_dram_addr_ & 0xff'ffff],
                             cpubus_.pif_ram_.data(), 64);
+                rcp_.dirty_map_.Mark(cpubus_.si_dram_addr_ & 0xff'ffff, 64);
                 cpubus_.mi_interrupt_.SI = true;
                 Logger::Debug("Raising SI interrupt");
                 return;
@@ -296,6 +320,10 @@ namespace hydra::N64
                 cpubus_.isviewer_buffer_[addr - ISVIEWER_AREA_START + i] = data >> (i * 8);
             }
         }
+        else if (addr == FLASHRAM_COMMAND && cpubus_.save_type() == SaveType::FlashRam)
+        {
+            cpubus_.flash_command(data);
+        }
         else if (addr >= RI_AREA_START && addr <= RI_AREA_END)
         {
             Logger::Warn("Write to RI register {:x} with data {:x}", addr, data);
@@ -437,9 +465,15 @@ namespace hydra::N64
             Logger::Warn("Accessing N64DD");
             return 0;
         }
+        else if (addr >= SRAM_AREA_START && addr <= SRAM_AREA_END &&
+                 cpubus_.save_type() == SaveType::FlashRam)
+        {
+            return cpubus_.flash_read_status();
+        }
         else if (addr >= SRAM_AREA_START && addr <= SRAM_AREA_END)
         {
-            Logger::Warn("Accessing SRAM");
+            // Mapped SRAM is read through the page table, there is no save to read here
+            Logger::WarnOnce("Accessing SRAM without a save");
             return 0;
         }
         Logger::Warn("Unhandled read_hwio from address {:08x} PC: {:08x}", addr, pc_);
@@ -462,48 +496,33 @@ namespace hydra::N64
         auto command_byte = cpubus_.pif_ram_[63];
         if (command_byte & 0x1)
         {
-            pif_channel_ = 0;
-            int i = 0;
-            while (i < 63)
+            // Games send the same block every time they poll, it's only parsed when it changes
+            auto& pif_ram = cpubus_.pif_ram_;
+            bool same_block = pif_layout_valid_;
+            for (int i = 0; i < 64; i++)
             {
-                int8_t tx = cpubus_.pif_ram_[i++];
-                if (tx > 0)
-                {
-                    uint8_t* rx_ptr = &cpubus_.pif_ram_[i++];
-                    if (*rx_ptr == 0xFE)
-                    {
-                        break;
-                    }
-                    uint8_t rx = *rx_ptr & 0x3F;
-                    std::vector<uint8_t> data;
-                    // get tx next bytes and send to pif chip
-                    data.resize(tx);
-                    for (int8_t j = 0; j < tx; j++)
-                    {
-                        data[j] = cpubus_.pif_ram_[i++];
-                    }
-                    // get response bytes
-                    std::vector<uint8_t> response;
-                    response.resize(rx);
-                    if (joybus_command(data, response))
-                    {
-                        // Device not found
-                        rx_ptr[0] |= 0x80;
-                    }
-                    for (size_t j = 0; j < response.size(); j++)
-                    {
-                        cpubus_.pif_ram_[i++] = response[j];
-                    }
-                    pif_channel_++;
-                }
-                else if (tx == 0)
+                same_block &= (pif_ram[i] & pif_layout_mask_[i]) == pif_layout_[i];
+            }
+            // 0xFE ends the block, the one rx byte value the error bits hide from the layout
+            for (int t = 0; t < pif_transfer_count_; t++)
+            {
+                same_block &= pif_ram[pif_transfers_[t].offset] != 0xFE;
+            }
+            if (!same_block)
+            {
+                parse_pif_command_block();
+            }
+            for (int t = 0; t < pif_transfer_count_; t++)
+            {
+                const JoybusTransfer& transfer = pif_transfers_[t];
+                uint8_t* rx_ptr = &pif_ram[transfer.offset];
+                pif_channel_ = transfer.channel;
+                std::span<const uint8_t> command(rx_ptr + 1, transfer.tx);
+                std::span<uint8_t> response(rx_ptr + 1 + transfer.tx, transfer.rx);
+                if (joybus_command(command, response))
                 {
-                    pif_channel_++;
-                    continue;
-                }
-                else if (static_cast<uint8_t>(tx) == 0xFE)
-                {
-                    break;
+                    // Device not found
+                    rx_ptr[0] |= 0x80;
                 }
             }
         }
@@ -527,7 +546,54 @@ namespace hydra::N64
         cpubus_.pif_ram_[63] = command_byte;
     }
 
-    bool CPU::joybus_command(const std::vector<uint8_t>& command, std::vector<uint8_t>& result)
+    void CPU::parse_pif_command_block()
+    {
+        const auto& pif_ram = cpubus_.pif_ram_;
+        pif_transfer_count_ = 0;
+        pif_layout_mask_.fill(0);
+        uint8_t channel = 0;
+        int i = 0;
+        while (i < 63)
+        {
+            pif_layout_mask_[i] = 0xFF;
+            int8_t tx = pif_ram[i++];
+            if (tx > 0)
+            {
+                uint8_t offset = i++;
+                if (pif_ram[offset] == 0xFE)
+                {
+                    pif_layout_mask_[offset] = 0xFF;
+                    break;
+                }
+                // The top bits are the error bits set for the previous command
+                pif_layout_mask_[offset] = 0x3F;
+                uint8_t rx = pif_ram[offset] & 0x3F;
+                if (offset + 1 + tx + rx > 63)
+                {
+                    Logger::WarnOnce("Joybus transfer past the end of the PIF RAM");
+                    break;
+                }
+                std::fill_n(&pif_layout_mask_[i], tx, 0xFF);
+                pif_transfers_[pif_transfer_count_++] = {channel++, offset, uint8_t(tx), rx};
+                i += tx + rx;
+            }
+            else if (tx == 0)
+            {
+                channel++;
+            }
+            else if (static_cast<uint8_t>(tx) == 0xFE)
+            {
+                break;
+            }
+        }
+        for (int j = 0; j < 64; j++)
+        {
+            pif_layout_[j] = pif_ram[j] & pif_layout_mask_[j];
+        }
+        pif_layout_valid_ = true;
+    }
+
+    bool CPU::joybus_command(std::span<const uint8_t> command, std::span<uint8_t> result)
     {
         if (result.size() == 0)
         {
@@ -556,8 +622,13 @@ namespace hydra::N64
                     }
                     case 4:
                     {
+                        SaveType save_type = cpubus_.save_type();
+                        if (save_type != SaveType::Eeprom4K && save_type != SaveType::Eeprom16K)
+                        {
+                            return true;
+                        }
                         result[0] = 0x00;
-                        result[1] = 0x80;
+                        result[1] = save_type == SaveType::Eeprom16K ? 0xC0 : 0x80;
                         result[2] = 0x00;
                         break;
                     }
@@ -579,6 +650,37 @@ namespace hydra::N64
                 get_controller_state(result, controller_type_);
                 break;
             }
+            case JoybusCommand::ReadEEPROM:
+            case JoybusCommand::WriteEEPROM:
+            {
+                bool write = command_type == JoybusCommand::WriteEEPROM;
+                if (command.size() != (write ? 10 : 2) || result.size() != (write ? 1 : 8))
+                {
+                    Logger::Fatal("Joybus EEPROM command with command size {} result size {}",
+                                  command.size(), result.size());
+                }
+                SaveType save_type = cpubus_.save_type();
+                bool eeprom = save_type == SaveType::Eeprom4K || save_type == SaveType::Eeprom16K;
+                if (pif_channel_ != 4 || !eeprom || !cpubus_.save_.Data())
+                {
+                    return true;
+                }
+                // 0x200 or 0x800 bytes, the block number wraps around past the end
+                size_t eeprom_size = cpubus_.save_.Size();
+                // Addressed in blocks of 8 bytes, the files keep them in the same order
+                uint8_t* block = cpubus_.save_.Data() + ((command[1] * 8) & (eeprom_size - 1));
+                if (write)
+                {
+                    std::memcpy(block, &command[2], 8);
+                    cpubus_.save_written_ = true;
+                    result[0] = 0x00;
+                }
+                else
+                {
+                    std::memcpy(result.data(), block, 8);
+                }
+                break;
+            }
             case JoybusCommand::WriteMempack:
             {
                 if (result.size() != 1)
@@ -597,7 +699,7 @@ namespace hydra::N64
         return false;
     }
 
-    void CPU::get_controller_state(std::vector<uint8_t>& result, ControllerType controller)
+    void CPU::get_controller_state(std::span<uint8_t> result, ControllerType controller)
     {
         switch (controller)
         {
@@ -657,6 +759,9 @@ namespace hydra::N64
         rcp_.vi_.SetMIPtr(&cpubus_.mi_interrupt_);
         rcp_.rsp_.SetMIPtr(&cpubus_.mi_interrupt_);
         rcp_.rdp_.SetMIPtr(&cpubus_.mi_interrupt_);
+        rcp_.vi_.SetDirtyMap(&rcp_.dirty_map_);
+        rcp_.rsp_.SetDirtyMap(&rcp_.dirty_map_);
+        rcp_.rdp_.SetDirtyMap(&rcp_.dirty_map_);
     }
 
     void CPU::Reset()
@@ -696,6 +801,88 @@ namespace hydra::N64
             0x800000); // TODO: probably done by pif somewhere if RI_SELECT is emulated or something
     }
 
+    void CPU::BootHLE()
+    {
+        uint8_t header[0x40];
+        cpubus_.copy_paddresses(header, 0x1000'0000, sizeof(header));
+
+        // The PIF ROM copies the header and IPL3 to DMEM and hands IPL3 the console's
+        // configuration in s3-s7. Games set their own state up from the entry point, these are
+        // kept for the ones that look
+        cpubus_.copy_paddresses(&rcp_.rsp_.mem_[0], 0x1000'0000, 0x1000);
+        uint8_t seed = cpubus_.pif_ram_[0x26];
+        uint32_t tv_type;
+        switch (header[0x3E])
+        {
+            case 'D':
+            case 'F':
+            case 'I':
+            case 'P':
+            case 'S':
+            case 'U':
+            case 'X':
+            case 'Y':
+                tv_type = 0; // PAL
+                break;
+            case 'B':
+                tv_type = 2; // MPAL
+                break;
+            default:
+                tv_type = 1; // NTSC
+                break;
+        }
+        gpr_regs_[11].UD = 0xFFFF'FFFF'A400'0040;
+        gpr_regs_[19].UD = 0;
+        gpr_regs_[20].UD = tv_type;
+        gpr_regs_[21].UD = 0;
+        gpr_regs_[22].UD = seed;
+        gpr_regs_[23].UD = 0;
+        gpr_regs_[29].UD = 0xFFFF'FFFF'A400'1FF0;
+        cp0_regs_[CP0_RANDOM].UD = 0x1F;
+
+        // IPL3 sets the cartridge timings from the first word of the header
+        cpubus_.pi_bsd_dom1_lat_ = header[3];
+        cpubus_.pi_bsd_dom1_pwd_ = header[2];
+        cpubus_.pi_bsd_dom1_pgs_ = header[1] & 0xF;
+        cpubus_.pi_bsd_dom1_rls_ = (header[1] >> 4) & 0b11;
+
+        // then copies the first MiB of the game to the entry point, which the IPL3 of CIC-6103
+        // and CIC-6106 move down
+        uint32_t entry = header[8] << 24 | header[9] << 16 | header[10] << 8 | header[11];
+        if (seed == 0x78)
+        {
+            entry -= 0x100000;
+        }
+        else if (seed == 0x85)
+        {
+            entry -= 0x200000;
+        }
+        uint32_t dram_addr = entry & 0x7F'FFFF;
+        size_t length = std::min<size_t>(0x100000, cpubus_.rdram_.size() - dram_addr);
+        cpubus_.copy_paddresses(&cpubus_.rdram_[dram_addr], 0x1000'1000, length);
+        rcp_.dirty_map_.Mark(dram_addr, length);
+
+        // and leaves the boot variables libultra reads, osMemSize is written by Reset
+        store_word(0x8000'0300, tv_type);
+        store_word(0x8000'0308, 0xB000'0000);
+
+        // The IPL3 of CIC-6105 leaves code in IMEM that games with it run from the RSP to check
+        // the cartridge
+        if (seed == 0x91)
+        {
+            constexpr uint32_t imem[] = {0x3C0D'BFC0, 0x8DA8'07FC, 0x25AD'07C0, 0x3108'0080,
+                                         0x5500'FFFC, 0x3C0D'BFC0, 0x8DA8'0024, 0x3C0B'B000};
+            for (size_t i = 0; i < std::size(imem); i++)
+            {
+                uint32_t word = hydra::bswap32(imem[i]);
+                std::memcpy(&rcp_.rsp_.mem_[0x1000 + i * 4], &word, sizeof(word));
+            }
+        }
+
+        pc_ = static_cast<int32_t>(entry);
+        next_pc_ = pc_ + 4;
+    }
+
     // Shamelessly stolen from dillon
     // Thanks m64p
     uint32_t CPU::timing_pi_access(uint8_t domain, uint32_t length)
@@ -841,6 +1028,10 @@ namespace hydra::N64
             Logger::Warn("Attempted to store byte to invalid address: {:08x}", vaddr);
             return;
         }
+        if (!prepare_store(paddr.paddr))
+        {
+            return;
+        }
         *ptr = data;
     }
 
@@ -852,6 +1043,10 @@ namespace hydra::N64
         {
             Logger::Fatal("Attempted to store halfword to invalid address: {:08x}", vaddr);
         }
+        if (!prepare_store(paddr.paddr))
+        {
+            return;
+        }
         data = hydra::bswap16(data);
         memcpy(ptr, &data, sizeof(uint16_t));
     }
@@ -865,7 +1060,7 @@ namespace hydra::N64
         {
             write_hwio(paddr.paddr, data);
         }
-        else
+        else if (prepare_store(paddr.paddr))
         {
             data = hydra::bswap32(data);
             memcpy(ptr, &data, sizeof(uint32_t));
@@ -880,34 +1075,35 @@ namespace hydra::N64
         {
             Logger::Fatal("Attempted to store doubleword to invalid address: {:08x}", vaddr);
         }
+        if (!prepare_store(paddr.paddr))
+        {
+            return;
+        }
         data = hydra::bswap64(data);
         memcpy(ptr, &data, sizeof(uint64_t));
     }
 
     void CPU::Tick()
     {
-        if (rcp_.ai_.IsHungry())
+        ++cpubus_.time_;
+        cpubus_.time_ &= 0x1FFFFFFFF;
+        if (cpubus_.time_ == (cp0_regs_[CP0_COMPARE].UD << 1)) [[unlikely]]
         {
-            ++cpubus_.time_;
-            cpubus_.time_ &= 0x1FFFFFFFF;
-            if (cpubus_.time_ == (cp0_regs_[CP0_COMPARE].UD << 1)) [[unlikely]]
-            {
-                CP0Cause.IP7 = true;
-            }
-            gpr_regs_[0].UD = 0;
-            prev_branch_ = was_branch_;
-            was_branch_ = false;
-            instruction_.full = load_word(pc_);
-            if (check_interrupts())
-            {
-                return;
-            }
-            log_cpu_state<CPU_LOGGING>(true, 30'000'000, 0);
-            prev_pc_ = pc_;
-            pc_ = next_pc_;
-            next_pc_ += 4;
-            execute_instruction();
+            CP0Cause.IP7 = true;
+        }
+        gpr_regs_[0].UD = 0;
+        prev_branch_ = was_branch_;
+        was_branch_ = false;
+        instruction_.full = load_word(pc_);
+        if (check_interrupts())
+        {
+            return;
         }
+        log_cpu_state<CPU_LOGGING>(true, 30'000'000, 0);
+        prev_pc_ = pc_;
+        pc_ = next_pc_;
+        next_pc_ += 4;
+        execute_instruction();
     }
 
     void CPU::check_vi_interrupt()
@@ -10,12 +10,15 @@
 #include <cstdint>
 #include <limits>
 #include <log.hxx>
+#include <mapped_file.hxx>
 #include <memory>
 #include <n64/core/n64_addresses.hxx>
+#include <n64/core/n64_game_db.hxx>
 #include <n64/core/n64_keys.hxx>
 #include <n64/core/n64_rcp.hxx>
 #include <n64/core/n64_types.hxx>
 #include <queue>
+#include <span>
 #include <vector>
 
 #define KB(x) (static_cast<size_t>(x << 10))
@@ -192,9 +195,20 @@ namespace hydra::N64
     {
     public:
         CPUBus(RCP& rcp);
+        ~CPUBus();
         bool LoadCartridge(std::string path);
         bool LoadIPL(std::string path);
-
+        // Maps the battery save of the loaded cartridge, `path` gets the extension of its
+        // save type. The file is created the first time. Unless `writable`, what the game
+        // saves never reaches the file
+        bool OpenSave(const std::string& path, bool writable = true);
+        // Called once a frame, writes the save back on a helper thread once the game stopped
+        // writing to it for a whole frame. A save is usually many stores spread over a few
+        // frames
+        void SyncSave();
+        // Writes the save back now and waits for it, if the game wrote to it since it was last
+        // written back or that failed
+        void FlushSave();
         bool IsEverythingLoaded()
         {
             return rom_loaded_ && ipl_loaded_;
@@ -202,16 +216,94 @@ namespace hydra::N64
 
         void Reset();
 
+        // The cartridge itself isn't part of the state, only what the game saved on it, so the
+        // game reads back the save it had. Loading a state doesn't touch the save file: what
+        // the game saved until then is written back first, and the save from the state only
+        // reaches the file once the game saves again
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("NBUS", 2);
+            if constexpr (Archive::Loading)
+            {
+                if (save_written_ || save_pending_)
+                {
+                    write_back_save();
+                }
+                copy_shown_frame();
+            }
+            ar(rdram_, std::span(save_.Data(), save_.Size()), pif_ram_);
+            ar(mi_mode_, mi_version_, mi_interrupt_, mi_mask_);
+            ar(pi_dram_addr_, pi_cart_addr_, pi_rd_len_, pi_wr_len_, pi_status_, dma_error_,
+               io_busy_, dma_busy_, pi_bsd_dom1_lat_, pi_bsd_dom1_pwd_, pi_bsd_dom1_pgs_,
+               pi_bsd_dom1_rls_, pi_bsd_dom2_lat_, pi_bsd_dom2_pwd_, pi_bsd_dom2_pgs_,
+               pi_bsd_dom2_rls_);
+            ar(ri_mode_, ri_config_, ri_current_load_, ri_select_, ri_refresh_, ri_latency_);
+            ar(si_dram_addr_, si_pif_ad_wr64b_, si_pif_ad_rd64b_, si_status_, time_);
+            ar(flash_mode_, flash_status_, flash_offset_, flash_page_);
+            if constexpr (Archive::Loading)
+            {
+                map_direct_addresses();
+                mark_shown_frame_changes();
+            }
+        }
+
     private:
         uint8_t* redirect_paddress(uint32_t paddr);
+        // Copies `length` bytes starting at `paddr` a page at a time, unmapped pages read as
+        // zeroes
+        void copy_paddresses(uint8_t* dst, uint32_t paddr, size_t length);
         void map_direct_addresses();
+        // A loaded state changes RDRAM without marking the dirty map. The framebuffer on screen
+        // is compared with the one from the state instead, so the VI redraws only the rows
+        // that differ. Run-ahead loads a state every frame
+        void copy_shown_frame();
+        void mark_shown_frame_changes();
+
+        void map_cartridge();
+        void map_save();
+        void write_back_save();
+
+        // FlashRAM is driven through a command register, and read and written a page at a time
+        // with PI DMAs. Reads need the read mode, writes go to a page buffer that a write
+        // command then programs
+        void flash_command(uint32_t command);
+        uint32_t flash_read_status();
+        // To and from RDRAM
+        void flash_dma_read(uint32_t dram_addr, uint32_t cart_addr, size_t length);
+        void flash_dma_write(uint32_t dram_addr, size_t length);
+
+        // Games that aren't in the game database get a 4K EEPROM, the most common save type
+        SaveType save_type() const
+        {
+            return game_info_ ? game_info_->save_type : SaveType::Eeprom4K;
+        }
 
         static std::vector<uint8_t> ipl_;
-        std::vector<uint8_t> cart_rom_;
+        MappedFile cart_rom_;
+        // Entry of the game in the game database, nullptr if it isn't in it
+        const GameInfo* game_info_ = nullptr;
+        // Backs the cartridge pages past the end of the ROM, stays zeroed as stores to the
+        // cartridge ROM are dropped
+        std::vector<uint8_t> zero_page_ = std::vector<uint8_t>(0x10000);
         bool rom_loaded_ = false;
         bool ipl_loaded_ = false;
         std::vector<uint8_t> rdram_{};
-        std::vector<uint8_t> sram_{};
+        // The framebuffer on screen as it was before a state was loaded
+        std::vector<uint8_t> shown_frame_;
+        uint32_t shown_frame_address_ = 0;
+        // SRAM, FlashRAM or EEPROM of the cartridge, mapped straight from the save file
+        MappedFile save_;
+        // Set by stores to the save during the current frame, and by SyncSave until it writes
+        // them back
+        bool save_written_ = false;
+        bool save_pending_ = false;
+        enum class FlashMode : uint8_t { Read, Status, Erase, ChipErase, Write };
+        FlashMode flash_mode_ = FlashMode::Read;
+        uint64_t flash_status_ = 0;
+        // Of the sector to erase or the page to program
+        uint32_t flash_offset_ = 0;
+        std::array<uint8_t, 128> flash_page_{};
         std::array<char, ISVIEWER_AREA_END - ISVIEWER_AREA_START> isviewer_buffer_{};
         std::array<uint8_t, 64> pif_ram_{};
         std::array<uint8_t*, 0x10000> page_table_{};
@@ -278,6 +370,22 @@ namespace hydra::N64
         CPU(CPUBus& cpubus, RCP& rcp, bool& should_draw);
         void Tick();
         void Reset();
+        // Puts the console in the state the PIF ROM and IPL3 leave it in when they jump to the
+        // game, so it can start without an IPL. Called after Reset
+        void BootHLE();
+
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("NCPU", 1);
+            ar(opmode_, mode64_, gpr_regs_, fpr_regs_, cp0_regs_, tlb_, prev_pc_, pc_, next_pc_,
+               hi_, lo_, llbit_, lladdr_, fcr0_, instruction_, fcr31_, cp0_weirdness_,
+               cp2_weirdness_, prev_branch_, was_branch_, tlb_offset_mask_, pif_channel_);
+            if constexpr (Archive::Loading)
+            {
+                pif_layout_valid_ = false;
+            }
+        }
 
     private:
         using PipelineStageRet = void;
@@ -311,6 +419,24 @@ namespace hydra::N64
         bool prev_branch_ = false, was_branch_ = false;
         uint32_t tlb_offset_mask_ = 0;
         int pif_channel_ = 0;
+        // A joybus transfer in the command block of the PIF RAM
+        struct JoybusTransfer
+        {
+            uint8_t channel;
+            // Offset of the rx byte, the command and then the response follow it
+            uint8_t offset;
+            uint8_t tx;
+            uint8_t rx;
+        };
+        // Command blocks hold at most 21 transfers, the smallest one takes 3 bytes
+        std::array<JoybusTransfer, 21> pif_transfers_{};
+        int pif_transfer_count_ = 0;
+        // The bytes of the PIF RAM the transfers were parsed from, and which ones they are.
+        // Responses and error bits aren't part of it, so games sending the same block every
+        // frame keep hitting it
+        std::array<uint8_t, 64> pif_layout_{};
+        std::array<uint8_t, 64> pif_layout_mask_{};
+        bool pif_layout_valid_ = false;
         int vis_per_second_ = 0;
         ControllerType controller_type_ = ControllerType::Keyboard;
         int32_t mouse_x_, mouse_y_;
@@ -420,6 +546,25 @@ namespace hydra::N64
         void store_word(uint64_t address, uint32_t value);
         void store_doubleword(uint64_t address, uint64_t value);
 
+        // Marks what a store to a mapped address changes, the rows the VI has to redraw or the
+        // save to write back. Returns false for the cartridge ROM, which stores don't change
+        hydra_inline bool prepare_store(uint32_t paddr)
+        {
+            if (paddr < cpubus_.rdram_.size())
+            {
+                rcp_.dirty_map_.Mark(paddr);
+            }
+            else if (paddr - SRAM_AREA_START <= SRAM_AREA_END - SRAM_AREA_START)
+            {
+                cpubus_.save_written_ = true;
+            }
+            else if (paddr - CART_ROM_START <= CART_ROM_END - CART_ROM_START) [[unlikely]]
+            {
+                return false;
+            }
+            return true;
+        }
+
         bool check_interrupts();
         void handle_event();
         uint32_t timing_pi_access(uint8_t domain, uint32_t length);
@@ -464,8 +609,9 @@ namespace hydra::N64
         bool check_fpu_exception();
 
         void pif_command();
-        bool joybus_command(const std::vector<uint8_t>&, std::vector<uint8_t>&);
-        void get_controller_state(std::vector<uint8_t>& result, ControllerType controller);
+        void parse_pif_command_block();
+        bool joybus_command(std::span<const uint8_t> command, std::span<uint8_t> result);
+        void get_controller_state(std::span<uint8_t> result, ControllerType controller);
         std::array<bool, hydra::N64::Keys::N64KeyCount> key_state_{};
         std::vector<DisassemblerInstruction> disassemble(uint64_t start_vaddr, uint64_t end_vaddr,
                                                          bool register_names);
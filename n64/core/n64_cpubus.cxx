@@ -1,9 +1,13 @@
+#include <algorithm>
+#include <cstring>
 #include <fmt/format.h>
 #include <fstream>
 #include <iostream>
 #include <log.hxx>
 #include <n64/core/n64_addresses.hxx>
 #include <n64/core/n64_cpu.hxx>
+#include <n64/core/n64_game_db.hxx>
+#include <n64/core/n64_rom.hxx>
 #include <sstream>
 
 namespace hydra::N64
@@ -12,31 +16,246 @@ namespace hydra::N64
 
     CPUBus::CPUBus(RCP& rcp) : rcp_(rcp)
     {
-        cart_rom_.resize(0xFC00000);
         rdram_.resize(0x800000);
         map_direct_addresses();
     }
 
+    CPUBus::~CPUBus()
+    {
+        FlushSave();
+    }
+
     bool CPUBus::LoadCartridge(std::string path)
     {
-        std::ifstream ifs(path, std::ios::in | std::ios::binary);
-        if (ifs.is_open())
+        // Mapped in whole pages of the page table, only the parts the game reads get loaded
+        if (!cart_rom_.Open(path, 0x10000))
         {
-            ifs.unsetf(std::ios::skipws);
-            ifs.seekg(0, std::ios::end);
-            std::streampos size = ifs.tellg();
-            ifs.seekg(0, std::ios::beg);
-            ifs.read(reinterpret_cast<char*>(cart_rom_.data()), size);
-            rom_loaded_ = true;
-            Reset();
+            return false;
         }
-        else
+        // Header and IPL3
+        if (cart_rom_.Size() < 0x1000)
         {
+            Logger::Warn("ROM is too small to be a cartridge: {} bytes", cart_rom_.Size());
+            cart_rom_.Close();
             return false;
         }
+        RomFormat format = DetectRomFormat(cart_rom_.Data());
+        if (format == RomFormat::Unknown)
+        {
+            Logger::Warn("Unknown ROM byte order, loading it as .z64");
+        }
+        // .z64 images are left alone, so loading one only reads the pages the game touches
+        if (format == RomFormat::V64 || format == RomFormat::N64)
+        {
+            NormalizeRom(cart_rom_.Data(), cart_rom_.Size(), format);
+        }
+        game_info_ = FindGame(cart_rom_.Data());
+        // The save of the previous game, OpenSave maps the one of this game
+        FlushSave();
+        save_.Close();
+        if (game_info_)
+        {
+            Logger::Info("Found {} in the game database", game_info_->name);
+            if (game_info_->rdram_size > rdram_.size())
+            {
+                Logger::Warn("Game needs {} MiB of RDRAM, only {} are emulated",
+                             game_info_->rdram_size >> 20, rdram_.size() >> 20);
+            }
+        }
+        map_cartridge();
+        map_save();
+        rom_loaded_ = true;
+        Reset();
         return true;
     }
 
+    bool CPUBus::OpenSave(const std::string& path, bool writable)
+    {
+        // Read only saves need the file to exist already, with the size it's created with
+        auto open = [&](const std::string& file, size_t size, size_t alignment, uint8_t fill) {
+            return writable ? save_.OpenWritable(file, size, alignment, fill)
+                            : save_.Open(file, alignment) && save_.Size() >= size;
+        };
+        bool opened = false;
+        switch (save_type())
+        {
+            case SaveType::None:
+                return true;
+            case SaveType::Eeprom4K:
+                opened = open(path + ".eep", 0x200, 1, 0xFF);
+                break;
+            case SaveType::Eeprom16K:
+                opened = open(path + ".eep", 0x800, 1, 0xFF);
+                break;
+            case SaveType::Sram:
+                // A whole page, so the page table can point at it
+                opened = open(path + ".sra", 0x8000, 0x10000, 0);
+                break;
+            case SaveType::FlashRam:
+                opened = open(path + ".fla", 0x20000, 1, 0xFF);
+                break;
+        }
+        if (!opened)
+        {
+            Logger::Warn("Couldn't open save file {}", path);
+            return false;
+        }
+        map_save();
+        return true;
+    }
+
+    void CPUBus::SyncSave()
+    {
+        if (save_written_)
+        {
+            save_written_ = false;
+            save_pending_ = true;
+        }
+        else if (save_pending_)
+        {
+            write_back_save();
+        }
+        else if (save_.SyncFailed())
+        {
+            Logger::WarnOnce("Couldn't write the save file back, retrying every frame");
+            write_back_save();
+        }
+    }
+
+    void CPUBus::write_back_save()
+    {
+        // The helper thread writes a copy, the game goes on with the save meanwhile
+        save_.SyncInBackground();
+        save_written_ = save_pending_ = false;
+    }
+
+    namespace
+    {
+        // Macronix MX29L1100, the FlashRAM most games shipped with. The high word is the status
+        // register, its low byte tells what the last command did
+        constexpr uint64_t flash_id = 0x0000'0000'00C2'001E;
+        constexpr uint64_t flash_status(uint8_t status)
+        {
+            return 0x1111'8000'0000'0000 | static_cast<uint64_t>(status) << 32 | flash_id;
+        }
+    } // namespace
+
+    void CPUBus::flash_command(uint32_t command)
+    {
+        if (save_.Size() < 0x20000)
+        {
+            Logger::WarnOnce("FlashRAM command {:08x} without a save", command);
+            return;
+        }
+        auto program = [this] {
+            std::memcpy(save_.Data() + flash_offset_, flash_page_.data(), flash_page_.size());
+            save_written_ = true;
+        };
+        auto erase = [this] {
+            // Sector erases clear the 16 KiB around the page they're given
+            bool chip = flash_mode_ == FlashMode::ChipErase;
+            std::memset(save_.Data() + (chip ? 0 : flash_offset_), 0xFF, chip ? 0x20000 : 0x4000);
+            save_written_ = true;
+        };
+        uint32_t page_offset = (command & 0x3FF) * 128;
+        switch (command >> 24)
+        {
+            case 0x3C:
+                flash_mode_ = FlashMode::ChipErase;
+                break;
+            case 0x4B:
+                flash_mode_ = FlashMode::Erase;
+                flash_offset_ = page_offset & ~0x3FFF;
+                break;
+            case 0x78:
+                erase();
+                flash_status_ = flash_status(0x08);
+                break;
+            case 0xA5:
+                flash_offset_ = page_offset;
+                program();
+                flash_status_ = flash_status(0x04);
+                break;
+            case 0xB4:
+                flash_mode_ = FlashMode::Write;
+                break;
+            // Some games execute the erase or program they set up once more
+            case 0xD2:
+                if (flash_mode_ == FlashMode::Write)
+                {
+                    program();
+                }
+                else if (flash_mode_ != FlashMode::Read && flash_mode_ != FlashMode::Status)
+                {
+                    erase();
+                }
+                break;
+            case 0xE1:
+                flash_mode_ = FlashMode::Status;
+                flash_status_ = flash_status(0x01);
+                break;
+            case 0xF0:
+                flash_mode_ = FlashMode::Read;
+                flash_status_ = 0x1111'8004'F000'0000;
+                break;
+            default:
+                Logger::WarnOnce("Unknown FlashRAM command {:08x}", command);
+                break;
+        }
+    }
+
+    uint32_t CPUBus::flash_read_status()
+    {
+        return flash_status_ >> 32;
+    }
+
+    void CPUBus::flash_dma_read(uint32_t dram_addr, uint32_t cart_addr, size_t length)
+    {
+        length = std::min<size_t>(length, rdram_.size() - dram_addr);
+        if (flash_mode_ == FlashMode::Status)
+        {
+            for (size_t i = 0; i < std::min<size_t>(length, 8); i++)
+            {
+                rdram_[dram_addr + i] = flash_status_ >> (56 - i * 8);
+            }
+            return;
+        }
+        // The flash is addressed in halfwords on the bus
+        size_t offset = static_cast<size_t>(cart_addr - SRAM_AREA_START) * 2;
+        if (flash_mode_ != FlashMode::Read || save_.Size() < 0x20000 || offset >= 0x20000)
+        {
+            Logger::WarnOnce("FlashRAM read at {:08x} outside of read mode", cart_addr);
+            return;
+        }
+        std::memcpy(&rdram_[dram_addr], save_.Data() + offset,
+                    std::min<size_t>(length, 0x20000 - offset));
+    }
+
+    void CPUBus::flash_dma_write(uint32_t dram_addr, size_t length)
+    {
+        if (flash_mode_ != FlashMode::Write)
+        {
+            Logger::WarnOnce("FlashRAM write outside of write mode");
+            return;
+        }
+        length = std::min<size_t>({length, flash_page_.size(), rdram_.size() - dram_addr});
+        std::memcpy(flash_page_.data(), &rdram_[dram_addr], length);
+    }
+
+    void CPUBus::FlushSave()
+    {
+        if (!save_written_ && !save_pending_ && !save_.SyncFailed())
+        {
+            return;
+        }
+        if (!save_.Sync())
+        {
+            Logger::WarnOnce("Couldn't write the save file back, retrying every frame");
+            return;
+        }
+        save_written_ = save_pending_ = false;
+    }
+
     bool CPUBus::LoadIPL(std::string path)
     {
         std::ifstream ifs(path, std::ios::in | std::ios::binary);
@@ -65,11 +284,21 @@ namespace hydra::N64
     {
         pif_ram_.fill(0);
         time_ = 0;
+        flash_mode_ = FlashMode::Read;
+        flash_status_ = 0;
 
+        pif_ram_[0x27] = 0x3F;
+        if (game_info_ && game_info_->cic_seed)
+        {
+            pif_ram_[0x26] = game_info_->cic_seed;
+            return;
+        }
+
+        uint8_t* rom = redirect_paddress(0x1000'0000);
         uint32_t crc = 0xFFFF'FFFF;
         for (int i = 0; i < 0x9c0; i++)
         {
-            crc = hydra::crc32_u8(crc, cart_rom_[i + 0x40]);
+            crc = hydra::crc32_u8(crc, rom[i + 0x40]);
         }
         crc ^= 0xFFFF'FFFF;
 
@@ -100,8 +329,6 @@ namespace hydra::N64
                 break;
             }
         }
-
-        pif_ram_[0x27] = 0x3F;
     }
 
     uint8_t* CPUBus::redirect_paddress(uint32_t paddr)
@@ -119,6 +346,48 @@ namespace hydra::N64
         return nullptr;
     }
 
+    void CPUBus::copy_paddresses(uint8_t* dst, uint32_t paddr, size_t length)
+    {
+        for (size_t copied = 0; copied < length;)
+        {
+            uint32_t address = paddr + copied;
+            size_t size = std::min<size_t>(length - copied, 0x10000 - (address & 0xFFFF));
+            uint8_t* src = redirect_paddress(address);
+            if (src)
+            {
+                std::memcpy(dst + copied, src, size);
+            }
+            else
+            {
+                std::memset(dst + copied, 0, size);
+            }
+            copied += size;
+        }
+    }
+
+    void CPUBus::copy_shown_frame()
+    {
+        auto [address, size] = rcp_.vi_.GetFramebufferRange();
+        address = std::min<size_t>(address, rdram_.size());
+        size = std::min(size, rdram_.size() - address);
+        shown_frame_address_ = address;
+        shown_frame_.assign(rdram_.begin() + address, rdram_.begin() + address + size);
+    }
+
+    void CPUBus::mark_shown_frame_changes()
+    {
+        constexpr size_t block_size = size_t(1) << DirtyMap::block_shift;
+        for (size_t offset = 0; offset < shown_frame_.size(); offset += block_size)
+        {
+            size_t size = std::min(block_size, shown_frame_.size() - offset);
+            uint32_t address = shown_frame_address_ + offset;
+            if (std::memcmp(&shown_frame_[offset], &rdram_[address], size) != 0)
+            {
+                rcp_.dirty_map_.Mark(address, size);
+            }
+        }
+    }
+
     void CPUBus::map_direct_addresses()
     {
         // https://wheremyfoodat.github.io/software-fastmem/
@@ -131,15 +400,29 @@ namespace hydra::N64
         }
         page_table_[ADDR_TO_PAGE(0x04000000)] = &rcp_.rsp_.mem_[0];
 
-        for (int i = ADDR_TO_PAGE(0x08000000); i <= ADDR_TO_PAGE(0x0FFF'0000); i++)
-        {
-            // page_table_[i] = &sram_[PAGE_SIZE * (i - ADDR_TO_PAGE(0x0800'0000))];
-        }
+        map_cartridge();
+        map_save();
+#undef ADDR_TO_PAGE
+    }
 
-        // Map cartridge rom
+    void CPUBus::map_save()
+    {
+#define ADDR_TO_PAGE(addr) ((addr) >> 16)
+        // Only SRAM is on the bus, EEPROM is reached through the PIF
+        bool sram = save_type() == SaveType::Sram && save_.Data();
+        page_table_[ADDR_TO_PAGE(SRAM_AREA_START)] = sram ? save_.Data() : nullptr;
+#undef ADDR_TO_PAGE
+    }
+
+    void CPUBus::map_cartridge()
+    {
+        const uint32_t PAGE_SIZE = 0x10000;
+#define ADDR_TO_PAGE(addr) ((addr) >> 16)
         for (int i = ADDR_TO_PAGE(0x1000'0000); i <= ADDR_TO_PAGE(0x1FBF'0000); i++)
         {
-            page_table_[i] = &cart_rom_[PAGE_SIZE * (i - ADDR_TO_PAGE(0x1000'0000))];
+            size_t offset = PAGE_SIZE * (i - ADDR_TO_PAGE(0x1000'0000));
+            page_table_[i] =
+                offset < cart_rom_.MappedSize() ? cart_rom_.Data() + offset : zero_page_.data();
         }
         page_table_[ADDR_TO_PAGE(ISVIEWER_AREA_START)] = nullptr;
 #undef ADDR_TO_PAGE
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <compatibility.hxx>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace hydra::N64
+{
+    /**
+        Tracks which parts of RDRAM were written, so the VI only converts the framebuffer rows
+        that changed since it last scanned them out
+
+        RDRAM is split in 64 byte blocks with one bit each. The CPU, the RSP and the RDP mark
+        the blocks they write, the VI tests the blocks of every row it reads and then clears
+        the whole framebuffer at once, as a block can straddle two rows.
+
+        Addresses are RDRAM byte addresses
+    */
+    class DirtyMap
+    {
+    public:
+        static constexpr int block_shift = 6;
+
+        DirtyMap(size_t rdram_size)
+            : words_(rdram_size >> (block_shift + 6)),
+              address_mask_(static_cast<uint32_t>(rdram_size - 1))
+        {
+        }
+
+        hydra_inline void Mark(uint32_t address)
+        {
+            uint32_t block = (address & address_mask_) >> block_shift;
+            words_[block >> 6] |= uint64_t(1) << (block & 63);
+        }
+
+        void Mark(uint32_t address, size_t size)
+        {
+            for_each_word(address, size, [this](size_t i, uint64_t mask) { words_[i] |= mask; });
+        }
+
+        // Whether any of the `size` bytes starting at `address` was marked since the last Clear
+        bool Test(uint32_t address, size_t size) const
+        {
+            bool dirty = false;
+            for_each_word(address, size,
+                          [&](size_t i, uint64_t mask) { dirty |= (words_[i] & mask) != 0; });
+            return dirty;
+        }
+
+        void Clear(uint32_t address, size_t size)
+        {
+            for_each_word(address, size, [this](size_t i, uint64_t mask) { words_[i] &= ~mask; });
+        }
+
+    private:
+        std::vector<uint64_t> words_;
+        uint32_t address_mask_;
+
+        // Calls function(word index, block mask) for every word holding blocks of the range.
+        // Ranges end at the end of RDRAM instead of wrapping around
+        template <class Function>
+        void for_each_word(uint32_t address, size_t size, Function&& function) const
+        {
+            if (size == 0)
+            {
+                return;
+            }
+            size_t start = address & address_mask_;
+            size_t end = std::min<size_t>(start + size - 1, address_mask_);
+            size_t first = start >> block_shift, last = end >> block_shift;
+            for (size_t i = first >> 6; i <= last >> 6; i++)
+            {
+                uint64_t mask = ~uint64_t(0);
+                if (i == first >> 6)
+                {
+                    mask &= ~uint64_t(0) << (first & 63);
+                }
+                if (i == last >> 6)
+                {
+                    mask &= ~uint64_t(0) >> (63 - (last & 63));
+                }
+                function(i, mask);
+            }
+        }
+    };
+} // namespace hydra::N64
@@ -0,0 +1,75 @@
+#include <n64/core/n64_game_db.hxx>
+#include <unordered_map>
+
+namespace hydra::N64
+{
+    namespace
+    {
+        constexpr uint64_t header_crc(uint32_t crc1, uint32_t crc2)
+        {
+            return static_cast<uint64_t>(crc1) << 32 | crc2;
+        }
+
+        // clang-format off
+        constexpr GameInfo banjo_kazooie = {.name = "Banjo-Kazooie",
+                                            .save_type = SaveType::Eeprom4K};
+        constexpr GameInfo banjo_tooie = {.name = "Banjo-Tooie", .save_type = SaveType::Eeprom16K};
+        constexpr GameInfo donkey_kong = {.name = "Donkey Kong 64",
+                                          .save_type = SaveType::Eeprom16K,
+                                          .rdram_size = 0x800000};
+        constexpr GameInfo excitebike = {.name = "Excitebike 64", .save_type = SaveType::Eeprom16K};
+        constexpr GameInfo f_zero = {.name = "F-Zero X", .save_type = SaveType::Sram};
+        constexpr GameInfo goldeneye = {.name = "GoldenEye 007", .save_type = SaveType::Eeprom4K};
+        constexpr GameInfo majoras_mask = {.name = "The Legend of Zelda: Majora's Mask",
+                                           .save_type = SaveType::FlashRam,
+                                           .rdram_size = 0x800000};
+        constexpr GameInfo mario_64 = {.name = "Super Mario 64", .save_type = SaveType::Eeprom4K};
+        constexpr GameInfo mario_kart = {.name = "Mario Kart 64", .save_type = SaveType::Eeprom4K};
+        constexpr GameInfo ocarina = {.name = "The Legend of Zelda: Ocarina of Time",
+                                      .save_type = SaveType::Sram};
+        constexpr GameInfo paper_mario = {.name = "Paper Mario", .save_type = SaveType::FlashRam};
+        constexpr GameInfo pokemon_snap = {.name = "Pokemon Snap", .save_type = SaveType::FlashRam};
+        constexpr GameInfo smash = {.name = "Super Smash Bros.", .save_type = SaveType::Sram};
+        constexpr GameInfo star_fox = {.name = "Star Fox 64", .save_type = SaveType::Eeprom4K,
+                                       .cic_seed = 0x3F};
+        constexpr GameInfo yoshi = {.name = "Yoshi's Story", .save_type = SaveType::Eeprom16K};
+
+        // Keyed by CRC1 and CRC2 at 0x10 of the header, USA releases unless noted
+        const std::unordered_map<uint64_t, GameInfo> games = {
+            {header_crc(0xA4BF9306, 0xBF0CDFD1), banjo_kazooie},
+            {header_crc(0xC2E9AA9A, 0x475D70AA), banjo_tooie},
+            {header_crc(0xEC58EABF, 0xAD7C7169), donkey_kong},
+            {header_crc(0x07861842, 0xA12EBC9F), excitebike},
+            {header_crc(0xB30ED978, 0x3003C9F9), f_zero},
+            {header_crc(0xDCBC50D1, 0x09FD1AA3), goldeneye},
+            {header_crc(0x5354631C, 0x03A2DEF0), majoras_mask},
+            {header_crc(0x635A2BFF, 0x8B022326), mario_64},
+            // Japan
+            {header_crc(0x4EAA3D0E, 0x74757C24), mario_64},
+            {header_crc(0x3E5055B6, 0x2E92DA52), mario_kart},
+            // 1.0, 1.1 and 1.2
+            {header_crc(0xEC7011B7, 0x7616D72B), ocarina},
+            {header_crc(0xD43DA81F, 0x021E1E19), ocarina},
+            {header_crc(0x693BA2AE, 0xB7F14E9F), ocarina},
+            {header_crc(0x65EEE53A, 0xED7D733C), paper_mario},
+            {header_crc(0xCA12B547, 0x71FA4EE4), pokemon_snap},
+            {header_crc(0x916B8B5B, 0x780B85A4), smash},
+            // 1.0 and 1.1
+            {header_crc(0xA7D015F8, 0x2289AA43), star_fox},
+            {header_crc(0xBA780BA0, 0x0F21DB34), star_fox},
+            {header_crc(0x2337D8E8, 0x6B8E7CEC), yoshi},
+        };
+        // clang-format on
+    } // namespace
+
+    const GameInfo* FindGame(const uint8_t* header)
+    {
+        uint64_t crc = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            crc = crc << 8 | header[0x10 + i];
+        }
+        auto it = games.find(crc);
+        return it != games.end() ? &it->second : nullptr;
+    }
+} // namespace hydra::N64
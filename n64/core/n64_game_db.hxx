@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+namespace hydra::N64
+{
+    enum class SaveType : uint8_t
+    {
+        None,
+        Eeprom4K,
+        Eeprom16K,
+        Sram,
+        FlashRam,
+    };
+
+    // Opt-outs for speed features, for games known to break with them. Placeholders for now,
+    // there's no RSP HLE or threaded RDP to opt out of and no entry sets them
+    enum GameHints : uint8_t
+    {
+        NoRspHle = 1 << 0,
+        NoRdpThreading = 1 << 1,
+    };
+
+    struct GameInfo
+    {
+        const char* name = nullptr;
+        SaveType save_type = SaveType::None;
+        // PIF seed of the CIC, 0 to tell it apart from the IPL3 checksum
+        uint8_t cic_seed = 0;
+        uint8_t hints = 0;
+        // Least RDRAM the game runs with, 8 MiB ones need the Expansion Pak
+        uint32_t rdram_size = 0x400000;
+        // Address of the loop the game spins in while waiting for an interrupt, 0 if unknown.
+        // A placeholder like the hints, nothing skips idle loops yet
+        uint32_t idle_loop = 0;
+    };
+
+    /**
+        Looks a cartridge up in the game database by the CRC1 and CRC2 checksums in its .z64
+        header, which tell revisions and regions of a game apart. Returns nullptr for games
+        that aren't in it
+
+        @param header at least the first 0x40 bytes of the ROM
+    */
+    const GameInfo* FindGame(const uint8_t* header);
+} // namespace hydra::N64
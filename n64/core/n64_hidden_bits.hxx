@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <compatibility.hxx>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace hydra::N64
+{
+    /**
+        Storage for the 9th bit of every RDRAM byte
+
+        Only the RDP can see these bits, and it always uses them in pairs: the two hidden bits
+        of a 16-bit word hold either coverage bits (16bpp color images) or the upper bits of
+        the compressed depth delta (depth images). They are packed two bits per halfword, four
+        halfwords per byte, so a pixel's hidden bits are fetched with a single load.
+
+        Addresses are RDRAM byte addresses of the halfword
+    */
+    class HiddenBits
+    {
+    public:
+        HiddenBits(size_t rdram_size)
+            : bits_(rdram_size / 8), address_mask_(static_cast<uint32_t>(rdram_size - 1) & ~1u)
+        {
+        }
+
+        hydra_inline uint8_t Get(uint32_t address) const
+        {
+            uint32_t index = (address & address_mask_) >> 1;
+            return (bits_[index >> 2] >> ((index & 3) << 1)) & 0b11;
+        }
+
+        hydra_inline void Set(uint32_t address, uint8_t value)
+        {
+            uint32_t index = (address & address_mask_) >> 1;
+            uint8_t shift = (index & 3) << 1;
+            uint8_t& byte = bits_[index >> 2];
+            byte = (byte & ~(0b11 << shift)) | ((value & 0b11) << shift);
+        }
+
+        // Sets the hidden bits of `count` consecutive halfwords starting at `address`
+        void Fill(uint32_t address, size_t count, uint8_t value)
+        {
+            Fill(address, count, value, value);
+        }
+
+        // Same as above, but alternates between `first` and `second`, starting with `first`
+        void Fill(uint32_t address, size_t count, uint8_t first, uint8_t second)
+        {
+            uint32_t index = (address & address_mask_) >> 1;
+            size_t end = std::min<size_t>(index + count, bits_.size() * 4);
+
+            // Each byte holds halfwords 4n..4n+3, so the pattern only depends on index parity
+            uint8_t even = (index & 1) ? second : first;
+            uint8_t odd = (index & 1) ? first : second;
+            uint8_t pattern = ((even & 0b11) | ((odd & 0b11) << 2)) * 0b0001'0001;
+
+            while ((index & 3) && index < end)
+            {
+                Set(index << 1, (index & 1) ? odd : even);
+                index++;
+            }
+
+            size_t whole_bytes = (end - index) >> 2;
+            std::memset(&bits_[index >> 2], pattern, whole_bytes);
+            index += whole_bytes << 2;
+
+            while (index < end)
+            {
+                Set(index << 1, (index & 1) ? odd : even);
+                index++;
+            }
+        }
+
+        // Copies out the hidden bits of `count` consecutive halfwords, one halfword per byte
+        void Read(uint32_t address, uint8_t* dst, size_t count) const
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                dst[i] = Get(address + i * 2);
+            }
+        }
+
+        // Writes the hidden bits of `count` consecutive halfwords, one halfword per byte
+        void Write(uint32_t address, const uint8_t* src, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                Set(address + i * 2, src[i]);
+            }
+        }
+
+        void Clear()
+        {
+            std::fill(bits_.begin(), bits_.end(), 0);
+        }
+
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar(bits_);
+        }
+
+    private:
+        std::vector<uint8_t> bits_;
+        uint32_t address_mask_;
+    };
+} // namespace hydra::N64
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <chrono>
 #include <iostream>
 #include <n64/core/n64_impl.hxx>
+#include <thread>
 
 namespace hydra::N64
 {
@@ -14,6 +15,11 @@ namespace hydra::N64
         return cpu_.cpubus_.LoadCartridge(path);
     }
 
+    bool N64::OpenSave(const std::string& path, bool writable)
+    {
+        return cpu_.cpubus_.OpenSave(path, writable);
+    }
+
     bool N64::LoadIPL(std::string path)
     {
         if (!path.empty())
@@ -25,38 +31,36 @@ namespace hydra::N64
 
     void N64::Update()
     {
-        static int cycles = 0;
         for (int f = 0; f < 1; f++)
         { // fields
             for (int hl = 0; hl < cpu_.rcp_.vi_.num_halflines_; hl++)
             { // halflines
                 cpu_.rcp_.vi_.vi_v_current_ = (hl << 1) + f;
                 cpu_.check_vi_interrupt();
-                while (cycles <= cpu_.rcp_.vi_.cycles_per_halfline_)
+                while (cycles_ <= cpu_.rcp_.vi_.cycles_per_halfline_)
                 {
-                    static int cpu_cycles = 0;
-                    cpu_cycles++;
+                    cpu_cycles_++;
                     cpu_.Tick();
                     rcp_.ai_.Step();
                     if (!cpu_.rcp_.rsp_.IsHalted())
                     {
-                        while (cpu_cycles > 2)
+                        while (cpu_cycles_ > 2)
                         {
                             cpu_.rcp_.rsp_.Tick();
                             if (!cpu_.rcp_.rsp_.IsHalted())
                             {
                                 cpu_.rcp_.rsp_.Tick();
                             }
-                            cpu_cycles -= 3;
+                            cpu_cycles_ -= 3;
                         }
                     }
                     else
                     {
-                        cpu_cycles = 0;
+                        cpu_cycles_ = 0;
                     }
-                    cycles++;
+                    cycles_++;
                 }
-                cycles -= cpu_.rcp_.vi_.cycles_per_halfline_;
+                cycles_ -= cpu_.rcp_.vi_.cycles_per_halfline_;
             }
             cpu_.check_vi_interrupt();
         }
@@ -69,13 +73,54 @@ namespace hydra::N64
             // printf("VIs: %d\n", cpu_.vis_per_second_);
             rcp_.vi_.vis_counter_ = 0;
         }
-        cpu_.should_draw_ = rcp_.Redraw();
+        cpu_.should_draw_ = presenting_ && rcp_.Redraw();
+        // Saves are written back once the game is done writing them, however many stores it made
+        cpu_.cpubus_.SyncSave();
+    }
+
+    void N64::WaitForNextFrame()
+    {
+        using namespace std::chrono;
+        // Update times every frame as a 60th of a second
+        constexpr auto frame_time =
+            duration_cast<steady_clock::duration>(duration<double>(1 / 60.0));
+        if (sync_mode_ == SyncMode::Unthrottled)
+        {
+            return;
+        }
+        auto now = steady_clock::now();
+        if (sync_mode_ == SyncMode::Audio && rcp_.ai_.IsPlaying())
+        {
+            // The audio device sets the pace, the AI resampler absorbs what drift is left. A
+            // device that stopped pulling samples can't hold the emulator up for long
+            auto excess = duration_cast<steady_clock::duration>(
+                duration<double>(rcp_.ai_.GetExcessLatency()));
+            if (excess > steady_clock::duration::zero())
+            {
+                std::this_thread::sleep_for(std::min(excess, frame_time * 2));
+            }
+            next_frame_time_ = steady_clock::now();
+            return;
+        }
+        next_frame_time_ += frame_time;
+        if (next_frame_time_ + frame_time * 4 < now)
+        {
+            // Too far behind to catch up without a burst of frames, start over from now
+            next_frame_time_ = now;
+            return;
+        }
+        std::this_thread::sleep_until(next_frame_time_);
     }
 
     void N64::Reset()
     {
         cpu_.Reset();
         rcp_.Reset();
+        next_frame_time_ = std::chrono::steady_clock::now();
+        if (hle_boot_)
+        {
+            cpu_.BootHLE();
+        }
     }
 
     void N64::SetMousePos(int32_t x, int32_t y)
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <n64/core/n64_cpu.hxx>
 #include <n64/core/n64_rcp.hxx>
 #include <string>
@@ -11,8 +12,12 @@ namespace hydra::N64
     class N64
     {
     public:
+        // What the emulator waits for between frames
+        enum class SyncMode { Audio, Video, Unthrottled };
+
         N64(bool& should_draw);
         bool LoadCartridge(std::string path);
+        bool OpenSave(const std::string& path, bool writable = true);
         bool LoadIPL(std::string path);
         void Update();
         void Reset();
@@ -20,7 +25,7 @@ namespace hydra::N64
 
         void* GetColorData()
         {
-            return rcp_.vi_.framebuffer_ptr_;
+            return rcp_.vi_.GetFramebufferPtr();
         }
 
         int GetWidth()
@@ -33,15 +38,100 @@ namespace hydra::N64
             return rcp_.vi_.height_;
         }
 
+        std::pair<int, int> TakeDirtyRows()
+        {
+            return rcp_.vi_.TakeDirtyRows();
+        }
+
+        // Whether GetColorData points to RGBA5551 pixels instead of RGBA8888 ones
+        bool IsColorData16Bit()
+        {
+            return rcp_.vi_.handed_over_.output_16bit;
+        }
+
+        int GetColorDataRowLength()
+        {
+            return rcp_.vi_.handed_over_.width;
+        }
+
+        // For tests and tools, reads that bypass the TLB and don't have side effects
+        uint64_t GetPC()
+        {
+            return cpu_.pc_;
+        }
+
+        uint64_t GetGPR(int index)
+        {
+            return cpu_.gpr_regs_[index].UD;
+        }
+
+        // Unmapped addresses read as zero
+        void ReadPhysical(uint8_t* dst, uint32_t paddr, size_t length)
+        {
+            cpubus_.copy_paddresses(dst, paddr, length);
+        }
+
+        // Starts games without running the PIF ROM and IPL3, from the next reset on
+        void SetHLEBoot(bool enabled)
+        {
+            hle_boot_ = enabled;
+        }
+
+        void SetSyncMode(SyncMode mode)
+        {
+            sync_mode_ = mode;
+            // Frames are paced from the switch on, not from whenever the last one was waited on
+            next_frame_time_ = std::chrono::steady_clock::now();
+        }
+
+        // Sleeps until the next frame is due, meant to be called between frames outside of any
+        // lock
+        void WaitForNextFrame();
+
+        void SetNative16Bit(bool enabled)
+        {
+            rcp_.vi_.SetNative16Bit(enabled);
+        }
+
+        void SetMuted(bool muted)
+        {
+            rcp_.ai_.SetMuted(muted);
+        }
+
+        // Frames that aren't presented leave the rows they changed for the next one to copy
+        void SetPresenting(bool presenting)
+        {
+            presenting_ = presenting;
+        }
+
         void SetKeyState(uint32_t key, bool state)
         {
             cpu_.key_state_[key] = state;
         }
 
+        bool StartRDPCapture(const std::string& path)
+        {
+            return rcp_.rdp_.StartCapture(path);
+        }
+
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("N64 ", 1);
+            ar(cpubus_, cpu_, rcp_, cycles_, cpu_cycles_);
+        }
+
     private:
         RCP rcp_;
         CPUBus cpubus_;
         CPU cpu_;
+        SyncMode sync_mode_ = SyncMode::Audio;
+        bool hle_boot_ = false;
+        bool presenting_ = true;
+        // Where Update left off in the current halfline, and the CPU cycles the RSP is behind
+        int cycles_ = 0;
+        int cpu_cycles_ = 0;
+        std::chrono::steady_clock::time_point next_frame_time_ = std::chrono::steady_clock::now();
         friend class N64_TKPWrapper;
         friend class ::N64Debugger;
         friend class ::MmioViewer;
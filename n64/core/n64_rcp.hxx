@@ -3,6 +3,7 @@
 #include <array>
 #include <cstdint>
 #include <n64/core/n64_ai.hxx>
+#include <n64/core/n64_dirty_map.hxx>
 #include <n64/core/n64_rdp.hxx>
 #include <n64/core/n64_rsp.hxx>
 #include <n64/core/n64_vi.hxx>
@@ -28,7 +29,14 @@ namespace hydra::N64
         void Reset();
         bool Redraw();
 
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar(vi_, ai_, rsp_, rdp_);
+        }
+
     private:
+        DirtyMap dirty_map_{0x800000};
         Vi vi_;
         Ai ai_;
         RSP rsp_;
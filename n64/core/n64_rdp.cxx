@@ -10,9 +10,17 @@
 #include <n64/core/n64_addresses.hxx>
 #include <n64/core/n64_rdp.hxx>
 #include <n64/core/n64_rdp_commands.hxx>
+#include <n64/core/n64_rdp_perspective.hxx>
 #include <sstream>
 #include <str_hash.hxx>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+// The span kernel is compiled for AVX2 regardless of the target flags, and only used if the CPU
+// supports it
+#define HYDRA_RDP_AVX2
+#define hydra_avx2 __attribute__((target("avx2,popcnt")))
+#endif
+
 hydra_inline static uint32_t irand(uint32_t* state)
 {
     *state = *state * 0x343fd + 0x269ec3;
@@ -40,17 +48,7 @@ hydra_inline static uint16_t rgba32_to_rgba16(uint32_t color)
     return (r << 11) | (g << 6) | (b << 1) | a;
 }
 
-static std::pair<int32_t, int32_t> perspective_correction(int32_t s, int32_t t, int32_t w)
-{
-    if ((w >> 15) == 0)
-    {
-        Logger::WarnOnce("Division by zero in perspective correction");
-        return {0, 0};
-    }
-    return {(s / (w >> 15)) >> 5, (t / (w >> 15)) >> 5};
-}
-
-static std::pair<int32_t, int32_t> no_perspective_correction(int32_t s, int32_t t, int32_t w)
+hydra_inline static std::pair<int32_t, int32_t> no_perspective_correction(int32_t s, int32_t t)
 {
     return {(int16_t)(s >> 16), (int16_t)(t >> 16)};
 }
@@ -89,8 +87,7 @@ namespace hydra::N64
 
     RDP::RDP()
     {
-        rdram_9th_bit_.resize(0x800000);
-        init_depth_luts();
+        SetSimdSpans(true);
     }
 
     void RDP::InstallBuses(uint8_t* rdram_ptr, uint8_t* spmem_ptr)
@@ -185,22 +182,17 @@ namespace hydra::N64
     {
         seed_ = 3;
         status_.ready = 1;
-        color_sub_a_[0] = color_sub_a_[1] = &color_one_;
-        color_sub_b_[0] = color_sub_b_[1] = &color_zero_;
-        color_multiplier_[0] = color_multiplier_[1] = &color_one_;
-        color_adder_[0] = color_adder_[1] = &color_zero_;
-        alpha_sub_a_[0] = alpha_sub_a_[1] = &color_zero_;
-        alpha_sub_b_[0] = alpha_sub_b_[1] = &color_zero_;
-        alpha_multiplier_[0] = alpha_multiplier_[1] = &color_one_;
-        alpha_adder_[0] = alpha_adder_[1] = &color_zero_;
+        set_combine_mode(0);
         blender_1a_[0] = blender_1a_[1] = 0;
         blender_1b_[0] = blender_1b_[1] = 0;
         blender_2a_[0] = blender_2a_[1] = 0;
         blender_2b_[0] = blender_2b_[1] = 0;
+        compile_blender();
         texel_color_[0] = texel_color_[1] = 0xFFFFFFFF;
         texel_alpha_[0] = texel_alpha_[1] = 0xFFFFFFFF;
         cycle_type_ = CycleType::Cycle1;
-        perspective_correction_func_ = &no_perspective_correction;
+        persp_tex_en_ = false;
+        invalidate_texel_caches();
     }
 
     void RDP::SendCommand(const std::vector<uint64_t>& data)
@@ -208,6 +200,37 @@ namespace hydra::N64
         execute_command(data);
     }
 
+    void RDP::SetSimdSpans(bool enabled)
+    {
+#ifdef HYDRA_RDP_AVX2
+        simd_spans_ = enabled && __builtin_cpu_supports("avx2");
+#else
+        simd_spans_ = false;
+#endif
+    }
+
+    bool RDP::StartCapture(const std::string& path)
+    {
+        auto capture = std::make_unique<RDPCaptureWriter>(0x800000);
+        if (!capture->Open(path))
+        {
+            return false;
+        }
+
+        capture_ = std::move(capture);
+        capture_images_.clear();
+        return true;
+    }
+
+    void RDP::StopCapture()
+    {
+        if (capture_)
+        {
+            capture_end_command_list();
+            capture_.reset();
+        }
+    }
+
     void RDP::process_commands()
     {
         uint32_t current = current_address_ & 0xFFFFF8;
@@ -231,6 +254,10 @@ namespace hydra::N64
                     command[i] =
                         hydra::bswap64(*reinterpret_cast<uint64_t*>(address + current + (i * 8)));
                 }
+                if (capture_) [[unlikely]]
+                {
+                    capture_command(command);
+                }
                 execute_command(command);
                 // Logger::Info("RDP: Command {} ({:02x})",
                 // get_rdp_command_name(static_cast<RDPCommandType>(command_type)),
@@ -243,10 +270,108 @@ namespace hydra::N64
             }
         }
 
+        if (capture_) [[unlikely]]
+        {
+            capture_end_command_list();
+        }
+
         current_address_ = end_address_;
         status_.freeze = 0;
     }
 
+    void RDP::capture_command(const std::vector<uint64_t>& data)
+    {
+        RDPCommandType id = static_cast<RDPCommandType>((data[0] >> 56) & 0b111111);
+        // Rounded up for 4bpp textures
+        uint32_t texel_size = std::max<uint32_t>(texture_pixel_size_latch_ >> 3, 1);
+        switch (id)
+        {
+            case RDPCommandType::LoadTile:
+            case RDPCommandType::LoadTLUT:
+            {
+                LoadTileCommand command;
+                command.full = data[0];
+                uint32_t start =
+                    ((command.TL >> 2) * texture_width_latch_ + (command.SL >> 2)) * texel_size;
+                uint32_t end =
+                    ((command.TH >> 2) * texture_width_latch_ + (command.SH >> 2) + 1) * texel_size;
+                if (end > start)
+                {
+                    capture_->WriteMemory(rdram_ptr_, texture_dram_address_latch_ + start,
+                                          end - start);
+                }
+                break;
+            }
+            case RDPCommandType::LoadBlock:
+            {
+                // Over-approximated, as LoadBlock copies 8 bytes at a time and doesn't scale SL
+                // by the texel size for every size
+                LoadBlockCommand command;
+                command.full = data[0];
+                uint32_t start = command.SL;
+                uint32_t end = (command.SH + 1) * texel_size + 8;
+                if (end > start)
+                {
+                    capture_->WriteMemory(rdram_ptr_, texture_dram_address_latch_ + start,
+                                          end - start);
+                }
+                break;
+            }
+            case RDPCommandType::Triangle:
+            case RDPCommandType::TriangleDepth:
+            case RDPCommandType::TriangleTexture:
+            case RDPCommandType::TriangleTextureDepth:
+            case RDPCommandType::TriangleShade:
+            case RDPCommandType::TriangleShadeDepth:
+            case RDPCommandType::TriangleShadeTexture:
+            case RDPCommandType::TriangleShadeTextureDepth:
+            case RDPCommandType::Rectangle:
+            case RDPCommandType::TextureRectangle:
+            case RDPCommandType::TextureRectangleFlip:
+            {
+                // Everything up to the scissor box, which may extend past the image width
+                uint32_t pixels =
+                    framebuffer_width_ * ((scissor_yl_ >> 2) + 1) + (scissor_xl_ >> 2) + 1;
+                capture_image(framebuffer_dram_address_,
+                              (pixels * framebuffer_pixel_size_ + 7) >> 3);
+                if (z_compare_en_ || z_update_en_)
+                {
+                    capture_image(zbuffer_dram_address_, pixels * 2);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+
+        capture_->WriteCommand(data);
+    }
+
+    void RDP::capture_image(uint32_t address, uint32_t size)
+    {
+        for (const auto& [image_address, image_size] : capture_images_)
+        {
+            if (image_address == address && image_size >= size)
+            {
+                return;
+            }
+        }
+
+        capture_->WriteMemory(rdram_ptr_, address, size);
+        capture_images_.push_back({address, size});
+    }
+
+    void RDP::capture_end_command_list()
+    {
+        // The replay draws the same pixels, so they don't need to be captured again
+        for (const auto& [address, size] : capture_images_)
+        {
+            capture_->SyncMemory(rdram_ptr_, address, size);
+        }
+        capture_images_.clear();
+        capture_->EndCommandList();
+    }
+
     void RDP::execute_command(const std::vector<uint64_t>& data)
     {
         RDPCommandType id = static_cast<RDPCommandType>((data[0] >> 56) & 0b111111);
@@ -293,6 +418,12 @@ namespace hydra::N64
             }
             case RDPCommandType::Rectangle:
             {
+                if (cycle_type_ == CycleType::Fill && framebuffer_pixel_size_ >= 16)
+                {
+                    fill_rectangle(data);
+                    break;
+                }
+
                 EdgewalkerInput input = rectangle_get_edgewalker_input<false, false>(data);
                 Primitive primitive = edgewalker(input);
                 render_primitive(primitive);
@@ -300,6 +431,13 @@ namespace hydra::N64
             }
             case RDPCommandType::TextureRectangle:
             {
+                // 32bpp copies crash the real RDP, leave them to the generic path
+                if (cycle_type_ == CycleType::Copy && framebuffer_pixel_size_ == 16)
+                {
+                    copy_rectangle(data);
+                    break;
+                }
+
                 EdgewalkerInput input = rectangle_get_edgewalker_input<true, false>(data);
                 Primitive primitive = edgewalker(input);
                 render_primitive(primitive);
@@ -381,6 +519,7 @@ namespace hydra::N64
                         break;
                     }
                 }
+                invalidate_texel_caches(tile.tmem_address + sl, tile.tmem_address + sh + 8);
                 break;
             }
             case RDPCommandType::SetTile:
@@ -390,6 +529,7 @@ namespace hydra::N64
                 SetTileCommand command;
                 command.full = data[0];
                 TileDescriptor& tile = tiles_[command.Tile];
+                texel_caches_[command.Tile].valid = false;
                 tile.tmem_address = command.TMemAddress;
                 tile.format = static_cast<Format>(command.format);
                 tile.size = 4 * (1 << command.size);
@@ -451,20 +591,14 @@ namespace hydra::N64
                 blender_1b_[1] = command.b_m1b_1;
                 blender_2a_[1] = command.b_m2a_1;
                 blender_2b_[1] = command.b_m2b_1;
+                compile_blender();
 
                 image_read_en_ = command.image_read_en;
                 alpha_compare_en_ = command.alpha_compare_en;
                 antialias_en_ = command.antialias_en;
                 cvg_dest_ = static_cast<CoverageMode>(command.cvg_dest);
                 color_on_cvg_ = command.color_on_cvg;
-                if (command.persp_tex_en)
-                {
-                    perspective_correction_func_ = &perspective_correction;
-                }
-                else
-                {
-                    perspective_correction_func_ = &no_perspective_correction;
-                }
+                persp_tex_en_ = command.persp_tex_en;
                 break;
             }
             case RDPCommandType::SetPrimDepth:
@@ -485,6 +619,8 @@ namespace hydra::N64
 
                 uint8_t alpha = environment_color_ >> 24;
                 environment_alpha_ = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
+                // Folded into the combiner equations that only use constants
+                compile_combiner();
                 break;
             }
             case RDPCommandType::SetBlendColor:
@@ -500,6 +636,7 @@ namespace hydra::N64
 
                 uint8_t alpha = primitive_color_ >> 24;
                 primitive_alpha_ = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
+                compile_combiner();
                 break;
             }
             case RDPCommandType::SetScissor:
@@ -523,28 +660,7 @@ namespace hydra::N64
             }
             case RDPCommandType::SetCombineMode:
             {
-                SetCombineModeCommand command;
-                command.full = data[0];
-
-                color_sub_a_[0] = color_get_sub_a(command.sub_A_RGB_0);
-                color_sub_b_[0] = color_get_sub_b(command.sub_B_RGB_0);
-                color_multiplier_[0] = color_get_mul(command.mul_RGB_0);
-                color_adder_[0] = color_get_add(command.add_RGB_0);
-
-                color_sub_a_[1] = color_get_sub_a(command.sub_A_RGB_1);
-                color_sub_b_[1] = color_get_sub_b(command.sub_B_RGB_1);
-                color_multiplier_[1] = color_get_mul(command.mul_RGB_1);
-                color_adder_[1] = color_get_add(command.add_RGB_1);
-
-                alpha_sub_a_[0] = alpha_get_sub_add(command.sub_A_Alpha_0);
-                alpha_sub_b_[0] = alpha_get_sub_add(command.sub_B_Alpha_0);
-                alpha_multiplier_[0] = alpha_get_mul(command.mul_Alpha_0);
-                alpha_adder_[0] = alpha_get_sub_add(command.add_Alpha_0);
-
-                alpha_sub_a_[1] = alpha_get_sub_add(command.sub_A_Alpha_1);
-                alpha_sub_b_[1] = alpha_get_sub_add(command.sub_B_Alpha_1);
-                alpha_multiplier_[1] = alpha_get_mul(command.mul_Alpha_1);
-                alpha_adder_[1] = alpha_get_sub_add(command.add_Alpha_1);
+                set_combine_mode(data[0]);
                 break;
             }
             case RDPCommandType::SetKeyR:
@@ -562,6 +678,48 @@ namespace hydra::N64
         }
     }
 
+    void RDP::set_combine_mode(uint64_t data)
+    {
+        combine_mode_ = data;
+        if (data == 0)
+        {
+            // What the combiner is reset to, until the first SetCombineMode
+            color_sub_a_[0] = color_sub_a_[1] = &color_one_;
+            color_sub_b_[0] = color_sub_b_[1] = &color_zero_;
+            color_multiplier_[0] = color_multiplier_[1] = &color_one_;
+            color_adder_[0] = color_adder_[1] = &color_zero_;
+            alpha_sub_a_[0] = alpha_sub_a_[1] = &color_zero_;
+            alpha_sub_b_[0] = alpha_sub_b_[1] = &color_zero_;
+            alpha_multiplier_[0] = alpha_multiplier_[1] = &color_one_;
+            alpha_adder_[0] = alpha_adder_[1] = &color_zero_;
+            compile_combiner();
+            return;
+        }
+        SetCombineModeCommand command;
+        command.full = data;
+
+        color_sub_a_[0] = color_get_sub_a(command.sub_A_RGB_0);
+        color_sub_b_[0] = color_get_sub_b(command.sub_B_RGB_0);
+        color_multiplier_[0] = color_get_mul(command.mul_RGB_0);
+        color_adder_[0] = color_get_add(command.add_RGB_0);
+
+        color_sub_a_[1] = color_get_sub_a(command.sub_A_RGB_1);
+        color_sub_b_[1] = color_get_sub_b(command.sub_B_RGB_1);
+        color_multiplier_[1] = color_get_mul(command.mul_RGB_1);
+        color_adder_[1] = color_get_add(command.add_RGB_1);
+
+        alpha_sub_a_[0] = alpha_get_sub_add(command.sub_A_Alpha_0);
+        alpha_sub_b_[0] = alpha_get_sub_add(command.sub_B_Alpha_0);
+        alpha_multiplier_[0] = alpha_get_mul(command.mul_Alpha_0);
+        alpha_adder_[0] = alpha_get_sub_add(command.add_Alpha_0);
+
+        alpha_sub_a_[1] = alpha_get_sub_add(command.sub_A_Alpha_1);
+        alpha_sub_b_[1] = alpha_get_sub_add(command.sub_B_Alpha_1);
+        alpha_multiplier_[1] = alpha_get_mul(command.mul_Alpha_1);
+        alpha_adder_[1] = alpha_get_sub_add(command.add_Alpha_1);
+        compile_combiner();
+    }
+
     uint32_t* RDP::color_get_sub_a(uint8_t sub_a)
     {
         switch (sub_a & 0b1111)
@@ -743,6 +901,17 @@ namespace hydra::N64
         }
     }
 
+    void RDP::mark_dirty(int y, int x_start, int x_end)
+    {
+        if (dirty_map_)
+        {
+            uint32_t pixel_bytes = framebuffer_pixel_size_ >> 3;
+            dirty_map_->Mark(framebuffer_dram_address_ +
+                                 (y * framebuffer_width_ + x_start) * pixel_bytes,
+                             (x_end - x_start + 1) * pixel_bytes);
+        }
+    }
+
     void RDP::draw_pixel(int x, int y)
     {
         uintptr_t address = reinterpret_cast<uintptr_t>(rdram_ptr_) + framebuffer_dram_address_ +
@@ -753,7 +922,8 @@ namespace hydra::N64
             {
                 color_combiner(0);
                 color_combiner(1);
-                blender(0);
+                // TODO: the first blender cycle should feed the second one, only the second one
+                // is evaluated
                 // TODO: remove code duplication
                 if (framebuffer_pixel_size_ == 16)
                 {
@@ -811,7 +981,8 @@ namespace hydra::N64
                 if (framebuffer_pixel_size_ == 16)
                 {
                     uint16_t* ptr = reinterpret_cast<uint16_t*>(address);
-                    *ptr = (x & 1) ? fill_color_16_0_ : fill_color_16_1_;
+                    // The fill color covers an aligned word, odd halfwords take its lower half
+                    *ptr = ((address >> 1) & 1) ? fill_color_16_0_ : fill_color_16_1_;
                 }
                 else
                 {
@@ -829,128 +1000,187 @@ namespace hydra::N64
         return (a - b) * c / 0xFF + d;
     }
 
-    void RDP::color_combiner(int cycle)
+    // x / 0xFF, exact for x up to 0xFF * 0xFF
+    hydra_inline static uint32_t divide_by_255(uint32_t x)
     {
-        uint8_t r = combine(*color_sub_a_[cycle], *color_sub_b_[cycle], *color_multiplier_[cycle],
-                            *color_adder_[cycle]);
-        uint8_t g = combine(*color_sub_a_[cycle] >> 8, *color_sub_b_[cycle] >> 8,
-                            *color_multiplier_[cycle] >> 8, *color_adder_[cycle] >> 8);
-        uint8_t b = combine(*color_sub_a_[cycle] >> 16, *color_sub_b_[cycle] >> 16,
-                            *color_multiplier_[cycle] >> 16, *color_adder_[cycle] >> 16);
-        uint8_t a = combine(*alpha_sub_a_[cycle], *alpha_sub_b_[cycle], *alpha_multiplier_[cycle],
-                            *alpha_adder_[cycle]);
-        combined_color_ = (a << 24) | (b << 16) | (g << 8) | r;
-        combined_alpha_ = a << 24 | a << 16 | a << 8 | a;
+        return (x * 0x8081) >> 23;
     }
 
-    uint32_t RDP::blender(int cycle)
+    // The equation on the lowest `channels` bytes of its inputs, the other bytes are garbage
+    hydra_inline static uint32_t combine_equation(const CombinerEquation& equation, int channels)
     {
-        uint32_t color1, color2;
-        uint8_t multiplier1, multiplier2;
-
-        switch (blender_1a_[cycle] & 0b11)
+        uint32_t result = 0;
+        switch (equation.op)
         {
-            case 0:
-                color1 = combined_color_;
-                break;
-            case 1:
-                color1 = framebuffer_color_;
-                break;
-            case 2:
-                color1 = blend_color_;
+            case CombinerEquation::Op::Combine:
+            {
+                for (int shift = 0; shift < channels * 8; shift += 8)
+                {
+                    result |= combine(*equation.a >> shift, *equation.b >> shift,
+                                      *equation.c >> shift, *equation.d >> shift)
+                              << shift;
+                }
                 break;
-            case 3:
-                color1 = fog_color_;
+            }
+            case CombinerEquation::Op::Multiply:
+            {
+                for (int shift = 0; shift < channels * 8; shift += 8)
+                {
+                    uint32_t a = (*equation.a >> shift) & 0xFF;
+                    uint32_t c = (*equation.c >> shift) & 0xFF;
+                    result |= divide_by_255(a * c) << shift;
+                }
                 break;
+            }
+            case CombinerEquation::Op::Add:
+                return *equation.d;
+            case CombinerEquation::Op::Constant:
+                return equation.constant;
         }
+        return result;
+    }
 
-        switch (blender_2a_[cycle] & 0b11)
-        {
-            case 0:
-                color2 = combined_color_;
-                break;
-            case 1:
-                color2 = framebuffer_color_;
-                break;
-            case 2:
-                color2 = blend_color_;
-                break;
-            case 3:
-                color2 = fog_color_;
-                break;
-        }
+    void RDP::color_combiner(int cycle)
+    {
+        uint32_t rgb = combine_equation(color_equation_[cycle], 3) & 0xFF'FFFF;
+        uint32_t a = combine_equation(alpha_equation_[cycle], 1) & 0xFF;
+        combined_color_ = (a << 24) | rgb;
+        combined_alpha_ = a * 0x01010101;
+    }
 
-        switch (blender_1b_[cycle] & 0b11)
-        {
-            case 0:
-                multiplier1 = combined_alpha_ >> 24;
-                break;
-            case 1:
-                multiplier1 = fog_alpha_ >> 24;
-                break;
-            case 2:
-                multiplier1 = shade_alpha_ >> 24;
-                break;
-            case 3:
-                multiplier1 = 0x00;
-                break;
-        }
+    void RDP::compile_combiner()
+    {
+        auto constant = [this](const uint32_t* input) {
+            return input == &primitive_color_ || input == &primitive_alpha_ ||
+                   input == &environment_color_ || input == &environment_alpha_ ||
+                   input == &color_one_ || input == &color_zero_;
+        };
+
+        auto compile = [&](CombinerEquation& equation, const uint32_t* a, const uint32_t* b,
+                           const uint32_t* c, const uint32_t* d, int channels) {
+            equation.a = a;
+            equation.b = b;
+            equation.c = c;
+            equation.d = d;
+            bool folds = false;
+            if (c == &color_zero_ || a == b)
+            {
+                equation.op = CombinerEquation::Op::Add;
+                folds = constant(d);
+            }
+            else if (b == &color_zero_ && d == &color_zero_)
+            {
+                equation.op = CombinerEquation::Op::Multiply;
+                folds = constant(a) && constant(c);
+            }
+            else
+            {
+                equation.op = CombinerEquation::Op::Combine;
+                folds = constant(a) && constant(b) && constant(c) && constant(d);
+            }
+
+            if (folds)
+            {
+                equation.constant = combine_equation(equation, channels);
+                equation.op = CombinerEquation::Op::Constant;
+            }
+        };
 
-        switch (blender_2b_[cycle] & 0b11)
+        for (int cycle = 0; cycle < 2; cycle++)
         {
-            case 0:
-                multiplier2 = ~multiplier1;
-                break;
-            case 1:
-                multiplier2 = 0x00; //(uint8_t)(((float)old_coverage_ / 8.0f) * 0xFF);
-                break;
-            case 2:
-                multiplier2 = 0xFF;
-                break;
-            case 3:
-                multiplier2 = 0x00;
-                break;
+            compile(color_equation_[cycle], color_sub_a_[cycle], color_sub_b_[cycle],
+                    color_multiplier_[cycle], color_adder_[cycle], 3);
+            compile(alpha_equation_[cycle], alpha_sub_a_[cycle], alpha_sub_b_[cycle],
+                    alpha_multiplier_[cycle], alpha_adder_[cycle], 1);
         }
+    }
 
-        if (multiplier1 + multiplier2 == 0)
+    void RDP::compile_blender()
+    {
+        uint32_t* colors[] = {&combined_color_, &framebuffer_color_, &blend_color_, &fog_color_};
+        uint32_t* multipliers[] = {&combined_alpha_, &fog_alpha_, &shade_alpha_, &color_zero_};
+        for (int cycle = 0; cycle < 2; cycle++)
         {
-            Logger::WarnOnce("Blender division by zero - blender settings: {} {} {} {}",
-                             blender_1a_[cycle], blender_2a_[cycle], blender_1b_[cycle],
-                             blender_2b_[cycle]);
-            multiplier1 = 0xFF;
+            BlenderEquation& equation = blender_equation_[cycle];
+            equation.color1 = colors[blender_1a_[cycle] & 0b11];
+            equation.color2 = colors[blender_2a_[cycle] & 0b11];
+            equation.multiplier1 = multipliers[blender_1b_[cycle] & 0b11];
+            bool m1_zero = equation.multiplier1 == &color_zero_;
+
+            // TODO: m2 of 1 should be the memory coverage, it's treated as zero
+            switch (blender_2b_[cycle] & 0b11)
+            {
+                case 0:
+                    equation.op = m1_zero ? BlenderEquation::Op::Color2
+                                          : BlenderEquation::Op::Interpolate;
+                    break;
+                case 2:
+                    equation.op =
+                        m1_zero ? BlenderEquation::Op::Color2 : BlenderEquation::Op::Blend;
+                    break;
+                default:
+                    // color1 * m1 / m1, where a zero m1 is replaced by 0xFF
+                    equation.op = BlenderEquation::Op::Color1;
+                    break;
+            }
         }
+    }
 
-        uint8_t r, g, b;
+    void RDP::warn_blender_division_by_zero(int cycle)
+    {
+        Logger::WarnOnce("Blender division by zero - blender settings: {} {} {} {}",
+                         blender_1a_[cycle], blender_2a_[cycle], blender_1b_[cycle],
+                         blender_2b_[cycle]);
+    }
 
-        if (!color_on_cvg_ || coverage_overflow_)
-        {
-            r = (((color1 >> 0) & 0xFF) * multiplier1 + ((color2 >> 0) & 0xFF) * multiplier2) /
-                (multiplier1 + multiplier2);
-            g = (((color1 >> 8) & 0xFF) * multiplier1 + ((color2 >> 8) & 0xFF) * multiplier2) /
-                (multiplier1 + multiplier2);
-            b = (((color1 >> 16) & 0xFF) * multiplier1 + ((color2 >> 16) & 0xFF) * multiplier2) /
-                (multiplier1 + multiplier2);
-        }
-        else
+    uint32_t RDP::blender(int cycle)
+    {
+        const BlenderEquation& equation = blender_equation_[cycle];
+        if (color_on_cvg_ && !coverage_overflow_)
         {
-            r = color2 & 0xFF;
-            g = (color2 >> 8) & 0xFF;
-            b = (color2 >> 16) & 0xFF;
+            return *equation.color2 & 0xFF'FFFF;
         }
 
-        // uint8_t r_f = framebuffer_color_ & 0xFF;
-        // uint8_t g_f = (framebuffer_color_ >> 8) & 0xFF;
-        // uint8_t b_f = (framebuffer_color_ >> 16) & 0xFF;
-
-        if (current_coverage_ != 8)
+        uint32_t m1 = *equation.multiplier1 >> 24;
+        uint32_t result = 0;
+        switch (equation.op)
         {
-            // float cvg = (float)current_coverage_ / 8.0f;
-            // r = (r * cvg) + (r_f * (1 - cvg));
-            // g = (g * cvg) + (g_f * (1 - cvg));
-            // b = (b * cvg) + (b_f * (1 - cvg));
+            case BlenderEquation::Op::Blend:
+            {
+                for (int shift = 0; shift < 24; shift += 8)
+                {
+                    uint32_t c1 = (*equation.color1 >> shift) & 0xFF;
+                    uint32_t c2 = (*equation.color2 >> shift) & 0xFF;
+                    result |= ((c1 * m1 + c2 * 0xFF) / (m1 + 0xFF)) << shift;
+                }
+                break;
+            }
+            case BlenderEquation::Op::Interpolate:
+            {
+                for (int shift = 0; shift < 24; shift += 8)
+                {
+                    uint32_t c1 = (*equation.color1 >> shift) & 0xFF;
+                    uint32_t c2 = (*equation.color2 >> shift) & 0xFF;
+                    result |= divide_by_255(c1 * m1 + c2 * (0xFF - m1)) << shift;
+                }
+                break;
+            }
+            case BlenderEquation::Op::Color1:
+            {
+                if (m1 == 0)
+                {
+                    warn_blender_division_by_zero(cycle);
+                }
+                result = *equation.color1 & 0xFF'FFFF;
+                break;
+            }
+            case BlenderEquation::Op::Color2:
+            {
+                result = *equation.color2 & 0xFF'FFFF;
+                break;
+            }
         }
-
-        return (0 << 24) | (b << 16) | (g << 8) | r;
+        return result;
     }
 
     bool RDP::depth_test(int x, int y, int32_t z, int16_t dz)
@@ -1005,12 +1235,69 @@ namespace hydra::N64
         }
     }
 
+    constexpr std::array<uint8_t, 8> z_shifts = {6, 5, 4, 3, 2, 1, 0, 0};
+
+    constexpr uint32_t z_compress(uint32_t z)
+    {
+        // count the most significant set bits and that is the exponent
+        uint32_t exponent = std::countl_one(
+            // mask bits so that we only count up to 7 bits
+            (z & 0b111111100000000000)
+            // shift them to the start for countl_one
+            << 14);
+        uint32_t mantissa = (z >> z_shifts[exponent]) & 0b111'1111'1111;
+        return (exponent << 11) | mantissa;
+    }
+
+    constexpr uint32_t z_decompress(uint32_t z)
+    {
+        uint32_t exponent = (z >> 11) & 0x7;
+        uint32_t mantissa = z & 0x7FF;
+        // shift mantissa to the msb, shift back by the exponent which
+        // will create n bits where n = exponent, then move those bits
+        // to the correct position
+        uint32_t bits = (!!exponent << 31) >> exponent;
+        bits >>= 13;
+        bits |= mantissa << z_shifts[exponent];
+        return bits & 0x3FFFF;
+    }
+
+    constexpr uint8_t dz_compress(uint16_t dz)
+    {
+        int compressed = 0;
+        if (dz & 0xff00)
+            compressed |= 8;
+        if (dz & 0xf0f0)
+            compressed |= 4;
+        if (dz & 0xcccc)
+            compressed |= 2;
+        if (dz & 0xaaaa)
+            compressed |= 1;
+        return compressed;
+    }
+
+    constexpr uint16_t dz_decompress(uint8_t dz_c)
+    {
+        return 1 << dz_c;
+    }
+
+    // Shared by every RDP and built at compile time. Compression is cheap enough to do on the
+    // fly, a table for it would be 256Ki entries
+    constexpr auto z_decompress_lut = [] {
+        std::array<uint32_t, 0x4000> lut{};
+        for (uint32_t i = 0; i < lut.size(); i++)
+        {
+            lut[i] = z_decompress(i);
+        }
+        return lut;
+    }();
+
     uint32_t RDP::z_get(int x, int y)
     {
         uintptr_t address = reinterpret_cast<uintptr_t>(rdram_ptr_) + zbuffer_dram_address_ +
                             (y * framebuffer_width_ + x) * 2;
         uint16_t* ptr = reinterpret_cast<uint16_t*>(address);
-        uint32_t decompressed = z_decompress_lut_[(*ptr >> 2) & 0x3FFF];
+        uint32_t decompressed = z_decompress_lut[(*ptr >> 2) & 0x3FFF];
         return decompressed;
     }
 
@@ -1018,9 +1305,7 @@ namespace hydra::N64
     {
         uintptr_t address = zbuffer_dram_address_ + (y * framebuffer_width_ + x) * 2;
         uint16_t* ptr = reinterpret_cast<uint16_t*>(rdram_ptr_ + address);
-        bool hidden1 = rdram_9th_bit_[address];
-        bool hidden2 = rdram_9th_bit_[address + 1];
-        uint8_t dz_c = (*ptr & 0b11) | (hidden1 << 2) | (hidden2 << 3);
+        uint8_t dz_c = (*ptr & 0b11) | (hidden_bits_.Get(address) << 2);
         return dz_decompress(dz_c);
     }
 
@@ -1031,8 +1316,7 @@ namespace hydra::N64
         uint16_t* ptr = reinterpret_cast<uint16_t*>(rdram_ptr_ + address);
         *ptr &= 0xFFFC;
         *ptr |= dz_c & 0b11;
-        rdram_9th_bit_[address] = (dz_c >> 2) & 0b1;
-        rdram_9th_bit_[address + 1] = (dz_c >> 3) & 0b1;
+        hidden_bits_.Set(address, dz_c >> 2);
     }
 
     uint8_t RDP::coverage_get(int x, int y)
@@ -1042,10 +1326,8 @@ namespace hydra::N64
         {
             // Get coverage from hidden bits
             uintptr_t address = framebuffer_dram_address_ + (y * framebuffer_width_ + x) * 2;
-            bool bit0 = rdram_9th_bit_[address];
-            bool bit1 = rdram_9th_bit_[address + 1];
             bool bit2 = *reinterpret_cast<uint16_t*>(&rdram_ptr_[address]) & 0b1;
-            coverage = (bit2 << 2) | (bit1 << 1) | bit0;
+            coverage = (bit2 << 2) | hidden_bits_.Get(address);
         }
         else
         {
@@ -1094,12 +1376,9 @@ namespace hydra::N64
 
         if (framebuffer_pixel_size_ == 16)
         {
-            bool bit0 = coverage & 0b1;
-            bool bit1 = coverage & 0b10;
             bool bit2 = coverage & 0b100;
             uintptr_t address = framebuffer_dram_address_ + (y * framebuffer_width_ + x) * 2;
-            rdram_9th_bit_[address] = bit0;
-            rdram_9th_bit_[address + 1] = bit1;
+            hidden_bits_.Set(address, coverage & 0b11);
             uint16_t* ptr = reinterpret_cast<uint16_t*>(&rdram_ptr_[address]);
             *ptr &= 0xfffc;
             *ptr |= bit2;
@@ -1120,81 +1399,108 @@ namespace hydra::N64
         uintptr_t address = reinterpret_cast<uintptr_t>(rdram_ptr_) + zbuffer_dram_address_ +
                             (y * framebuffer_width_ + x) * 2;
         uint16_t* ptr = reinterpret_cast<uint16_t*>(address);
-        uint16_t compressed = z_compress_lut_[z & 0x3FFFF];
-        *ptr = compressed;
+        // the 2 lower bits along with 2 more from the rdrams 9th bit
+        // are used to store the depth delta
+        *ptr = z_compress(z) << 2;
     }
 
-    constexpr std::array<uint8_t, 8> z_shifts = {6, 5, 4, 3, 2, 1, 0, 0};
+    hydra_inline static int32_t tile_wrap_s(const TileDescriptor& td, int32_t s)
+    {
+        if (td.clamp_s)
+        {
+            auto max_s = ((td.sh >> 2) - (td.sl >> 2)) & 0x3ff;
+            return std::clamp(s, 0, max_s);
+        }
+        else if (td.mirror_s)
+        {
+            return ((s & (td.mask_s + 1)) ? -s : s) & td.mask_s;
+        }
+        return s & td.mask_s;
+    }
 
-    uint32_t RDP::z_compress(uint32_t z)
+    hydra_inline static int32_t tile_wrap_t(const TileDescriptor& td, int32_t t)
     {
-        // count the most significant set bits and that is the exponent
-        uint32_t exponent = std::countl_one(
-            // mask bits so that we only count up to 7 bits
-            (z & 0b111111100000000000)
-            // shift them to the start for countl_one
-            << 14);
-        uint32_t mantissa = (z >> z_shifts[exponent]) & 0b111'1111'1111;
-        return (exponent << 11) | mantissa;
-    }
-
-    uint32_t RDP::z_decompress(uint32_t z)
-    {
-        uint32_t exponent = (z >> 11) & 0x7;
-        uint32_t mantissa = z & 0x7FF;
-        // shift mantissa to the msb, shift back by the exponent which
-        // will create n bits where n = exponent, then move those bits
-        // to the correct position
-        uint32_t bits = (!!exponent << 31) >> exponent;
-        bits >>= 13;
-        bits |= mantissa << z_shifts[exponent];
-        return bits & 0x3FFFF;
+        if (td.clamp_t)
+        {
+            auto max_t = ((td.th >> 2) - (td.tl >> 2)) & 0x3ff;
+            return std::clamp(t, 0, max_t);
+        }
+        else if (td.mirror_t)
+        {
+            return ((t & (td.mask_t + 1)) ? -t : t) & td.mask_t;
+        }
+        return t & td.mask_t;
     }
 
-    uint8_t RDP::dz_compress(uint16_t dz)
+    hydra_inline static uint32_t texel_cache_index(const TileDescriptor& td,
+                                                   const TexelCache& cache, int32_t s, int32_t t)
     {
-        int compressed = 0;
-        if (dz & 0xff00)
-            compressed |= 8;
-        if (dz & 0xf0f0)
-            compressed |= 4;
-        if (dz & 0xcccc)
-            compressed |= 2;
-        if (dz & 0xaaaa)
-            compressed |= 1;
-        return compressed;
-    }
+        s = tile_wrap_s(td, s);
+        t = tile_wrap_t(td, t);
 
-    uint16_t RDP::dz_decompress(uint8_t dz_c)
-    {
-        return 1 << dz_c;
+        switch (td.size)
+        {
+            case 4:
+            {
+                uint16_t address = (td.tmem_address + (t * td.line_width) + s / 2) & 0xFFF;
+                return (address << 1) | (s & 1);
+            }
+            case 8:
+            {
+                return (td.tmem_address + (t * td.line_width) + s) & 0xFFF;
+            }
+            default:
+            {
+                uint32_t index = (td.tmem_address + (t * td.line_width) + s * 2) & 0xFFF;
+                if (t & 1)
+                {
+                    index ^= cache.odd_line_swap;
+                }
+                return index;
+            }
+        }
     }
 
     void RDP::fetch_texels(int texel, int tile, int32_t s, int32_t t)
     {
-        TileDescriptor& td = tiles_[tile];
-        if (td.clamp_s)
+        if (!texel_caches_[tile].valid)
         {
-            auto max_s = ((td.sh >> 2) - (td.sl >> 2)) & 0x3ff;
-            s = std::clamp(s, 0, max_s);
+            setup_texel_cache(tile);
         }
-        else if (td.mirror_s)
-        {
-            s = ((s & (td.mask_s + 1)) ? -s : s) & td.mask_s;
-        }
-        else
-            s &= td.mask_s;
-        if (td.clamp_t)
+
+        if (!texel_caches_[tile].supported)
         {
-            auto max_t = ((td.th >> 2) - (td.tl >> 2)) & 0x3ff;
-            t = std::clamp(t, 0, max_t);
+            return;
         }
-        else if (td.mirror_t)
+
+        uint32_t color = cached_texel(tile, s, t);
+        texel_color_[texel] = color;
+        texel_alpha_[texel] = (color >> 24) * 0x01010101;
+    }
+
+    // The cache has to be set up and supported
+    hydra_inline uint32_t RDP::cached_texel(int tile, int32_t s, int32_t t)
+    {
+        const TileDescriptor& td = tiles_[tile];
+        TexelCache& cache = texel_caches_[tile];
+        uint32_t index = texel_cache_index(td, cache, s, t);
+        uint32_t word = td.size == 4 ? index >> 4 : index >> 3;
+        if (!cache.decoded[word]) [[unlikely]]
         {
-            t = ((t & (td.mask_t + 1)) ? -t : t) & td.mask_t;
+            decode_texel_row(tile, word);
         }
-        else
-            t &= td.mask_t;
+        return cache.texels[index];
+    }
+
+    void RDP::setup_texel_cache(int tile)
+    {
+        const TileDescriptor& td = tiles_[tile];
+        TexelCache& cache = texel_caches_[tile];
+        cache.valid = true;
+        cache.decoded.reset();
+        cache.odd_line_swap = 0;
+        cache.decoder = TexelDecoder::None;
+
         switch (td.format)
         {
             case Format::RGBA:
@@ -1202,32 +1508,15 @@ namespace hydra::N64
                 switch (td.size)
                 {
                     case 16:
-                    {
-                        uint16_t address = (td.tmem_address + (t * td.line_width) + s * 2) & 0xFFF;
-                        uint8_t byte1 = tmem_[address & 0xFFF];
-                        uint8_t byte2 = tmem_[(address + 1) & 0xFFF];
-                        texel_color_[texel] = rgba16_to_rgba32((byte1 << 8) | byte2);
-                        uint8_t alpha = texel_color_[texel] >> 24;
-                        texel_alpha_[texel] = (alpha << 24) | (alpha << 16) | (alpha << 8) | alpha;
+                        cache.decoder = TexelDecoder::RGBA16;
                         break;
-                    }
                     case 32:
-                    {
-                        uint16_t address = (td.tmem_address + (t * td.line_width) + s * 2) & 0xFFF;
-                        uint8_t byte1 = tmem_[address & 0xFFF];
-                        uint8_t byte2 = tmem_[(address + 1) & 0xFFF];
-                        uint8_t byte3 = tmem_[(address + 2) & 0xFFF];
-                        uint8_t byte4 = tmem_[(address + 3) & 0xFFF];
-                        texel_color_[texel] = (byte1 << 24) | (byte2 << 16) | (byte3 << 8) | byte4;
-                        texel_alpha_[texel] = (byte1 << 24) | (byte1 << 16) | (byte1 << 8) | byte1;
+                        cache.decoder = TexelDecoder::RGBA32;
                         break;
-                    }
                     default:
-                    {
                         Logger::WarnOnce("Unimplemented texture size for RGBA: {}",
                                          static_cast<int>(td.size));
                         break;
-                    }
                 }
                 break;
             }
@@ -1236,46 +1525,19 @@ namespace hydra::N64
                 switch (td.size)
                 {
                     case 4:
-                    {
-                        uint16_t address = (td.tmem_address + (t * td.line_width) + s / 2) & 0xFFF;
-                        uint8_t ia = tmem_[address & 0xFFF];
-                        ia = (s & 1) ? (ia & 0xF) : (ia >> 4);
-                        uint8_t i = ia & 0xE;
-                        i = (i << 4) | (i << 1) | (i >> 2);
-                        uint8_t a = (ia & 0x1) ? 0xFF : 0;
-                        texel_color_[texel] = (a << 24) | (i << 16) | (i << 8) | i;
-                        texel_alpha_[texel] = (a << 24) | (a << 16) | (a << 8) | a;
+                        cache.decoder = TexelDecoder::IA4;
                         break;
-                    }
                     case 8:
-                    {
-                        uint16_t address = (td.tmem_address + (t * td.line_width) + s) & 0xFFF;
-                        uint8_t ia = tmem_[address & 0xFFF];
-                        uint8_t i = (ia >> 4) | (ia & 0xF0);
-                        uint8_t a = (ia & 0xF) | (ia << 4);
-                        texel_color_[texel] = (a << 24) | (i << 16) | (i << 8) | i;
-                        texel_alpha_[texel] = (a << 24) | (a << 16) | (a << 8) | a;
+                        cache.decoder = TexelDecoder::IA8;
                         break;
-                    }
                     case 16:
-                    {
-                        uint16_t address = (td.tmem_address + (t * td.line_width) + s * 2) & 0xFFF;
-                        if (t & 1)
-                        {
-                            address ^= 0b10;
-                        }
-                        uint8_t i = tmem_[address & 0xFFF];
-                        uint8_t a = tmem_[(address + 1) & 0xFFF];
-                        texel_color_[texel] = (a << 24) | (i << 16) | (i << 8) | i;
-                        texel_alpha_[texel] = (a << 24) | (a << 16) | (a << 8) | a;
+                        cache.decoder = TexelDecoder::IA16;
+                        cache.odd_line_swap = 0b10;
                         break;
-                    }
                     default:
-                    {
                         Logger::WarnOnce("Unimplemented texture size for IA: {}",
                                          static_cast<int>(td.size));
                         break;
-                    }
                 }
                 break;
             }
@@ -1284,41 +1546,169 @@ namespace hydra::N64
                 switch (td.size)
                 {
                     case 4:
-                    {
-                        uint16_t address = (td.tmem_address + (t * td.line_width) + s / 2) & 0xFFF;
-                        uint8_t i = tmem_[address & 0xFFF];
-                        if (s & 1)
-                        {
-                            i &= 0xF;
-                        }
-                        else
-                        {
-                            i >>= 4;
-                        }
-                        texel_color_[texel] = (i << 24) | (i << 16) | (i << 8) | i;
-                        texel_alpha_[texel] = texel_color_[texel];
+                        cache.decoder = TexelDecoder::I4;
                         break;
-                    }
                     case 8:
-                    {
-                        uint16_t address = (td.tmem_address + (t * td.line_width) + s) & 0xFFF;
-                        uint8_t i = tmem_[address & 0xFFF];
-                        texel_color_[texel] = (i << 24) | (i << 16) | (i << 8) | i;
-                        texel_alpha_[texel] = texel_color_[texel];
+                        cache.decoder = TexelDecoder::I8;
                         break;
-                    }
                     default:
-                    {
                         Logger::WarnOnce("Unimplemented texture size for I: {}",
                                          static_cast<int>(td.size));
                         break;
-                    }
                 }
                 break;
             }
             default:
             {
                 Logger::WarnOnce("Unimplemented texture format: {}", static_cast<int>(td.format));
+                break;
+            }
+        }
+
+        // Fetching from unimplemented formats leaves the previous texel in place
+        cache.supported = cache.decoder != TexelDecoder::None;
+        if (cache.supported)
+        {
+            cache.texels.resize(td.size == 4 ? 0x2000 : 0x1000);
+        }
+    }
+
+    // Decodes the line of the tile that the TMEM word is in, a texture is mostly sampled along
+    // its lines. Tiles without a line width only get the word itself decoded
+    void RDP::decode_texel_row(int tile, uint32_t word)
+    {
+        const TileDescriptor& td = tiles_[tile];
+        TexelCache& cache = texel_caches_[tile];
+        uint32_t start = word * 8;
+        uint32_t length = 8;
+        if (td.line_width != 0)
+        {
+            uint32_t offset = (start - td.tmem_address) & 0xFFF;
+            start = td.tmem_address + offset - offset % td.line_width;
+            length = td.line_width;
+        }
+
+        uint32_t first = start >> 3;
+        uint32_t last = (start + length + 7) >> 3;
+        for (uint32_t i = first; i < last; i++)
+        {
+            uint32_t current = i & 511;
+            if (!cache.decoded[current])
+            {
+                decode_texel_word(cache, current);
+                cache.decoded[current] = true;
+            }
+        }
+    }
+
+    void RDP::decode_texel_word(TexelCache& cache, uint32_t word)
+    {
+        // Entries are indexed by TMEM byte address (doubled for 4-bit texels, so that each
+        // nibble gets its own entry). Texels of 16 and 32-bit formats read past their word
+        auto& texels = cache.texels;
+        auto tmem = [this](uint32_t address) -> uint32_t { return tmem_[address & 0xFFF]; };
+        uint32_t start = word * 8;
+        uint32_t end = start + 8;
+
+        switch (cache.decoder)
+        {
+            case TexelDecoder::RGBA16:
+            {
+                for (uint32_t address = start; address < end; address++)
+                {
+                    texels[address] = rgba16_to_rgba32((tmem(address) << 8) | tmem(address + 1));
+                }
+                break;
+            }
+            case TexelDecoder::RGBA32:
+            {
+                for (uint32_t address = start; address < end; address++)
+                {
+                    texels[address] = (tmem(address) << 24) | (tmem(address + 1) << 16) |
+                                      (tmem(address + 2) << 8) | tmem(address + 3);
+                }
+                break;
+            }
+            case TexelDecoder::IA4:
+            {
+                for (uint32_t index = start * 2; index < end * 2; index++)
+                {
+                    uint8_t ia = tmem(index >> 1);
+                    ia = (index & 1) ? (ia & 0xF) : (ia >> 4);
+                    uint8_t i = ia & 0xE;
+                    i = (i << 4) | (i << 1) | (i >> 2);
+                    uint8_t a = (ia & 0x1) ? 0xFF : 0;
+                    texels[index] = (a << 24) | (i << 16) | (i << 8) | i;
+                }
+                break;
+            }
+            case TexelDecoder::IA8:
+            {
+                for (uint32_t address = start; address < end; address++)
+                {
+                    uint8_t ia = tmem(address);
+                    uint8_t i = (ia >> 4) | (ia & 0xF0);
+                    uint8_t a = (ia & 0xF) | (ia << 4);
+                    texels[address] = (a << 24) | (i << 16) | (i << 8) | i;
+                }
+                break;
+            }
+            case TexelDecoder::IA16:
+            {
+                for (uint32_t address = start; address < end; address++)
+                {
+                    uint8_t i = tmem(address);
+                    uint8_t a = tmem(address + 1);
+                    texels[address] = (a << 24) | (i << 16) | (i << 8) | i;
+                }
+                break;
+            }
+            case TexelDecoder::I4:
+            {
+                for (uint32_t index = start * 2; index < end * 2; index++)
+                {
+                    uint8_t i = tmem(index >> 1);
+                    i = (index & 1) ? (i & 0xF) : (i >> 4);
+                    texels[index] = (i << 24) | (i << 16) | (i << 8) | i;
+                }
+                break;
+            }
+            case TexelDecoder::I8:
+            {
+                for (uint32_t address = start; address < end; address++)
+                {
+                    uint8_t i = tmem(address);
+                    texels[address] = (i << 24) | (i << 16) | (i << 8) | i;
+                }
+                break;
+            }
+            case TexelDecoder::None:
+            {
+                break;
+            }
+        }
+    }
+
+    void RDP::invalidate_texel_caches()
+    {
+        for (auto& cache : texel_caches_)
+        {
+            cache.valid = false;
+        }
+    }
+
+    void RDP::invalidate_texel_caches(uint32_t start, uint32_t end)
+    {
+        // Texels up to 3 bytes before the range read into it. Words are counted from 512 on so
+        // that the one before word 0 wraps around to the end of TMEM
+        uint32_t first = (start + 0x1000 - 3) >> 3;
+        uint32_t last = (std::max(start, end) + 0x1000 + 7) >> 3;
+        uint32_t count = std::min(last - first, 512u);
+        for (auto& cache : texel_caches_)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                cache.decoded[(first + i) & 511] = false;
             }
         }
     }
@@ -1400,23 +1790,16 @@ namespace hydra::N64
             default:
             {
                 Logger::WarnOnce("Unimplemented LoadTile command with size: {}", td.size);
-                break;
+                return;
             }
         }
-    }
-
-    void RDP::init_depth_luts()
-    {
-        for (int i = 0; i < 0x4000; i++)
-        {
-            z_decompress_lut_[i] = z_decompress(i);
-        }
 
-        for (int i = 0; i < 0x40000; i++)
+        // Every line is written from the tile's TMEM address on, 32-bit texels take 4 bytes
+        if (y_end >= y_start && x_end >= x_start)
         {
-            // the 2 lower bits along with 2 more from the rdrams 9th bit
-            // are used to store the depth delta
-            z_compress_lut_[i] = z_compress(i) << 2;
+            invalidate_texel_caches(td.tmem_address, td.tmem_address +
+                                                         (y_end - y_start) * td.line_width +
+                                                         (x_end - x_start + 1) * 4);
         }
     }
 
@@ -1957,7 +2340,31 @@ namespace hydra::N64
 
     void RDP::compute_coverage(const Span& span)
     {
-        std::memset(&coverage_mask_buffer_, 0xFFFF, sizeof(coverage_mask_buffer_));
+        if (span.min_x > span.max_x)
+        {
+            coverage_full_start_ = coverage_full_end_ = 0;
+            return;
+        }
+
+        // Only pixels up to the rightmost left edge or from the leftmost right edge can be
+        // partially covered, the ones in between are left out of the buffer
+        int32_t left_end = span.min_x - 1;
+        int32_t right_start = span.max_x + 1;
+        for (int subpixel = 0; subpixel < 4; subpixel++)
+        {
+            left_end = std::max<int32_t>(left_end, span.min_x_subpixel[subpixel] >> 3);
+            right_start = std::min<int32_t>(right_start, span.max_x_subpixel[subpixel] >> 3);
+        }
+        left_end = std::min(left_end, span.max_x);
+        right_start = std::max(right_start, span.min_x);
+        coverage_full_start_ = left_end;
+        coverage_full_end_ = right_start;
+
+        auto buffer = coverage_mask_buffer_.begin();
+        std::fill(buffer + span.min_x, buffer + left_end + 1, 0xFFFF);
+        std::fill(buffer + right_start, buffer + span.max_x + 1, 0xFFFF);
+
+        auto in_span = [&span](int x) { return x >= span.min_x && x <= span.max_x; };
 
         for (int subpixel = 0; subpixel < 4; subpixel++)
         {
@@ -1970,12 +2377,12 @@ namespace hydra::N64
             auto current_left = span.min_x_subpixel[subpixel];
             auto current_left_int = current_left >> 3;
 
-            for (int i = span.min_x; i <= current_left_int; i++)
+            for (int i = span.min_x; i <= std::min<int>(current_left_int, span.max_x); i++)
             {
                 coverage_mask_buffer_[i] &= ~(mask << shift);
             }
 
-            for (int i = span.max_x; i >= current_right_int; i--)
+            for (int i = span.max_x; i >= std::max<int>(current_right_int, span.min_x); i--)
             {
                 coverage_mask_buffer_[i] &= ~(mask << shift);
             }
@@ -2000,14 +2407,33 @@ namespace hydra::N64
 
             if (current_right_int == current_left_int)
             {
-                coverage_mask_buffer_[current_right_int] |= (coverage_left & coverage_right)
-                                                            << shift;
+                if (in_span(current_right_int))
+                {
+                    coverage_mask_buffer_[current_right_int] |= (coverage_left & coverage_right)
+                                                                << shift;
+                }
                 continue;
             }
 
-            coverage_mask_buffer_[current_right_int] |= coverage_right << shift;
-            coverage_mask_buffer_[current_left_int] |= coverage_left << shift;
+            if (in_span(current_right_int))
+            {
+                coverage_mask_buffer_[current_right_int] |= coverage_right << shift;
+            }
+
+            if (in_span(current_left_int))
+            {
+                coverage_mask_buffer_[current_left_int] |= coverage_left << shift;
+            }
+        }
+    }
+
+    uint16_t RDP::coverage_mask(int x)
+    {
+        if (x > coverage_full_start_ && x < coverage_full_end_)
+        {
+            return 0xFFFF;
         }
+        return coverage_mask_buffer_[x & 0x3ff];
     }
 
     void RDP::render_primitive(const Primitive& primitive)
@@ -2027,12 +2453,20 @@ namespace hydra::N64
             DzPix = primitive_depth_delta_;
         }
 
+        bool simd = simd_spans_ && can_use_simd_spans();
+
         for (int y = primitive.y_start; y <= primitive.y_end; y++)
         {
             const Span& span = primitive.spans[y];
             if (!span.valid)
                 continue;
 
+            pixel_count_ += span.max_x - span.min_x + 1;
+            mark_dirty(y, span.min_x, span.max_x);
+            if (simd && render_span_simd(primitive, span, y,
+                                         z_source_sel_ ? primitive_depth_ : span.z, DzDx, DzPix))
+                continue;
+
             int32_t r = span.r;
             int32_t g = span.g;
             int32_t b = span.b;
@@ -2071,16 +2505,17 @@ namespace hydra::N64
                 get_noise();
 
                 int32_t z_cur = z_correct((z >> 10) & 0x3f'ffff);
-                current_coverage_ = std::popcount(coverage_mask_buffer_[x & 0x3ff] & 0xa5a5u);
+                current_coverage_ = std::popcount(coverage_mask(x) & 0xa5a5u);
                 if (depth_test(x, y, z_cur, DzPix))
                 {
-                    auto [s_cur, t_cur] = perspective_correction_func_(s, t, w);
+                    auto [s_cur, t_cur] = persp_tex_en_ ? PerspectiveCorrection(s, t, w)
+                                                        : no_perspective_correction(s, t);
                     fetch_texels(0, primitive.tile_index, s_cur, t_cur);
                     fetch_texels(1, primitive.tile_index, s_cur, t_cur);
 
                     // 0xA5A5 is the checkerboard pattern the N64 uses as it has only 3 bits to
                     // store coverage
-                    bool cvbit = coverage_mask_buffer_[x & 0x3ff] & 0x8000u;
+                    bool cvbit = coverage_mask(x) & 0x8000u;
                     if (antialias_en_ ? current_coverage_ : cvbit)
                     {
                         draw_pixel(x, y);
@@ -2106,4 +2541,673 @@ namespace hydra::N64
             }
         }
     }
+
+    bool RDP::can_use_simd_spans()
+    {
+        // The kernel covers 1-cycle mode when every combiner input is either constant over the
+        // primitive or interpolated per pixel (shade, texel). The combined color of the previous
+        // pixel and noise are left to the scalar path, as is the unimplemented depth mode
+        if (cycle_type_ != CycleType::Cycle1 ||
+            (framebuffer_pixel_size_ != 16 && framebuffer_pixel_size_ != 32))
+        {
+            return false;
+        }
+
+        if (z_compare_en_ && z_mode_ == 1)
+        {
+            return false;
+        }
+
+        for (uint32_t* input : {color_sub_a_[1], color_sub_b_[1], color_multiplier_[1],
+                                color_adder_[1], alpha_sub_a_[1], alpha_sub_b_[1],
+                                alpha_multiplier_[1], alpha_adder_[1]})
+        {
+            if (input == &combined_color_ || input == &combined_alpha_ || input == &noise_color_)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+#ifdef HYDRA_RDP_AVX2
+    using Lanes = __m256i;
+
+    hydra_avx2 hydra_inline static Lanes lanes_channel(Lanes color, int channel)
+    {
+        return _mm256_and_si256(_mm256_srli_epi32(color, channel * 8), _mm256_set1_epi32(0xFF));
+    }
+
+    hydra_avx2 hydra_inline static Lanes lanes_ramp(int32_t start, int32_t delta, Lanes offsets)
+    {
+        return _mm256_add_epi32(_mm256_set1_epi32(start),
+                                _mm256_mullo_epi32(_mm256_set1_epi32(delta), offsets));
+    }
+
+    // color_clamp on the upper halfword of 8 attributes
+    hydra_avx2 hydra_inline static Lanes lanes_color_clamp(Lanes attribute)
+    {
+        Lanes color = _mm256_srli_epi32(attribute, 16);
+        Lanes select = _mm256_and_si256(_mm256_srli_epi32(color, 7), _mm256_set1_epi32(3));
+        Lanes result = _mm256_and_si256(color, _mm256_set1_epi32(0xFF));
+        result = _mm256_blendv_epi8(result, _mm256_set1_epi32(0xFF),
+                                    _mm256_cmpeq_epi32(select, _mm256_set1_epi32(2)));
+        return _mm256_andnot_si256(_mm256_cmpeq_epi32(select, _mm256_set1_epi32(3)), result);
+    }
+
+    // z_correct((z >> 10) & 0x3f'ffff) on 8 depths
+    hydra_avx2 hydra_inline static Lanes lanes_z_correct(Lanes z)
+    {
+        z = _mm256_srli_epi32(_mm256_srli_epi32(z, 10), 3);
+        Lanes select = _mm256_and_si256(_mm256_srli_epi32(z, 17), _mm256_set1_epi32(3));
+        Lanes result = _mm256_and_si256(z, _mm256_set1_epi32(0x3FFFF));
+        result = _mm256_blendv_epi8(result, _mm256_set1_epi32(0x3FFFF),
+                                    _mm256_cmpeq_epi32(select, _mm256_set1_epi32(2)));
+        return _mm256_andnot_si256(_mm256_cmpeq_epi32(select, _mm256_set1_epi32(3)), result);
+    }
+
+    // combine() on 8 channels. (a - b) * c fits in 17 bits, where x * 0x8081 >> 23 is exactly
+    // x / 0xFF
+    hydra_avx2 hydra_inline static Lanes lanes_combine(Lanes a, Lanes b, Lanes c, Lanes d)
+    {
+        Lanes product = _mm256_mullo_epi32(_mm256_sub_epi32(a, b), c);
+        Lanes quotient = _mm256_srli_epi32(
+            _mm256_mullo_epi32(_mm256_abs_epi32(product), _mm256_set1_epi32(0x8081)), 23);
+        quotient = _mm256_sign_epi32(quotient, product);
+        return _mm256_and_si256(_mm256_add_epi32(quotient, d), _mm256_set1_epi32(0xFF));
+    }
+
+    // PerspectiveCorrection on 8 pixels, with the reciprocals gathered from perspective_lut
+    hydra_avx2 hydra_inline static void lanes_perspective_correction(Lanes s, Lanes t, Lanes w,
+                                                                     Lanes& s_out, Lanes& t_out)
+    {
+        Lanes w_integer = _mm256_srai_epi32(w, 16);
+        Lanes w_positive = _mm256_cmpgt_epi32(w_integer, _mm256_setzero_si256());
+        Lanes index = _mm256_and_si256(w_integer, _mm256_set1_epi32(0x7FFF));
+        Lanes entry = _mm256_i32gather_epi32(reinterpret_cast<const int*>(perspective_lut.data()),
+                                             index, 4);
+        Lanes shift = _mm256_and_si256(entry, _mm256_set1_epi32(0xF));
+        Lanes reciprocal = _mm256_srli_epi32(entry, 4);
+        Lanes right_shift = _mm256_sub_epi32(_mm256_set1_epi32(13), shift);
+        Lanes left_shift = _mm256_cmpeq_epi32(shift, _mm256_set1_epi32(0xE));
+        Lanes overflow_mask = _mm256_and_si256(
+            _mm256_set1_epi32((1 << 30) - 1),
+            _mm256_sub_epi32(_mm256_setzero_si256(),
+                             _mm256_srav_epi32(_mm256_set1_epi32(1 << 29), shift)));
+        Lanes max = _mm256_set1_epi32(PERSPECTIVE_MAX);
+        Lanes min = _mm256_set1_epi32(PERSPECTIVE_MIN);
+        Lanes products[2] = {_mm256_mullo_epi32(_mm256_srai_epi32(s, 16), reciprocal),
+                             _mm256_mullo_epi32(_mm256_srai_epi32(t, 16), reciprocal)};
+        Lanes quotients[2];
+        for (int i = 0; i < 2; i++)
+        {
+            Lanes product = products[i];
+            Lanes shifted = _mm256_srav_epi32(product, right_shift);
+            Lanes quotient =
+                _mm256_blendv_epi8(shifted, _mm256_slli_epi32(product, 1), left_shift);
+            Lanes out_of_bounds = _mm256_and_si256(product, overflow_mask);
+            Lanes in_bounds =
+                _mm256_or_si256(_mm256_cmpeq_epi32(out_of_bounds, _mm256_setzero_si256()),
+                                _mm256_cmpeq_epi32(out_of_bounds, overflow_mask));
+            Lanes sign = _mm256_and_si256(_mm256_blendv_epi8(shifted, product, left_shift),
+                                          _mm256_set1_epi32(1 << 29));
+            Lanes saturated = _mm256_blendv_epi8(
+                max, min, _mm256_cmpeq_epi32(sign, _mm256_set1_epi32(1 << 29)));
+
+            Lanes high_bits = _mm256_and_si256(quotient, _mm256_set1_epi32(0x18000));
+            Lanes result = _mm256_srai_epi32(_mm256_slli_epi32(quotient, 16), 21);
+            result = _mm256_blendv_epi8(
+                result, max, _mm256_cmpeq_epi32(high_bits, _mm256_set1_epi32(0x8000)));
+            result = _mm256_blendv_epi8(
+                result, min, _mm256_cmpeq_epi32(high_bits, _mm256_set1_epi32(0x10000)));
+            result = _mm256_blendv_epi8(saturated, result, in_bounds);
+            quotients[i] = _mm256_blendv_epi8(max, result, w_positive);
+        }
+        s_out = quotients[0];
+        t_out = quotients[1];
+    }
+
+    // Renders one span 8 pixels at a time. Attributes, depth compare, combiner and blender work
+    // on all 8 pixels at once, memory accesses go through the same helpers as the scalar path.
+    // Returns false if the span has to be rendered by the scalar path instead
+    hydra_avx2 bool RDP::render_span_simd(const Primitive& primitive, const Span& span, int y,
+                                          int32_t z, int32_t DzDx, int32_t DzPix)
+    {
+        int32_t x_start = primitive.right_major ? span.min_x : span.max_x;
+        int32_t x_inc = primitive.right_major ? 1 : -1;
+        int count = span.max_x - span.min_x + 1;
+        int pixel_bytes = framebuffer_pixel_size_ >> 3;
+
+        if (z_compare_en_ || z_update_en_)
+        {
+            // Pixels are read and written in batches, so the depth of a pixel must not alias
+            // the color of another one
+            int64_t row = static_cast<int64_t>(y) * framebuffer_width_;
+            int64_t color_start = framebuffer_dram_address_ + (row + span.min_x) * pixel_bytes;
+            int64_t color_end = framebuffer_dram_address_ + (row + span.max_x + 1) * pixel_bytes;
+            int64_t depth_start = zbuffer_dram_address_ + (row + span.min_x) * 2;
+            int64_t depth_end = zbuffer_dram_address_ + (row + span.max_x + 1) * 2;
+            bool same_pixels = pixel_bytes == 2 && color_start == depth_start;
+            if (color_start < depth_end && depth_start < color_end && !same_pixels)
+            {
+                return false;
+            }
+        }
+
+        compute_coverage(span);
+
+        int tile = primitive.tile_index;
+        TexelCache& cache = texel_caches_[tile];
+
+        Lanes lane_offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                                _mm256_set1_epi32(x_inc));
+        Lanes r = lanes_ramp(span.r, primitive.DrDx, lane_offsets);
+        Lanes g = lanes_ramp(span.g, primitive.DgDx, lane_offsets);
+        Lanes b = lanes_ramp(span.b, primitive.DbDx, lane_offsets);
+        Lanes a = lanes_ramp(span.a, primitive.DaDx, lane_offsets);
+        Lanes s = lanes_ramp(span.s, primitive.DsDx, lane_offsets);
+        Lanes t = lanes_ramp(span.t, primitive.DtDx, lane_offsets);
+        Lanes w = lanes_ramp(span.w, primitive.DwDx, lane_offsets);
+        Lanes zs = lanes_ramp(z, DzDx, lane_offsets);
+        // Lambdas don't inherit the target attribute, so this one stays scalar
+        auto step = [x_inc](int32_t delta) {
+            return static_cast<int32_t>(static_cast<uint32_t>(delta) * x_inc * 8);
+        };
+        Lanes r_step = _mm256_set1_epi32(step(primitive.DrDx));
+        Lanes g_step = _mm256_set1_epi32(step(primitive.DgDx));
+        Lanes b_step = _mm256_set1_epi32(step(primitive.DbDx));
+        Lanes a_step = _mm256_set1_epi32(step(primitive.DaDx));
+        Lanes s_step = _mm256_set1_epi32(step(primitive.DsDx));
+        Lanes t_step = _mm256_set1_epi32(step(primitive.DtDx));
+        Lanes w_step = _mm256_set1_epi32(step(primitive.DwDx));
+        Lanes z_step = _mm256_set1_epi32(step(DzDx));
+
+        Lanes dz = _mm256_set1_epi32(static_cast<int16_t>(DzPix));
+        Lanes zero = _mm256_setzero_si256();
+        Lanes ones = _mm256_set1_epi32(-1);
+        Lanes byte_mask = _mm256_set1_epi32(0xFF);
+        Lanes lane_index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+        alignas(32) uint32_t shade[8]{}, shade_alpha[8]{}, z_cur[8]{};
+        alignas(32) int32_t s_texel[8]{}, t_texel[8]{};
+        alignas(32) uint32_t coverage[8]{}, cvbit[8]{}, old_coverage[8]{}, old_z[8]{}, old_dz[8]{};
+        alignas(32) uint32_t texel[8]{}, framebuffer[8]{}, combined[8]{}, blended[8]{};
+        uint32_t overflow_bits = 0;
+
+        // Pipeline state left behind by the last pixels, as the scalar path would leave it
+        int last_passed = -1, last_drawn = -1;
+        uint32_t last_texel = 0, last_combined = 0, last_framebuffer = 0;
+
+        for (int first = 0; first < count; first += 8)
+        {
+            int active = std::min(count - first, 8);
+            Lanes active_mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(active), lane_index);
+
+            Lanes r8 = lanes_color_clamp(r);
+            Lanes g8 = lanes_color_clamp(g);
+            Lanes b8 = lanes_color_clamp(b);
+            Lanes a8 = lanes_color_clamp(a);
+            Lanes shade_v = _mm256_or_si256(
+                _mm256_or_si256(r8, _mm256_slli_epi32(g8, 8)),
+                _mm256_or_si256(_mm256_slli_epi32(b8, 16), _mm256_slli_epi32(a8, 24)));
+            Lanes shade_alpha_v = _mm256_mullo_epi32(a8, _mm256_set1_epi32(0x01010101));
+            Lanes z_v = lanes_z_correct(zs);
+            _mm256_store_si256(reinterpret_cast<Lanes*>(shade), shade_v);
+            _mm256_store_si256(reinterpret_cast<Lanes*>(shade_alpha), shade_alpha_v);
+            _mm256_store_si256(reinterpret_cast<Lanes*>(z_cur), z_v);
+            Lanes s_texel_v, t_texel_v;
+            if (persp_tex_en_)
+            {
+                lanes_perspective_correction(s, t, w, s_texel_v, t_texel_v);
+            }
+            else
+            {
+                s_texel_v = _mm256_srai_epi32(s, 16);
+                t_texel_v = _mm256_srai_epi32(t, 16);
+            }
+            _mm256_store_si256(reinterpret_cast<Lanes*>(s_texel), s_texel_v);
+            _mm256_store_si256(reinterpret_cast<Lanes*>(t_texel), t_texel_v);
+
+            for (int i = 0; i < active; i++)
+            {
+                int x = x_start + (first + i) * x_inc;
+                uint16_t mask = coverage_mask(x);
+                coverage[i] = std::popcount(mask & 0xa5a5u);
+                cvbit[i] = (mask & 0x8000u) ? 0xFFFF'FFFF : 0;
+                old_coverage[i] = coverage_get(x, y);
+                if (z_compare_en_)
+                {
+                    old_z[i] = z_get(x, y);
+                    old_dz[i] = static_cast<int16_t>(dz_get(x, y));
+                }
+            }
+
+            Lanes coverage_v = _mm256_load_si256(reinterpret_cast<Lanes*>(coverage));
+            Lanes overflow = _mm256_add_epi32(
+                _mm256_sub_epi32(_mm256_load_si256(reinterpret_cast<Lanes*>(old_coverage)),
+                                 _mm256_set1_epi32(1)),
+                coverage_v);
+            overflow = _mm256_cmpeq_epi32(_mm256_and_si256(overflow, _mm256_set1_epi32(8)),
+                                          _mm256_set1_epi32(8));
+            overflow_bits = _mm256_movemask_ps(_mm256_castsi256_ps(overflow));
+
+            Lanes pass = active_mask;
+            if (z_compare_en_)
+            {
+                Lanes old_z_v = _mm256_load_si256(reinterpret_cast<Lanes*>(old_z));
+                Lanes dz_max =
+                    _mm256_max_epi32(_mm256_load_si256(reinterpret_cast<Lanes*>(old_dz)), dz);
+                Lanes was_max = _mm256_cmpeq_epi32(old_z_v, _mm256_set1_epi32(0x3FFFF));
+                Lanes farther = _mm256_xor_si256(
+                    _mm256_cmpgt_epi32(old_z_v, _mm256_add_epi32(z_v, dz_max)), ones);
+                Lanes nearer = _mm256_xor_si256(
+                    _mm256_cmpgt_epi32(_mm256_sub_epi32(z_v, dz_max), old_z_v), ones);
+                Lanes infront = _mm256_cmpgt_epi32(old_z_v, z_v);
+
+                Lanes depth_pass;
+                switch (z_mode_ & 0b11)
+                {
+                    case 0: // Opaque
+                        depth_pass =
+                            _mm256_or_si256(was_max, _mm256_blendv_epi8(nearer, infront, overflow));
+                        break;
+                    case 2: // Transparent
+                        depth_pass = _mm256_or_si256(was_max, infront);
+                        break;
+                    default: // Decal
+                        depth_pass =
+                            _mm256_andnot_si256(was_max, _mm256_and_si256(farther, nearer));
+                        break;
+                }
+                pass = _mm256_and_si256(pass, depth_pass);
+            }
+
+            Lanes draw = antialias_en_
+                             ? _mm256_xor_si256(_mm256_cmpeq_epi32(coverage_v, zero), ones)
+                             : _mm256_load_si256(reinterpret_cast<Lanes*>(cvbit));
+            draw = _mm256_and_si256(draw, pass);
+            uint32_t pass_bits = _mm256_movemask_ps(_mm256_castsi256_ps(pass));
+            uint32_t draw_bits = _mm256_movemask_ps(_mm256_castsi256_ps(draw));
+
+            if (pass_bits && !cache.valid)
+            {
+                setup_texel_cache(tile);
+            }
+
+            for (uint32_t bits = pass_bits; bits; bits &= bits - 1)
+            {
+                int i = std::countr_zero(bits);
+                int x = x_start + (first + i) * x_inc;
+                if (cache.supported)
+                {
+                    texel[i] = cached_texel(tile, s_texel[i], t_texel[i]);
+                }
+
+                uint8_t* pixel = rdram_ptr_ + framebuffer_dram_address_ +
+                                 (y * framebuffer_width_ + x) * pixel_bytes;
+                if (pixel_bytes == 2)
+                {
+                    framebuffer[i] = rgba16_to_rgba32(*reinterpret_cast<uint16_t*>(pixel));
+                }
+                else
+                {
+                    framebuffer[i] = *reinterpret_cast<uint32_t*>(pixel);
+                }
+            }
+
+            if (draw_bits)
+            {
+                // Texels are interpolated per pixel only if the tile could be decoded, otherwise
+                // the stale ones are used just like in fetch_texels
+                Lanes texel_v = _mm256_load_si256(reinterpret_cast<Lanes*>(texel));
+                Lanes texel_alpha_v = _mm256_mullo_epi32(_mm256_srli_epi32(texel_v, 24),
+                                                         _mm256_set1_epi32(0x01010101));
+                const uint32_t* sources[8] = {
+                    color_sub_a_[1], color_sub_b_[1], color_multiplier_[1], color_adder_[1],
+                    alpha_sub_a_[1], alpha_sub_b_[1], alpha_multiplier_[1], alpha_adder_[1]};
+                Lanes inputs[8];
+                for (int i = 0; i < 8; i++)
+                {
+                    const uint32_t* source = sources[i];
+                    bool texel_color = source == &texel_color_[0] || source == &texel_color_[1];
+                    bool texel_alpha = source == &texel_alpha_[0] || source == &texel_alpha_[1];
+                    if (source == &shade_color_)
+                        inputs[i] = shade_v;
+                    else if (source == &shade_alpha_)
+                        inputs[i] = shade_alpha_v;
+                    else if (cache.supported && texel_color)
+                        inputs[i] = texel_v;
+                    else if (cache.supported && texel_alpha)
+                        inputs[i] = texel_alpha_v;
+                    else
+                        inputs[i] = _mm256_set1_epi32(*source);
+                }
+
+                Lanes channels[3];
+                for (int channel = 0; channel < 3; channel++)
+                {
+                    channels[channel] = lanes_combine(
+                        lanes_channel(inputs[0], channel), lanes_channel(inputs[1], channel),
+                        lanes_channel(inputs[2], channel), lanes_channel(inputs[3], channel));
+                }
+                Lanes alpha = lanes_combine(
+                    lanes_channel(inputs[4], 0), lanes_channel(inputs[5], 0),
+                    lanes_channel(inputs[6], 0), lanes_channel(inputs[7], 0));
+                Lanes combined_v = _mm256_or_si256(
+                    _mm256_or_si256(channels[0], _mm256_slli_epi32(channels[1], 8)),
+                    _mm256_or_si256(_mm256_slli_epi32(channels[2], 16),
+                                    _mm256_slli_epi32(alpha, 24)));
+                _mm256_store_si256(reinterpret_cast<Lanes*>(combined), combined_v);
+
+                Lanes framebuffer_v = _mm256_load_si256(reinterpret_cast<Lanes*>(framebuffer));
+                // Same equation as the scalar blender, with its per pixel inputs as lanes
+                const BlenderEquation& equation = blender_equation_[0];
+                Lanes blender_colors[2];
+                for (int i = 0; i < 2; i++)
+                {
+                    const uint32_t* color = i == 0 ? equation.color1 : equation.color2;
+                    if (color == &combined_color_)
+                        blender_colors[i] = combined_v;
+                    else if (color == &framebuffer_color_)
+                        blender_colors[i] = framebuffer_v;
+                    else
+                        blender_colors[i] = _mm256_set1_epi32(*color);
+                }
+                Lanes color1 = blender_colors[0];
+                Lanes color2 = blender_colors[1];
+                Lanes multiplier1;
+                if (equation.multiplier1 == &combined_alpha_)
+                    multiplier1 = alpha;
+                else if (equation.multiplier1 == &shade_alpha_)
+                    multiplier1 = a8;
+                else
+                    multiplier1 = _mm256_set1_epi32(*equation.multiplier1 >> 24);
+
+                Lanes keep_color2 = color_on_cvg_ ? _mm256_xor_si256(overflow, ones) : zero;
+                Lanes result = zero;
+                switch (equation.op)
+                {
+                    case BlenderEquation::Op::Blend:
+                    case BlenderEquation::Op::Interpolate:
+                    {
+                        Lanes multiplier2 = equation.op == BlenderEquation::Op::Blend
+                                                ? byte_mask
+                                                : _mm256_xor_si256(multiplier1, byte_mask);
+                        // The sums are small enough that a float division truncates to the
+                        // same quotient
+                        __m256 divisor =
+                            _mm256_cvtepi32_ps(_mm256_add_epi32(multiplier1, multiplier2));
+                        for (int channel = 0; channel < 3; channel++)
+                        {
+                            Lanes c1 = lanes_channel(color1, channel);
+                            Lanes c2 = lanes_channel(color2, channel);
+                            Lanes sum = _mm256_add_epi32(_mm256_mullo_epi32(c1, multiplier1),
+                                                         _mm256_mullo_epi32(c2, multiplier2));
+                            Lanes blend = _mm256_cvttps_epi32(
+                                _mm256_div_ps(_mm256_cvtepi32_ps(sum), divisor));
+                            result = _mm256_or_si256(result, _mm256_slli_epi32(blend, channel * 8));
+                        }
+                        break;
+                    }
+                    case BlenderEquation::Op::Color1:
+                    {
+                        Lanes divide_by_zero = _mm256_cmpeq_epi32(multiplier1, zero);
+                        if (_mm256_movemask_ps(_mm256_castsi256_ps(divide_by_zero)) & draw_bits)
+                        {
+                            warn_blender_division_by_zero(0);
+                        }
+                        result = color1;
+                        break;
+                    }
+                    case BlenderEquation::Op::Color2:
+                    {
+                        result = color2;
+                        break;
+                    }
+                }
+                result = _mm256_and_si256(_mm256_blendv_epi8(result, color2, keep_color2),
+                                          _mm256_set1_epi32(0xFF'FFFF));
+                _mm256_store_si256(reinterpret_cast<Lanes*>(blended), result);
+            }
+
+            for (uint32_t bits = pass_bits; bits; bits &= bits - 1)
+            {
+                int i = std::countr_zero(bits);
+                int x = x_start + (first + i) * x_inc;
+                last_passed = first + i;
+                last_texel = texel[i];
+
+                if (draw_bits & (1u << i))
+                {
+                    last_drawn = first + i;
+                    last_combined = combined[i];
+                    last_framebuffer = framebuffer[i];
+                    uint8_t* pixel = rdram_ptr_ + framebuffer_dram_address_ +
+                                     (y * framebuffer_width_ + x) * pixel_bytes;
+                    if (pixel_bytes == 2)
+                    {
+                        *reinterpret_cast<uint16_t*>(pixel) = rgba32_to_rgba16(blended[i]);
+                    }
+                    else
+                    {
+                        *reinterpret_cast<uint32_t*>(pixel) = blended[i];
+                    }
+                }
+
+                coverage_set(x, y, coverage[i]);
+
+                if (z_update_en_)
+                {
+                    z_set(x, y, z_cur[i]);
+                    dz_set(x, y, DzPix);
+                }
+            }
+
+            r = _mm256_add_epi32(r, r_step);
+            g = _mm256_add_epi32(g, g_step);
+            b = _mm256_add_epi32(b, b_step);
+            a = _mm256_add_epi32(a, a_step);
+            s = _mm256_add_epi32(s, s_step);
+            t = _mm256_add_epi32(t, t_step);
+            w = _mm256_add_epi32(w, w_step);
+            zs = _mm256_add_epi32(zs, z_step);
+        }
+
+        int last = (count - 1) & 7;
+        shade_color_ = shade[last];
+        shade_alpha_ = shade_alpha[last];
+        current_coverage_ = coverage[last];
+        old_coverage_ = old_coverage[last];
+        coverage_overflow_ = overflow_bits & (1u << last);
+
+        if (last_passed != -1 && cache.supported)
+        {
+            texel_color_[0] = texel_color_[1] = last_texel;
+            texel_alpha_[0] = texel_alpha_[1] = (last_texel >> 24) * 0x01010101;
+        }
+
+        if (last_drawn != -1)
+        {
+            combined_color_ = last_combined;
+            combined_alpha_ = (last_combined >> 24) * 0x01010101;
+            framebuffer_color_ = last_framebuffer;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            get_noise();
+        }
+
+        return true;
+    }
+#else
+    bool RDP::render_span_simd(const Primitive&, const Span&, int, int32_t, int32_t, int32_t)
+    {
+        return false;
+    }
+#endif
+
+    bool RDP::get_rectangle_bounds(const RectangleCommand& command, int& x_start, int& x_end,
+                                   int& y_start, int& y_end)
+    {
+        // Fill and copy mode rectangles cover whole pixels, including the lower right ones, so
+        // there's no need to walk the edges or compute coverage
+        int32_t xh = std::max<int32_t>(command.xh, scissor_xh_);
+        int32_t xl = std::min<int32_t>(command.xl, scissor_xl_);
+        int32_t yh = std::max<int32_t>(command.yh, scissor_yh_);
+        int32_t yl = std::min<int32_t>(command.yl | 3, scissor_yl_);
+
+        // Spans are clamped to the end of the framebuffer line instead of wrapping around
+        x_start = std::min<int32_t>(xh >> 2, framebuffer_width_ - 1);
+        x_end = std::min<int32_t>(xl >> 2, framebuffer_width_ - 1);
+        y_start = yh >> 2;
+        y_end = (yl - 1) >> 2;
+
+        // Scissors can be wider than the framebuffer, rectangles that start past its right edge
+        // draw nothing rather than being clamped into the last column
+        bool inside_scissor = xh < scissor_xl_ && command.xl >= scissor_xh_;
+        bool inside_framebuffer = (xh >> 2) < framebuffer_width_;
+        return command.xh <= command.xl && inside_scissor && inside_framebuffer && yh < yl;
+    }
+
+    void RDP::fill_rectangle(const std::vector<uint64_t>& data)
+    {
+        RectangleCommand command;
+        command.full = data[0];
+
+        int x_start, x_end, y_start, y_end;
+        if (!get_rectangle_bounds(command, x_start, x_end, y_start, y_end))
+        {
+            return;
+        }
+        pixel_count_ += (x_end - x_start + 1) * (y_end - y_start + 1);
+
+        size_t pixel_bytes = framebuffer_pixel_size_ >> 3;
+        size_t row_bytes = (x_end - x_start + 1) * pixel_bytes;
+
+        // The fill color covers a whole word, in 16bpp odd halfwords take its lower half.
+        // The hidden bits of each halfword are copied from its lowest bit
+        uint32_t word = fill_color_32_;
+        if (framebuffer_pixel_size_ == 16)
+        {
+            word = fill_color_16_1_ | (static_cast<uint32_t>(fill_color_16_0_) << 16);
+        }
+        uint64_t pattern = (static_cast<uint64_t>(word) << 32) | word;
+        uint8_t hidden_first = (fill_color_16_1_ & 1) ? 0b11 : 0;
+        uint8_t hidden_second = (fill_color_16_0_ & 1) ? 0b11 : 0;
+
+        for (int y = y_start; y <= y_end; y++)
+        {
+            uint32_t address =
+                framebuffer_dram_address_ + (y * framebuffer_width_ + x_start) * pixel_bytes;
+            uint8_t* dst = &rdram_ptr_[address];
+
+            uint64_t row_pattern = pattern;
+            uint8_t row_hidden_first = hidden_first, row_hidden_second = hidden_second;
+            if (framebuffer_pixel_size_ == 16 && ((address >> 1) & 1))
+            {
+                row_pattern = std::rotr(pattern, 16);
+                std::swap(row_hidden_first, row_hidden_second);
+            }
+
+            size_t i = 0;
+            for (; i + sizeof(row_pattern) <= row_bytes; i += sizeof(row_pattern))
+            {
+                std::memcpy(dst + i, &row_pattern, sizeof(row_pattern));
+            }
+            std::memcpy(dst + i, &row_pattern, row_bytes - i);
+
+            hidden_bits_.Fill(address, row_bytes / 2, row_hidden_first, row_hidden_second);
+            mark_dirty(y, x_start, x_end);
+        }
+    }
+
+    void RDP::copy_rectangle(const std::vector<uint64_t>& data)
+    {
+        RectangleCommand command;
+        command.full = data[0];
+
+        int x_start, x_end, y_start, y_end;
+        if (!get_rectangle_bounds(command, x_start, x_end, y_start, y_end))
+        {
+            return;
+        }
+        pixel_count_ += (x_end - x_start + 1) * (y_end - y_start + 1);
+
+        const TileDescriptor& td = tiles_[command.tile];
+
+        // Same setup rectangle_get_edgewalker_input and the edgewalker would do, in copy mode
+        // DsDx is divided by 4 as the hardware copies 4 texels per cycle
+        int32_t s_start = (data[1] >> 48) & ~0x3FF;
+        int32_t t_start = (data[1] >> 32) & 0xFFFF;
+        int32_t DsDx = ((static_cast<int16_t>(data[1] >> 16) << 6) >> 2) & ~0x1f;
+        int32_t DtDy = static_cast<int16_t>(data[1]) << 6;
+
+        // 16-bit RGBA texels are copied to the framebuffer as they are
+        bool raw_copy = td.format == Format::RGBA && td.size == 16;
+
+        for (int y = y_start; y <= y_end; y++)
+        {
+            int32_t t = (t_start + DtDy * (y - (command.yh >> 2))) & ~0x3FF;
+            int32_t t_cur = static_cast<int16_t>(t >> 16);
+            uint32_t tmem_row = td.tmem_address + tile_wrap_t(td, t_cur) * td.line_width;
+            uint32_t address = framebuffer_dram_address_ + (y * framebuffer_width_ + x_start) * 2;
+            int32_t s = s_start;
+            int x = x_start;
+            mark_dirty(y, x_start, x_end);
+
+            if (raw_copy)
+            {
+                for (; x + 3 <= x_end; x += 4, address += 8)
+                {
+                    uint64_t texels = 0;
+                    for (int i = 0; i < 4; i++, s += DsDx)
+                    {
+                        int32_t s_cur = tile_wrap_s(td, static_cast<int16_t>(s >> 16));
+                        uint16_t texel_address = (tmem_row + s_cur * 2) & 0xFFF;
+                        uint64_t texel =
+                            (tmem_[texel_address] << 8) | tmem_[(texel_address + 1) & 0xFFF];
+                        texels |= texel << (i * 16);
+                    }
+
+                    // The alpha bit of all 4 texels is checked at once, most copies are either
+                    // fully opaque or don't use alpha compare at all
+                    constexpr uint64_t alpha_bits = 0x0001'0001'0001'0001;
+                    if (!alpha_compare_en_ || (texels & alpha_bits) == alpha_bits)
+                    {
+                        std::memcpy(&rdram_ptr_[address], &texels, sizeof(texels));
+                        for (int i = 0; i < 4; i++)
+                        {
+                            hidden_bits_.Set(address + i * 2, ((texels >> (i * 16)) & 1) * 0b11);
+                        }
+                        continue;
+                    }
+
+                    for (int i = 0; i < 4; i++)
+                    {
+                        uint16_t texel = texels >> (i * 16);
+                        if (texel & 1)
+                        {
+                            std::memcpy(&rdram_ptr_[address + i * 2], &texel, sizeof(texel));
+                            hidden_bits_.Set(address + i * 2, 0b11);
+                        }
+                    }
+                }
+            }
+
+            for (; x <= x_end; x++, address += 2, s += DsDx)
+            {
+                fetch_texels(0, command.tile, static_cast<int16_t>(s >> 16), t_cur);
+                if (alpha_compare_en_ && texel_alpha_[0] == 0)
+                {
+                    continue;
+                }
+
+                uint16_t color = rgba32_to_rgba16(texel_color_[0]);
+                std::memcpy(&rdram_ptr_[address], &color, sizeof(color));
+                hidden_bits_.Set(address, (color & 1) ? 0b11 : 0);
+            }
+        }
+    }
 } // namespace hydra::N64
\ No newline at end of file
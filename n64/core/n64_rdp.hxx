@@ -1,7 +1,13 @@
 #pragma once
 
+#include <bitset>
 #include <cstring>
+#include <memory>
+#include <n64/core/n64_dirty_map.hxx>
+#include <n64/core/n64_hidden_bits.hxx>
+#include <n64/core/n64_rdp_capture.hxx>
 #include <n64/core/n64_types.hxx>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -42,8 +48,6 @@
     X(SetEnvironmentColor, 0x3B, 1)       \
     X(SetFogColor, 0x38, 1)
 
-using persp_func_ptr = std::pair<int32_t, int32_t> (*)(int32_t, int32_t, int32_t);
-
 class N64Debugger;
 class MmioViewer;
 
@@ -51,6 +55,7 @@ namespace hydra::N64
 {
     class RSP;
     union LoadTileCommand;
+    union RectangleCommand;
 
     enum class RDPCommandType {
 #define X(name, opcode, length) name = opcode,
@@ -167,6 +172,71 @@ namespace hydra::N64
 
     enum class CoverageMode { Clamp = 0, Wrap = 1, Zap = 2, Save = 3 };
 
+    enum class TexelDecoder : uint8_t { None, RGBA16, RGBA32, IA4, IA8, IA16, I4, I8 };
+
+    // The TMEM contents as seen through a tile, decoded to RGBA32 a TMEM line at a time as the
+    // tile samples them
+    struct TexelCache
+    {
+        // Indexed by TMEM byte address, 4-bit formats use twice as many entries. Allocated when
+        // the tile is first sampled
+        std::vector<uint32_t> texels;
+        // TMEM words (8 bytes) whose texels are decoded
+        std::bitset<512> decoded;
+        // IA16 swaps the words of odd lines
+        uint32_t odd_line_swap = 0;
+        TexelDecoder decoder = TexelDecoder::None;
+        // The tile's format was looked at since it was last set
+        bool valid = false;
+        bool supported = false;
+    };
+
+    // (a - b) * c + d with its inputs resolved, reduced to what the inputs make it do. Built when
+    // the combine mode or one of the constant inputs changes
+    struct CombinerEquation
+    {
+        enum class Op : uint8_t
+        {
+            Combine,
+            // a * c, when b and d are zero
+            Multiply,
+            // d, when c is zero or a and b are the same input
+            Add,
+            // No input changes during a primitive, the result is in constant
+            Constant,
+        };
+
+        Op op = Op::Add;
+        const uint32_t* a = nullptr;
+        const uint32_t* b = nullptr;
+        const uint32_t* c = nullptr;
+        const uint32_t* d = nullptr;
+        uint32_t constant = 0;
+    };
+
+    // (color1 * m1 + color2 * m2) / (m1 + m2), reduced the same way. Built when the other modes
+    // change
+    struct BlenderEquation
+    {
+        enum class Op : uint8_t
+        {
+            // m2 is 0xFF
+            Blend,
+            // m2 is 0xFF - m1, so the divisor is always 0xFF
+            Interpolate,
+            // m2 is zero
+            Color1,
+            // m1 is zero and m2 isn't
+            Color2,
+        };
+
+        Op op = Op::Color1;
+        const uint32_t* color1 = nullptr;
+        const uint32_t* color2 = nullptr;
+        // m1 in the upper byte
+        const uint32_t* multiplier1 = nullptr;
+    };
+
     class RDP final
     {
     public:
@@ -178,49 +248,98 @@ namespace hydra::N64
             mi_interrupt_ = ptr;
         }
 
+        // Color image rows the RDP writes are marked in it, so the VI knows to convert them
+        void SetDirtyMap(DirtyMap* dirty_map)
+        {
+            dirty_map_ = dirty_map;
+        }
+
         uint32_t ReadWord(uint32_t addr);
         void WriteWord(uint32_t addr, uint32_t data);
         void Reset();
 
+        // Records every command list processed from now on, see n64_rdp_capture.hxx
+        bool StartCapture(const std::string& path);
+        void StopCapture();
+
         // Used for QA
         void SendCommand(const std::vector<uint64_t>& command);
+        // Has no effect if the CPU can't run the SIMD span kernel
+        void SetSimdSpans(bool enabled);
+
+        // Pixels covered by spans and rectangles since the RDP was created
+        uint64_t GetPixelCount() const
+        {
+            return pixel_count_;
+        }
+
+        // The combiner inputs point into the RDP and are picked again from the combine mode,
+        // the texel caches are decoded from TMEM again when used
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("NRDP", 1);
+            ar(status_, start_address_, end_address_, current_address_, zbuffer_dram_address_,
+               framebuffer_dram_address_, framebuffer_width_, framebuffer_format_,
+               framebuffer_pixel_size_);
+            ar(fill_color_32_, fill_color_16_0_, fill_color_16_1_, blend_color_, fog_color_,
+               combined_color_, shade_color_, primitive_color_, texel_color_, texel_alpha_,
+               environment_color_, framebuffer_color_, noise_color_, combined_alpha_,
+               primitive_alpha_, shade_alpha_, environment_alpha_, fog_alpha_, current_coverage_,
+               old_coverage_);
+            ar(combine_mode_, blender_1a_, blender_1b_, blender_2a_, blender_2b_);
+            ar(texture_dram_address_latch_, texture_width_latch_, texture_pixel_size_latch_,
+               texture_format_latch_, tiles_, tmem_, hidden_bits_);
+            uint8_t z_mode = z_mode_;
+            ar(z_update_en_, z_compare_en_, z_source_sel_, image_read_en_, alpha_compare_en_,
+               antialias_en_, color_on_cvg_, persp_tex_en_, coverage_overflow_, cvg_dest_, z_mode,
+               primitive_depth_, primitive_depth_delta_, scissor_xh_, scissor_yh_, scissor_xl_,
+               scissor_yl_, seed_, cycle_type_);
+            if constexpr (Archive::Loading)
+            {
+                z_mode_ = z_mode;
+                set_combine_mode(combine_mode_);
+                compile_blender();
+                invalidate_texel_caches();
+            }
+        }
 
     private:
-        RDPStatus status_;
+        RDPStatus status_{};
         uint8_t* rdram_ptr_ = nullptr;
         uint8_t* spmem_ptr_ = nullptr;
         MIInterrupt* mi_interrupt_ = nullptr;
-        uint32_t start_address_;
-        uint32_t end_address_;
-        uint32_t current_address_;
-
-        uint32_t zbuffer_dram_address_;
-
-        uint32_t framebuffer_dram_address_;
-        uint16_t framebuffer_width_;
-        uint8_t framebuffer_format_;
-        uint8_t framebuffer_pixel_size_;
-
-        uint32_t fill_color_32_;
-        uint16_t fill_color_16_0_, fill_color_16_1_;
-        uint32_t blend_color_;
-        uint32_t fog_color_;
-        uint32_t combined_color_;
-        uint32_t shade_color_;
-        uint32_t primitive_color_;
-        uint32_t texel_color_[2];
-        uint32_t texel_alpha_[2];
-        uint32_t environment_color_;
-        uint32_t framebuffer_color_;
-        uint32_t noise_color_;
-
-        uint32_t combined_alpha_;
-        uint32_t primitive_alpha_;
-        uint32_t shade_alpha_;
-        uint32_t environment_alpha_;
-        uint32_t fog_alpha_;
-        uint32_t current_coverage_;
-        uint32_t old_coverage_;
+        uint32_t start_address_ = 0;
+        uint32_t end_address_ = 0;
+        uint32_t current_address_ = 0;
+
+        uint32_t zbuffer_dram_address_ = 0;
+
+        uint32_t framebuffer_dram_address_ = 0;
+        uint16_t framebuffer_width_ = 0;
+        uint8_t framebuffer_format_ = 0;
+        uint8_t framebuffer_pixel_size_ = 0;
+
+        uint32_t fill_color_32_ = 0;
+        uint16_t fill_color_16_0_ = 0, fill_color_16_1_ = 0;
+        uint32_t blend_color_ = 0;
+        uint32_t fog_color_ = 0;
+        uint32_t combined_color_ = 0;
+        uint32_t shade_color_ = 0;
+        uint32_t primitive_color_ = 0;
+        uint32_t texel_color_[2]{};
+        uint32_t texel_alpha_[2]{};
+        uint32_t environment_color_ = 0;
+        uint32_t framebuffer_color_ = 0;
+        uint32_t noise_color_ = 0;
+
+        uint32_t combined_alpha_ = 0;
+        uint32_t primitive_alpha_ = 0;
+        uint32_t shade_alpha_ = 0;
+        uint32_t environment_alpha_ = 0;
+        uint32_t fog_alpha_ = 0;
+        uint32_t current_coverage_ = 0;
+        uint32_t old_coverage_ = 0;
 
         uint32_t* color_sub_a_[2];
         uint32_t* color_sub_b_[2];
@@ -232,25 +351,36 @@ namespace hydra::N64
         uint32_t* alpha_multiplier_[2];
         uint32_t* alpha_adder_[2];
 
+        // The last SetCombineMode command, the inputs above are picked from it
+        uint64_t combine_mode_ = 0;
+
         uint8_t blender_1a_[2];
         uint8_t blender_1b_[2];
         uint8_t blender_2a_[2];
         uint8_t blender_2b_[2];
 
+        CombinerEquation color_equation_[2];
+        CombinerEquation alpha_equation_[2];
+        BlenderEquation blender_equation_[2];
+
         uint32_t color_zero_ = 0;
         uint32_t color_one_ = 0xFFFF'FFFF;
 
-        uint32_t texture_dram_address_latch_;
-        uint32_t texture_width_latch_;
-        uint32_t texture_pixel_size_latch_;
-        Format texture_format_latch_;
+        uint32_t texture_dram_address_latch_ = 0;
+        uint32_t texture_width_latch_ = 0;
+        uint32_t texture_pixel_size_latch_ = 0;
+        Format texture_format_latch_ = Format::RGBA;
 
-        std::array<TileDescriptor, 8> tiles_;
-        std::array<uint8_t, 4096> tmem_;
-        std::vector<bool> rdram_9th_bit_;
-        std::array<uint32_t, 0x4000> z_decompress_lut_;
-        std::array<uint32_t, 0x40000> z_compress_lut_;
+        std::array<TileDescriptor, 8> tiles_{};
+        std::array<uint8_t, 4096> tmem_{};
+        std::array<TexelCache, 8> texel_caches_;
+        HiddenBits hidden_bits_{0x800000};
+        DirtyMap* dirty_map_ = nullptr;
         std::array<uint16_t, 1024> coverage_mask_buffer_;
+        // Pixels of the current span strictly between these are fully covered and have no entry
+        // in coverage_mask_buffer_
+        int32_t coverage_full_start_ = 0;
+        int32_t coverage_full_end_ = 0;
 
         bool z_update_en_ = false;
         bool z_compare_en_ = false;
@@ -259,6 +389,7 @@ namespace hydra::N64
         bool alpha_compare_en_ = false;
         bool antialias_en_ = false;
         bool color_on_cvg_ = false;
+        bool persp_tex_en_ = false;
         bool coverage_overflow_ = false;
         CoverageMode cvg_dest_ = CoverageMode::Clamp;
         uint8_t z_mode_ : 2 = 0;
@@ -271,31 +402,48 @@ namespace hydra::N64
         uint16_t scissor_yl_ = 0;
 
         uint32_t seed_;
-        persp_func_ptr perspective_correction_func_;
+        bool simd_spans_ = false;
+        uint64_t pixel_count_ = 0;
+
+        std::unique_ptr<RDPCaptureWriter> capture_;
+        // Color and depth images read by the current command list, as address and size
+        std::vector<std::pair<uint32_t, uint32_t>> capture_images_;
 
         enum CycleType { Cycle1, Cycle2, Copy, Fill } cycle_type_;
 
         void process_commands();
         void execute_command(const std::vector<uint64_t>& data);
+        void capture_command(const std::vector<uint64_t>& data);
+        void capture_image(uint32_t address, uint32_t size);
+        void capture_end_command_list();
         void draw_triangle(const std::vector<uint64_t>& data);
         inline void draw_pixel(int x, int y);
+        void mark_dirty(int y, int x_start, int x_end);
         void color_combiner(int cycle);
         uint32_t blender(int cycle);
+        // Shared by the scalar and SIMD blenders, which both use blender_equation_
+        void warn_blender_division_by_zero(int cycle);
+        void set_combine_mode(uint64_t command);
+        void compile_combiner();
+        void compile_blender();
 
         bool depth_test(int x, int y, int32_t z, int16_t dz);
-        inline uint32_t z_get(int x, int y);
-        inline uint16_t dz_get(int x, int y);
-        inline uint8_t coverage_get(int x, int y);
-        inline void z_set(int x, int y, uint32_t z);
-        inline void dz_set(int x, int y, uint16_t dz);
-        inline void coverage_set(int x, int y, uint8_t coverage);
+        hydra_inline uint32_t z_get(int x, int y);
+        hydra_inline uint16_t dz_get(int x, int y);
+        hydra_inline uint8_t coverage_get(int x, int y);
+        hydra_inline void z_set(int x, int y, uint32_t z);
+        hydra_inline void dz_set(int x, int y, uint16_t dz);
+        hydra_inline void coverage_set(int x, int y, uint8_t coverage);
         void compute_coverage(const Span& span);
-        inline uint32_t z_compress(uint32_t z);
-        inline uint32_t z_decompress(uint32_t z);
-        inline uint8_t dz_compress(uint16_t dz);
-        inline uint16_t dz_decompress(uint8_t dz);
-        void init_depth_luts();
+        hydra_inline uint16_t coverage_mask(int x);
         void fetch_texels(int texel, int tile, int32_t s, int32_t t);
+        hydra_inline uint32_t cached_texel(int tile, int32_t s, int32_t t);
+        void setup_texel_cache(int tile);
+        void decode_texel_row(int tile, uint32_t word);
+        void decode_texel_word(TexelCache& cache, uint32_t word);
+        void invalidate_texel_caches();
+        // Drops the decoded texels of TMEM bytes [start, end) from every tile
+        void invalidate_texel_caches(uint32_t start, uint32_t end);
         void get_noise();
         void load_tile(const LoadTileCommand& command);
 
@@ -314,6 +462,14 @@ namespace hydra::N64
 
         Primitive edgewalker(const EdgewalkerInput& data);
         void render_primitive(const Primitive& primitive);
+        bool can_use_simd_spans();
+        bool render_span_simd(const Primitive& primitive, const Span& span, int y, int32_t z,
+                              int32_t DzDx, int32_t DzPix);
+
+        bool get_rectangle_bounds(const RectangleCommand& command, int& x_start, int& x_end,
+                                  int& y_start, int& y_end);
+        void fill_rectangle(const std::vector<uint64_t>& data);
+        void copy_rectangle(const std::vector<uint64_t>& data);
 
         friend class hydra::N64::RSP;
         friend class ::N64Debugger;
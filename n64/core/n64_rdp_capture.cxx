@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cstring>
+#include <log.hxx>
+#include <n64/core/n64_rdp_capture.hxx>
+
+namespace
+{
+    constexpr char capture_magic[8] = {'H', 'Y', 'R', 'D', 'P', 'C', 'A', 'P'};
+    constexpr uint32_t capture_version = 1;
+    // Changed bytes closer than this are stored in the same record, as a record header costs
+    // about as much
+    constexpr uint32_t capture_merge_distance = 16;
+    // The longest RDP command, TriangleShadeTextureDepth
+    constexpr uint8_t capture_max_command_length = 22;
+
+    template <class T>
+    void write_value(std::ofstream& file, T value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <class T>
+    bool read_value(std::ifstream& file, T& value)
+    {
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+} // namespace
+
+namespace hydra::N64
+{
+    RDPCaptureWriter::RDPCaptureWriter(size_t rdram_size) : shadow_(rdram_size) {}
+
+    bool RDPCaptureWriter::Open(const std::string& path)
+    {
+        file_.open(path, std::ios::binary | std::ios::trunc);
+        if (!file_.is_open())
+        {
+            Logger::Warn("Could not open RDP capture file: {}", path);
+            return false;
+        }
+
+        file_.write(capture_magic, sizeof(capture_magic));
+        write_value<uint32_t>(file_, capture_version);
+        write_value<uint32_t>(file_, shadow_.size());
+        return true;
+    }
+
+    void RDPCaptureWriter::WriteMemory(const uint8_t* rdram, uint32_t address, uint32_t size)
+    {
+        if (!clamp_range(address, size))
+        {
+            return;
+        }
+
+        uint32_t i = address;
+        uint32_t end = address + size;
+        while (i < end)
+        {
+            while (i + 8 <= end && std::memcmp(&rdram[i], &shadow_[i], 8) == 0)
+            {
+                i += 8;
+            }
+
+            while (i < end && rdram[i] == shadow_[i])
+            {
+                i++;
+            }
+
+            if (i == end)
+            {
+                break;
+            }
+
+            uint32_t run_start = i;
+            uint32_t equal = 0;
+            while (i < end && equal < capture_merge_distance)
+            {
+                equal = rdram[i] == shadow_[i] ? equal + 1 : 0;
+                i++;
+            }
+
+            write_memory_record(rdram, run_start, i - equal - run_start);
+        }
+    }
+
+    void RDPCaptureWriter::SyncMemory(const uint8_t* rdram, uint32_t address, uint32_t size)
+    {
+        if (clamp_range(address, size))
+        {
+            std::memcpy(&shadow_[address], &rdram[address], size);
+        }
+    }
+
+    void RDPCaptureWriter::WriteCommand(const std::vector<uint64_t>& command)
+    {
+        commands_.push_back(command);
+    }
+
+    void RDPCaptureWriter::EndCommandList()
+    {
+        if (commands_.empty())
+        {
+            return;
+        }
+
+        write_value(file_, RDPCaptureRecordType::Commands);
+        write_value<uint32_t>(file_, commands_.size());
+        for (const auto& command : commands_)
+        {
+            write_value<uint8_t>(file_, command.size());
+            file_.write(reinterpret_cast<const char*>(command.data()),
+                        command.size() * sizeof(uint64_t));
+        }
+        commands_.clear();
+    }
+
+    bool RDPCaptureWriter::clamp_range(uint32_t& address, uint32_t& size) const
+    {
+        if (address >= shadow_.size())
+        {
+            return false;
+        }
+
+        size = std::min<uint32_t>(size, shadow_.size() - address);
+        return size != 0;
+    }
+
+    void RDPCaptureWriter::write_memory_record(const uint8_t* rdram, uint32_t address,
+                                               uint32_t size)
+    {
+        // The commands recorded so far don't depend on these bytes, and may still read the old
+        // ones
+        EndCommandList();
+
+        write_value(file_, RDPCaptureRecordType::Memory);
+        write_value<uint32_t>(file_, address);
+        write_value<uint32_t>(file_, size);
+        file_.write(reinterpret_cast<const char*>(&rdram[address]), size);
+        std::memcpy(&shadow_[address], &rdram[address], size);
+    }
+
+    bool RDPCaptureReader::Open(const std::string& path)
+    {
+        file_.open(path, std::ios::binary);
+        if (!file_.is_open())
+        {
+            Logger::Warn("Could not open RDP capture file: {}", path);
+            return false;
+        }
+
+        file_.seekg(0, std::ios::end);
+        file_size_ = static_cast<uint64_t>(file_.tellg());
+        file_.seekg(0, std::ios::beg);
+
+        char magic[sizeof(capture_magic)];
+        uint32_t version = 0;
+        if (!file_.read(magic, sizeof(magic)) ||
+            std::memcmp(magic, capture_magic, sizeof(magic)) != 0 ||
+            !read_value(file_, version) || !read_value(file_, rdram_size_))
+        {
+            Logger::Warn("Not an RDP capture file: {}", path);
+            return false;
+        }
+
+        if (version != capture_version)
+        {
+            Logger::Warn("Unsupported RDP capture version: {}", version);
+            return false;
+        }
+        return true;
+    }
+
+    bool RDPCaptureReader::Read(RDPCaptureRecord& record)
+    {
+        if (!read_value(file_, record.type))
+        {
+            return false;
+        }
+
+        switch (record.type)
+        {
+            case RDPCaptureRecordType::Memory:
+            {
+                uint32_t size = 0;
+                if (!read_value(file_, record.address) || !read_value(file_, size) ||
+                    record.address > rdram_size_ || size > rdram_size_ - record.address ||
+                    size > bytes_left())
+                {
+                    break;
+                }
+
+                record.bytes.resize(size);
+                return static_cast<bool>(
+                    file_.read(reinterpret_cast<char*>(record.bytes.data()), size));
+            }
+            case RDPCaptureRecordType::Commands:
+            {
+                // Every command takes at least its length and one word
+                uint32_t count = 0;
+                if (!read_value(file_, count) ||
+                    count > bytes_left() / (sizeof(uint8_t) + sizeof(uint64_t)))
+                {
+                    break;
+                }
+
+                record.commands.resize(count);
+                for (auto& command : record.commands)
+                {
+                    uint8_t length = 0;
+                    if (!read_value(file_, length) || length == 0 ||
+                        length > capture_max_command_length)
+                    {
+                        Logger::Warn("Malformed command in RDP capture");
+                        return false;
+                    }
+
+                    command.resize(length);
+                    if (!file_.read(reinterpret_cast<char*>(command.data()),
+                                    length * sizeof(uint64_t)))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        }
+
+        Logger::Warn("Malformed record in RDP capture");
+        return false;
+    }
+
+    uint64_t RDPCaptureReader::bytes_left()
+    {
+        auto position = file_.tellg();
+        if (position < 0 || static_cast<uint64_t>(position) > file_size_)
+        {
+            return 0;
+        }
+        return file_size_ - static_cast<uint64_t>(position);
+    }
+} // namespace hydra::N64
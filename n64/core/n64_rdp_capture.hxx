@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace hydra::N64
+{
+    /**
+        Recording of everything the RDP consumes, so it can be replayed without the CPU or RSP
+
+        A capture is a header followed by records. Command records hold the executed commands
+        in order, a command list is split wherever its later commands need more memory. Memory
+        records hold the RDRAM bytes that the commands after them read: texture loads and the
+        color and depth images. Memory is delta encoded, only the bytes that changed since they
+        were last captured are stored.
+
+        Header: "HYRDPCAP", u32 version, u32 RDRAM size
+        Memory record: u8 type, u32 address, u32 size, u8 bytes[size]
+        Commands record: u8 type, u32 command count, then per command u8 word count, u64 words
+
+        Integers are little endian. Replay starts from a reset RDP and zeroed RDRAM, so captures
+        should start before the game submits its first command list
+    */
+    enum class RDPCaptureRecordType : uint8_t
+    {
+        Memory = 1,
+        Commands = 2,
+    };
+
+    struct RDPCaptureRecord
+    {
+        RDPCaptureRecordType type;
+        uint32_t address = 0;
+        std::vector<uint8_t> bytes;
+        std::vector<std::vector<uint64_t>> commands;
+    };
+
+    class RDPCaptureWriter
+    {
+    public:
+        RDPCaptureWriter(size_t rdram_size);
+        bool Open(const std::string& path);
+
+        // Records the bytes of the range that changed since it was last captured
+        void WriteMemory(const uint8_t* rdram, uint32_t address, uint32_t size);
+        // Marks a range written by the RDP as captured, the replay will produce the same bytes
+        void SyncMemory(const uint8_t* rdram, uint32_t address, uint32_t size);
+        void WriteCommand(const std::vector<uint64_t>& command);
+        void EndCommandList();
+
+    private:
+        std::ofstream file_;
+        std::vector<uint8_t> shadow_;
+        std::vector<std::vector<uint64_t>> commands_;
+
+        bool clamp_range(uint32_t& address, uint32_t& size) const;
+        void write_memory_record(const uint8_t* rdram, uint32_t address, uint32_t size);
+    };
+
+    class RDPCaptureReader
+    {
+    public:
+        bool Open(const std::string& path);
+        // Returns false at the end of the capture or on a malformed record
+        bool Read(RDPCaptureRecord& record);
+
+        uint32_t GetRdramSize() const
+        {
+            return rdram_size_;
+        }
+
+    private:
+        // Bytes of the file after the read position, counts in records are checked against it
+        // before anything is allocated for them
+        uint64_t bytes_left();
+
+        std::ifstream file_;
+        uint64_t file_size_ = 0;
+        uint32_t rdram_size_ = 0;
+    };
+} // namespace hydra::N64
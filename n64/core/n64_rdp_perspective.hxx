@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <compatibility.hxx>
+#include <cstdint>
+#include <utility>
+
+namespace hydra::N64
+{
+    /**
+        Reciprocals of the 15 bit W the RDP divides by, as it looks them up: W is normalised and
+        the reciprocal interpolated from a 64 entry table. The lower 4 bits hold the normalising
+        shift and the 15 bits above them the reciprocal. Shared by every RDP and built at compile
+        time
+    */
+    constexpr auto perspective_lut = [] {
+        constexpr uint16_t points[64] = {
+            0x4000, 0x3f04, 0x3e10, 0x3d22, 0x3c3c, 0x3b5d, 0x3a83, 0x39b1, 0x38e4, 0x381c,
+            0x375a, 0x369d, 0x35e5, 0x3532, 0x3483, 0x33d9, 0x3333, 0x3291, 0x31f4, 0x3159,
+            0x30c3, 0x3030, 0x2fa1, 0x2f15, 0x2e8c, 0x2e06, 0x2d83, 0x2d03, 0x2c86, 0x2c0b,
+            0x2b93, 0x2b1e, 0x2aab, 0x2a3a, 0x29cc, 0x2960, 0x28f6, 0x288e, 0x2828, 0x27c4,
+            0x2762, 0x2702, 0x26a4, 0x2648, 0x25ed, 0x2594, 0x253d, 0x24e7, 0x2492, 0x243f,
+            0x23ee, 0x239e, 0x234f, 0x2302, 0x22b6, 0x226c, 0x2222, 0x21da, 0x2193, 0x214d,
+            0x2108, 0x20c5, 0x2082, 0x2041,
+        };
+        constexpr uint16_t slopes[64] = {
+            0xf03, 0xf0b, 0xf11, 0xf19, 0xf20, 0xf25, 0xf2d, 0xf32, 0xf37, 0xf3d, 0xf42, 0xf47,
+            0xf4c, 0xf50, 0xf55, 0xf59, 0xf5d, 0xf62, 0xf64, 0xf69, 0xf6c, 0xf70, 0xf73, 0xf76,
+            0xf79, 0xf7c, 0xf7f, 0xf82, 0xf84, 0xf87, 0xf8a, 0xf8c, 0xf8e, 0xf91, 0xf93, 0xf95,
+            0xf97, 0xf99, 0xf9b, 0xf9d, 0xf9f, 0xfa1, 0xfa3, 0xfa4, 0xfa6, 0xfa8, 0xfa9, 0xfaa,
+            0xfac, 0xfae, 0xfaf, 0xfb0, 0xfb2, 0xfb3, 0xfb5, 0xfb5, 0xfb7, 0xfb8, 0xfb9, 0xfba,
+            0xfbc, 0xfbc, 0xfbe, 0xfbe,
+        };
+        std::array<uint32_t, 0x8000> lut{};
+        for (int32_t i = 0; i < 0x8000; i++)
+        {
+            int32_t shift = 0;
+            while (shift < 14 && !((i << (shift + 1)) & 0x8000))
+            {
+                shift++;
+            }
+            int32_t normalised = (i << shift) & 0x3FFF;
+            int32_t fraction = (normalised & 0xFF) << 2;
+            int32_t index = normalised >> 8;
+            int32_t slope = (slopes[index] | ~0x3FF) + 1;
+            int32_t reciprocal = (((slope * fraction) >> 10) + points[index]) & 0x7FFF;
+            lut[i] = shift | (reciprocal << 4);
+        }
+        return lut;
+    }();
+
+    // Largest and smallest coordinates a perspective divide can produce, the RDP saturates to
+    // them when the quotient doesn't fit in 16 bits or W isn't positive
+    constexpr int32_t PERSPECTIVE_MAX = 0x7FFF >> 5;
+    constexpr int32_t PERSPECTIVE_MIN = -0x8000 >> 5;
+
+    /**
+        Divides the integer parts of s and t by the one of w like the RDP does, with one
+        reciprocal for both. The quotients are in s10.5
+
+        The divider flags a quotient that doesn't fit as overflowing or underflowing, and W <= 0
+        always as overflowing. Flagged quotients and the ones whose 17 bit result is outside of
+        16 bits are clamped to the largest or smallest coordinate before the texture is sampled
+    */
+    hydra_inline std::pair<int32_t, int32_t> PerspectiveCorrection(int32_t s, int32_t t,
+                                                                   int32_t w)
+    {
+        bool w_carry = static_cast<int16_t>(w >> 16) <= 0;
+        uint32_t entry = perspective_lut[(w >> 16) & 0x7FFF];
+        int32_t shift = entry & 0xF;
+        int32_t reciprocal = entry >> 4;
+        // Bits of the product that have to be all 0s or all 1s for the quotient to fit
+        int32_t overflow_mask = ((1 << 30) - 1) & -((1 << 29) >> shift);
+        auto divide = [=](int32_t coordinate) {
+            int32_t product = static_cast<int16_t>(coordinate >> 16) * reciprocal;
+            int32_t quotient = shift != 0xE ? product >> (13 - shift) : product << 1;
+            int32_t out_of_bounds = product & overflow_mask;
+            if (w_carry)
+            {
+                return PERSPECTIVE_MAX;
+            }
+            if (out_of_bounds != 0 && out_of_bounds != overflow_mask)
+            {
+                int32_t sign = shift != 0xE ? quotient : product;
+                return (sign & (1 << 29)) ? PERSPECTIVE_MIN : PERSPECTIVE_MAX;
+            }
+            switch (quotient & 0x18000)
+            {
+                case 0x8000:
+                    return PERSPECTIVE_MAX;
+                case 0x10000:
+                    return PERSPECTIVE_MIN;
+                default:
+                    return static_cast<int32_t>(static_cast<int16_t>(quotient)) >> 5;
+            }
+        };
+        return {divide(s), divide(t)};
+    }
+} // namespace hydra::N64
@@ -0,0 +1,105 @@
+#include <compatibility.hxx>
+#include <cstring>
+#include <n64/core/n64_rom.hxx>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+// pshufb isn't part of the baseline target flags, the kernel is only used if the CPU has it
+#define HYDRA_ROM_SSSE3
+#define hydra_ssse3 __attribute__((target("ssse3")))
+#endif
+
+#ifdef HYDRA_ROM_SSSE3
+static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+
+// NormalizeRom on 16 bytes at a time, returns how many bytes it went through
+hydra_ssse3 static size_t normalize_rom_ssse3(uint8_t* rom, size_t size,
+                                              hydra::N64::RomFormat format, uint32_t& crc)
+{
+    using hydra::N64::RomFormat;
+    // Masks that bring 16 bytes in each format to big endian
+    __m128i shuffle;
+    switch (format)
+    {
+        case RomFormat::V64:
+            shuffle = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+            break;
+        case RomFormat::N64:
+            shuffle = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+            break;
+        default:
+            shuffle = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+            break;
+    }
+    bool swap = format == RomFormat::V64 || format == RomFormat::N64;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<__m128i*>(rom + i));
+        if (swap)
+        {
+            block = _mm_shuffle_epi8(block, shuffle);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(rom + i), block);
+        }
+        crc = hydra::crc32_u64(crc, _mm_cvtsi128_si64(block));
+        crc = hydra::crc32_u64(crc, _mm_cvtsi128_si64(_mm_unpackhi_epi64(block, block)));
+    }
+    return i;
+}
+#endif
+
+namespace hydra::N64
+{
+    RomFormat DetectRomFormat(const uint8_t* header)
+    {
+        // Every ROM starts with 0x80371240, the PI settings the IPL loads before reading it
+        uint32_t magic;
+        std::memcpy(&magic, header, sizeof(magic));
+        switch (hydra::bswap32(magic))
+        {
+            case 0x80371240:
+                return RomFormat::Z64;
+            case 0x37804012:
+                return RomFormat::V64;
+            case 0x40123780:
+                return RomFormat::N64;
+            default:
+                return RomFormat::Unknown;
+        }
+    }
+
+    uint32_t NormalizeRom(uint8_t* rom, size_t size, RomFormat format)
+    {
+        // The image is converted and checksummed in the same pass, .z64 images are only read
+        // so their pages stay shared with the file
+        uint32_t crc = 0xFFFF'FFFF;
+        size_t i = 0;
+#ifdef HYDRA_ROM_SSSE3
+        if (has_ssse3)
+        {
+            i = normalize_rom_ssse3(rom, size, format, crc);
+        }
+#endif
+        // Dumps are a whole number of words in size, a partial one at the end is left alone
+        for (; i + 4 <= size; i += 4)
+        {
+            uint32_t word;
+            std::memcpy(&word, rom + i, sizeof(word));
+            if (format == RomFormat::V64)
+            {
+                word = ((word & 0x00FF00FF) << 8) | ((word >> 8) & 0x00FF00FF);
+                std::memcpy(rom + i, &word, sizeof(word));
+            }
+            else if (format == RomFormat::N64)
+            {
+                word = hydra::bswap32(word);
+                std::memcpy(rom + i, &word, sizeof(word));
+            }
+            crc = hydra::crc32_u32(crc, word);
+        }
+        for (; i < size; i++)
+        {
+            crc = hydra::crc32_u8(crc, rom[i]);
+        }
+        return crc ^ 0xFFFF'FFFF;
+    }
+} // namespace hydra::N64
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hydra::N64
+{
+    // Byte orders ROM dumps come in, named after their usual extension
+    enum class RomFormat
+    {
+        // Big endian, as the cartridge is read by the console
+        Z64,
+        // Bytes of every halfword swapped
+        V64,
+        // Little endian words
+        N64,
+        Unknown,
+    };
+
+    // Tells the byte order apart from how the first word of the header was stored
+    RomFormat DetectRomFormat(const uint8_t* header);
+
+    // Converts the first `size` bytes of `rom` to the .z64 byte order in place and returns the
+    // CRC32C of the converted bytes. Unknown formats are left as they are
+    uint32_t NormalizeRom(uint8_t* rom, size_t size, RomFormat format);
+} // namespace hydra::N64
@@ -5,6 +5,7 @@
 #include <iostream>
 #include <log.hxx>
 #include <n64/core/n64_addresses.hxx>
+#include <n64/core/n64_dirty_map.hxx>
 #include <n64/core/n64_rdp.hxx>
 #include <n64/core/n64_rsp.hxx>
 #include <sstream>
@@ -205,6 +206,10 @@ namespace hydra::N64
 
         for (uint32_t i = 0; i < row_count + 1; i++)
         {
+            if (dirty_map_)
+            {
+                dirty_map_->Mark(rdram_index, bytes_per_row);
+            }
             for (uint32_t j = 0; j < bytes_per_row; j++)
             {
                 dest[rdram_index++] = source[rsp_index++];
@@ -28,6 +28,7 @@ namespace hydra::N64
     class RCP;
     class RSP;
     class RDP;
+    class DirtyMap;
     using VectorRegister = std::array<uint16_t, 8>;
 
     struct AccumulatorLane
@@ -247,6 +248,20 @@ namespace hydra::N64
             mi_interrupt_ = ptr;
         }
 
+        void SetDirtyMap(DirtyMap* dirty_map)
+        {
+            dirty_map_ = dirty_map;
+        }
+
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("NRSP", 1);
+            ar(mem_, gpr_regs_, vu_regs_, vco_, vcc_, vce_, div_in_, div_out_, div_in_ready_,
+               accumulator_, instruction_, mem_addr_, dma_imem_, rdram_addr_, rd_len_, wr_len_,
+               status_, pc_, next_pc_, semaphore_);
+        }
+
     private:
         using func_ptr = void (*)(RSP*);
 
@@ -413,6 +428,7 @@ namespace hydra::N64
         uint8_t* rdram_ptr_ = nullptr;
         MIInterrupt* mi_interrupt_ = nullptr;
         RDP* rdp_ptr_ = nullptr;
+        DirtyMap* dirty_map_ = nullptr;
 
         friend class hydra::N64::CPU;
         friend class hydra::N64::CPUBus;
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace hydra::N64
+{
+    /**
+        Single producer, single consumer queue of stereo 16-bit frames, between the AI which
+        pushes them as it plays RDRAM back and the audio callback which resamples them in place
+
+        Neither side locks or allocates. The capacity is a power of two so the read and write
+        counters can run freely and only get masked when indexing
+    */
+    class SampleRing
+    {
+    public:
+        SampleRing(size_t capacity) : samples_(capacity * 2), mask_(capacity - 1) {}
+
+        // Producer side, returns false when the consumer fell so far behind the ring is full
+        bool Push(int16_t left, int16_t right)
+        {
+            size_t write = write_.load(std::memory_order_relaxed);
+            if (write - read_.load(std::memory_order_acquire) > mask_)
+            {
+                return false;
+            }
+            size_t index = (write & mask_) * 2;
+            samples_[index] = left;
+            samples_[index + 1] = right;
+            write_.store(write + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side, frames that can be read
+        size_t Size() const
+        {
+            return write_.load(std::memory_order_acquire) - read_.load(std::memory_order_relaxed);
+        }
+
+        // Consumer side, the frames at the read position. `frames` is clamped to the ones
+        // that don't wrap around the end of the ring, the rest are read after a Pop
+        const int16_t* Peek(size_t& frames) const
+        {
+            size_t read = read_.load(std::memory_order_relaxed);
+            size_t contiguous = mask_ + 1 - (read & mask_);
+            if (frames > contiguous)
+            {
+                frames = contiguous;
+            }
+            return &samples_[(read & mask_) * 2];
+        }
+
+        void Pop(size_t frames)
+        {
+            read_.store(read_.load(std::memory_order_relaxed) + frames,
+                        std::memory_order_release);
+        }
+
+    private:
+        std::vector<int16_t> samples_;
+        size_t mask_;
+        // Apart so the two threads don't keep stealing the same cache line from each other
+        alignas(64) std::atomic<size_t> write_{0};
+        alignas(64) std::atomic<size_t> read_{0};
+    };
+} // namespace hydra::N64
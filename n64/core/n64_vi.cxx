@@ -2,14 +2,108 @@
 #include <fmt/format.h>
 #include <log.hxx>
 #include <n64/core/n64_addresses.hxx>
+#include <n64/core/n64_dirty_map.hxx>
 #include <n64/core/n64_types.hxx>
 #include <n64/core/n64_vi.hxx>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+// The row kernel is compiled for AVX2 regardless of the target flags, and only used if the CPU
+// supports it. Everything else falls back to SSE2, which every x86-64 CPU has
+#define HYDRA_VI_AVX2
+#define hydra_avx2 __attribute__((target("avx2")))
+#endif
+
+hydra_inline static uint32_t rgba16_to_rgba32(uint16_t color)
+{
+    uint8_t r = (color >> 11) & 0x1F;
+    uint8_t g = (color >> 6) & 0x1F;
+    uint8_t b = (color >> 1) & 0x1F;
+    r = (r << 3) | (r >> 2);
+    g = (g << 3) | (g >> 2);
+    b = (b << 3) | (b >> 2);
+    return 0xffu << 24 | b << 16 | g << 8 | r;
+}
+
+#ifdef __x86_64__
+// rgba16_to_rgba32 on 8 pixels. In 16-bit lanes x * 0x21 >> 2 is (x << 3) | (x >> 2) for a
+// 5 bit x, then red and green are interleaved with blue and alpha to form the 32-bit pixels
+hydra_inline static void rgba16_to_rgba32_sse2(uint32_t* dst, const uint16_t* src)
+{
+    __m128i colors = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    __m128i mask = _mm_set1_epi16(0x1F);
+    __m128i expand = _mm_set1_epi16(0x21);
+    __m128i r = _mm_srli_epi16(_mm_mullo_epi16(_mm_srli_epi16(colors, 11), expand), 2);
+    __m128i g = _mm_srli_epi16(
+        _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(colors, 6), mask), expand), 2);
+    __m128i b = _mm_srli_epi16(
+        _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(colors, 1), mask), expand), 2);
+    __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+    __m128i ba = _mm_or_si128(b, _mm_set1_epi16(static_cast<int16_t>(0xFF00)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4), _mm_unpackhi_epi16(rg, ba));
+}
+#endif
+
+#ifdef HYDRA_VI_AVX2
+// Same as above on 16 pixels. Unpacking works within 128-bit halves, so the two results hold
+// pixels 0-3 and 8-11, and 4-7 and 12-15
+hydra_avx2 static int rgba16_to_rgba32_avx2(uint32_t* dst, const uint16_t* src, int count)
+{
+    __m256i mask = _mm256_set1_epi16(0x1F);
+    __m256i expand = _mm256_set1_epi16(0x21);
+    __m256i alpha = _mm256_set1_epi16(static_cast<int16_t>(0xFF00));
+    int x = 0;
+    for (; x + 16 <= count; x += 16)
+    {
+        __m256i colors = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x));
+        __m256i r =
+            _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_srli_epi16(colors, 11), expand), 2);
+        __m256i g = _mm256_srli_epi16(
+            _mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi16(colors, 6), mask), expand), 2);
+        __m256i b = _mm256_srli_epi16(
+            _mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi16(colors, 1), mask), expand), 2);
+        __m256i rg = _mm256_or_si256(r, _mm256_slli_epi16(g, 8));
+        __m256i ba = _mm256_or_si256(b, alpha);
+        __m256i low = _mm256_unpacklo_epi16(rg, ba);
+        __m256i high = _mm256_unpackhi_epi16(rg, ba);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x),
+                            _mm256_permute2x128_si256(low, high, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x + 8),
+                            _mm256_permute2x128_si256(low, high, 0x31));
+    }
+    return x;
+}
+
+static const bool has_avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+static void rgba16_to_rgba32_row(uint32_t* dst, const uint16_t* src, int count)
+{
+    int x = 0;
+#ifdef HYDRA_VI_AVX2
+    if (has_avx2)
+    {
+        x = rgba16_to_rgba32_avx2(dst, src, count);
+    }
+#endif
+#ifdef __x86_64__
+    for (; x + 8 <= count; x += 8)
+    {
+        rgba16_to_rgba32_sse2(dst + x, src + x);
+    }
+#endif
+    for (; x < count; x++)
+    {
+        dst[x] = rgba16_to_rgba32(src[x]);
+    }
+}
+
 namespace hydra::N64
 {
     void Vi::Reset()
     {
         vi_v_intr_ = 0x100;
+        full_redraw_ = true;
     }
 
     bool Vi::Redraw()
@@ -22,61 +116,177 @@ namespace hydra::N64
         {
             if (!blacked_out_)
             {
-                std::fill(framebuffer_.begin(), framebuffer_.end(), 0);
+                snapshot_mode_ = 0;
+                output_16bit_ = false;
+                pending_rows_.assign(height_, 1);
                 blacked_out_ = true;
+                full_redraw_ = true;
+                dirty_rows_start_ = 0;
+                dirty_rows_end_ = height_;
+                return true;
             }
-            return true;
+            return false;
         }
         blacked_out_ = false;
         new_width >>= 10;
         new_height >>= 10;
+        if (width_ != static_cast<int>(new_width) || height_ != static_cast<int>(new_height) ||
+            snapshot_mode_ != pixel_mode_)
+        {
+            full_redraw_ = true;
+        }
         width_ = new_width;
         height_ = new_height;
-        size_t new_size = width_ * height_ * 4;
+        snapshot_mode_ = pixel_mode_;
+        output_16bit_ = native_16bit_ && pixel_mode_ == 0b10;
+
+        // Only the raw rows are copied here, converting them is left to whoever presents the
+        // frame so the emulation thread can carry on with the next one
+        size_t pixel_bytes = pixel_mode_ == 0b11 ? 4 : 2;
+        size_t stride = vi_width_ * pixel_bytes;
+        size_t row_bytes = width_ * pixel_bytes;
+        snapshot_.resize(height_ * row_bytes);
+        pending_rows_.resize(height_);
+        bool full = full_redraw_ || !dirty_map_;
+        int first = height_, last = -1;
+        for (int y = 0; y < height_; y++)
+        {
+            if (!full && !dirty_map_->Test(vi_origin_ + y * stride, row_bytes))
+            {
+                continue;
+            }
+            std::memcpy(&snapshot_[y * row_bytes], memory_ptr_ + y * stride, row_bytes);
+            pending_rows_[y] = 1;
+            first = std::min(first, y);
+            last = y;
+        }
+        if (dirty_map_)
+        {
+            dirty_map_->Clear(vi_origin_, (height_ - 1) * stride + row_bytes);
+        }
+        full_redraw_ = false;
+
+        if (last < first)
+        {
+            return false;
+        }
+        if (dirty_rows_start_ == dirty_rows_end_)
+        {
+            dirty_rows_start_ = first;
+            dirty_rows_end_ = last + 1;
+        }
+        else
+        {
+            dirty_rows_start_ = std::min(dirty_rows_start_, first);
+            dirty_rows_end_ = std::max(dirty_rows_end_, last + 1);
+        }
+        return true;
+    }
+
+    std::pair<int, int> Vi::TakeDirtyRows()
+    {
+        // The frontend might have missed some redraws, their rows are merged until it asks
+        int start = std::min(dirty_rows_start_, height_);
+        int end = std::min(dirty_rows_end_, height_);
+        dirty_rows_start_ = dirty_rows_end_ = 0;
+        if (start == end)
+        {
+            return {0, 0};
+        }
+
+        // Rows handed over last time that were never converted go out again, unless they were
+        // copied since. If the frame changed size or format every row was copied anyway
+        HandedOver& last = handed_over_;
+        if (last.width == width_ && last.height == height_ && last.mode == snapshot_mode_ &&
+            last.rows.size() == snapshot_.size())
+        {
+            size_t row_bytes = last.rows.size() / std::max(last.height, 1);
+            int rows = std::min<int>(last.pending.size(), pending_rows_.size());
+            for (int y = 0; y < rows; y++)
+            {
+                if (last.pending[y] && !pending_rows_[y])
+                {
+                    std::memcpy(&snapshot_[y * row_bytes], &last.rows[y * row_bytes], row_bytes);
+                    pending_rows_[y] = 1;
+                    start = std::min(start, y);
+                    end = std::max(end, y + 1);
+                }
+            }
+        }
+
+        // Swapping leaves the emulation side with the old rows, which is fine as only the ones
+        // it copies again are marked
+        std::swap(snapshot_, last.rows);
+        std::swap(pending_rows_, last.pending);
+        std::fill(pending_rows_.begin(), pending_rows_.end(), 0);
+        last.width = width_;
+        last.height = height_;
+        last.mode = snapshot_mode_;
+        last.output_16bit = output_16bit_;
+        return {start, end - start};
+    }
+
+    uint8_t* Vi::GetFramebufferPtr()
+    {
+        HandedOver& frame = handed_over_;
+        size_t new_size = frame.width * frame.height * (frame.output_16bit ? 2 : 4);
         if (framebuffer_.size() != new_size)
         {
             framebuffer_.resize(new_size);
         }
-        switch (pixel_mode_)
+        int rows = std::min<int>(frame.height, frame.pending.size());
+        for (int y = 0; y < rows; y++)
+        {
+            if (frame.pending[y])
+            {
+                convert_row(y);
+                frame.pending[y] = 0;
+            }
+        }
+        framebuffer_ptr_ = framebuffer_.data();
+        return framebuffer_ptr_;
+    }
+
+    int Vi::GetWidth()
+    {
+        return width_;
+    }
+
+    int Vi::GetHeight()
+    {
+        return height_;
+    }
+
+    void Vi::convert_row(int y)
+    {
+        const HandedOver& frame = handed_over_;
+        int width = frame.width;
+        if (frame.output_16bit)
+        {
+            std::memcpy(&framebuffer_[y * width * 2], &frame.rows[y * width * 2], width * 2);
+            return;
+        }
+        uint32_t* dst = reinterpret_cast<uint32_t*>(&framebuffer_[y * width * 4]);
+        switch (frame.mode)
         {
             case 0b11:
             {
-                for (int y = 0; y < height_; y++)
-                {
-                    for (int x = 0; x < width_; x++)
-                    {
-                        uint32_t color =
-                            (reinterpret_cast<uint32_t*>(memory_ptr_))[(y * vi_width_) + x];
-                        set_pixel(x, y, color);
-                    }
-                }
+                // Pixels are already in the byte order the frontend wants
+                std::memcpy(dst, &frame.rows[y * width * 4], width * 4);
                 break;
             }
             case 0b10:
             {
-                for (int y = 0; y < height_; y++)
-                {
-                    for (int x = 0; x < width_; x++)
-                    {
-                        uint16_t color_temp =
-                            (reinterpret_cast<uint16_t*>(memory_ptr_))[(y * vi_width_) + x];
-                        uint8_t r = (color_temp >> 11) & 0x1F;
-                        uint8_t g = (color_temp >> 6) & 0x1F;
-                        uint8_t b = (color_temp >> 1) & 0x1F;
-                        r = (r << 3) | (r >> 2);
-                        g = (g << 3) | (g >> 2);
-                        b = (b << 3) | (b >> 2);
-                        uint32_t color = 0xffu << 24 | b << 16 | g << 8 | r;
-                        set_pixel(x, y, color);
-                    }
-                }
+                rgba16_to_rgba32_row(
+                    dst, reinterpret_cast<const uint16_t*>(&frame.rows[y * width * 2]), width);
                 break;
             }
             default:
+            {
+                std::memset(dst, 0, width * 4);
                 break;
+            }
         }
-        framebuffer_ptr_ = framebuffer_.data();
-        return true;
     }
 
     uint32_t Vi::ReadWord(uint32_t addr)
@@ -162,6 +372,7 @@ namespace hydra::N64
             case VI_CTRL:
             {
                 auto format = data & 0b11;
+                full_redraw_ |= format != pixel_mode_;
                 pixel_mode_ = format;
                 if ((data >> 6) & 0b1)
                 {
@@ -173,12 +384,15 @@ namespace hydra::N64
             case VI_ORIGIN:
             {
                 data &= 0x00FFFFFF;
+                full_redraw_ |= data != vi_origin_;
+                vi_origin_ = data;
                 memory_ptr_ = &rdram_ptr_[data];
                 vis_counter_ += 1;
                 break;
             }
             case VI_WIDTH:
             {
+                full_redraw_ |= data != vi_width_;
                 vi_width_ = data;
                 break;
             }
@@ -231,9 +445,4 @@ namespace hydra::N64
             }
         }
     }
-
-    void Vi::set_pixel(int x, int y, uint32_t color)
-    {
-        memcpy(&framebuffer_[(x + y * width_) * 4], &color, 4);
-    }
 } // namespace hydra::N64
\ No newline at end of file
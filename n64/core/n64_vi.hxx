@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 namespace hydra::N64
@@ -15,11 +16,20 @@ namespace hydra::N64
     class CPU;
     class CPUBus;
     union MIInterrupt;
+    class DirtyMap;
 
     struct Vi
     {
         void Reset();
+        // Called at vsync, copies the framebuffer rows that changed since the last call and
+        // returns false if none did
         bool Redraw();
+        // Hands the rows copied by Redraw since the last call over to the presentation side and
+        // returns the ones that changed, as first row and count. Called under the same lock as
+        // Redraw, the size and format are the ones of the handed over frame until the next one
+        std::pair<int, int> TakeDirtyRows();
+        // Converts the rows handed over by TakeDirtyRows. Only the presentation side touches
+        // them, so it doesn't need to hold the lock the emulation thread runs under
         uint8_t* GetFramebufferPtr();
         int GetWidth();
         int GetHeight();
@@ -36,6 +46,50 @@ namespace hydra::N64
             mi_interrupt_ = mi_interrupt;
         }
 
+        // Without one every row is converted on every redraw
+        void SetDirtyMap(DirtyMap* dirty_map)
+        {
+            dirty_map_ = dirty_map;
+        }
+
+        // Leaves 16-bit framebuffers unconverted, the frontend uploads them as RGBA5551
+        void SetNative16Bit(bool enabled)
+        {
+            full_redraw_ |= enabled != native_16bit_;
+            native_16bit_ = enabled;
+        }
+
+        // RDRAM the last redraw copied the frame from, as address and size. Empty while
+        // blacked out
+        std::pair<uint32_t, size_t> GetFramebufferRange() const
+        {
+            if (snapshot_mode_ == 0 || width_ <= 0 || height_ <= 0)
+            {
+                return {0, 0};
+            }
+            size_t pixel_bytes = snapshot_mode_ == 0b11 ? 4 : 2;
+            return {vi_origin_, ((height_ - 1) * vi_width_ + width_) * pixel_bytes};
+        }
+
+        // The presentation side keeps its copy of the last frame. Everything is only redrawn
+        // if the state shows another framebuffer, CPUBus marks what it changed in this one
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            uint32_t origin = vi_origin_;
+            uint32_t width = vi_width_;
+            ar.Section("N_VI", 1);
+            ar(vi_ctrl_, vi_origin_, vi_width_, vi_v_intr_, vi_v_current_, vi_burst_, vi_v_sync_,
+               vi_h_sync_, vi_h_sync_leap_, vi_h_start_, vi_h_end_, vi_v_start_, vi_v_end_,
+               vi_v_burst_, vi_x_scale_, vi_y_scale_, vi_test_addr_, vi_staged_data_,
+               num_halflines_, cycles_per_halfline_, pixel_mode_);
+            if constexpr (Archive::Loading)
+            {
+                memory_ptr_ = &rdram_ptr_[vi_origin_];
+                full_redraw_ |= vi_origin_ != origin || vi_width_ != width;
+            }
+        }
+
     private:
         uint32_t vi_ctrl_ = 0;
         uint32_t vi_origin_ = 0;
@@ -60,16 +114,41 @@ namespace hydra::N64
         int num_halflines_ = 262;
         int cycles_per_halfline_ = 1000;
         bool blacked_out_ = false;
+        // Set when the converted framebuffer no longer matches the rows it came from, for
+        // example after the origin moved to another buffer
+        bool full_redraw_ = true;
+        int dirty_rows_start_ = 0;
+        int dirty_rows_end_ = 0;
+        bool native_16bit_ = false;
+        // framebuffer_ holds the RGBA5551 pixels as they are instead of converted ones
+        bool output_16bit_ = false;
 
         uint8_t pixel_mode_ = 0;
+        // Rows copied from the framebuffer at vsync, width_ by height_ pixels in the format of
+        // snapshot_mode_ (0 when blacked out). Only the rows marked in pending_rows_ hold
+        // anything, TakeDirtyRows swaps both with the handed over ones
+        uint8_t snapshot_mode_ = 0;
+        std::vector<uint8_t> snapshot_;
+        std::vector<uint8_t> pending_rows_;
+        // The last rows handed over, in the size and format they were copied with. Owned by the
+        // presentation side, which converts the marked rows into framebuffer_
+        struct HandedOver
+        {
+            std::vector<uint8_t> rows;
+            std::vector<uint8_t> pending;
+            int width = 0, height = 0;
+            uint8_t mode = 0;
+            bool output_16bit = false;
+        } handed_over_;
         std::vector<uint8_t> framebuffer_;
         std::vector<uint8_t> framebuffer_black_;
         uint8_t* framebuffer_ptr_ = nullptr;
         uint8_t* memory_ptr_ = nullptr;
         uint8_t* rdram_ptr_ = nullptr;
         MIInterrupt* mi_interrupt_ = nullptr;
+        DirtyMap* dirty_map_ = nullptr;
 
-        inline void set_pixel(int x, int y, uint32_t color);
+        void convert_row(int y);
         friend class hydra::N64::RCP;
         friend class hydra::N64::CPU;
         friend class hydra::N64::CPUBus;
@@ -4,6 +4,7 @@
 #include <fmt/format.h>
 #include <iostream>
 #include <n64/n64_tkpwrapper.hxx>
+#include <state.hxx>
 
 bool is_number(const std::string& s)
 {
@@ -101,19 +102,58 @@ namespace hydra::N64
 
     bool N64_TKPWrapper::load_file(const std::string& path)
     {
+        auto& user_data = EmulatorSettings::GetEmulatorData(EmuType::N64).UserData;
+        bool hle_boot = user_data.Has("HLEBoot") && user_data.Get("HLEBoot") == "true";
         bool ipl_loaded = ipl_loaded_;
-        if (!ipl_loaded)
+        if (!ipl_loaded && !hle_boot)
         {
-            auto ipl_path = EmulatorSettings::GetEmulatorData(EmuType::N64).UserData.Get("IPLPath");
-            if (!std::filesystem::exists(ipl_path))
+            auto ipl_path = user_data.Get("IPLPath");
+            if (std::filesystem::exists(ipl_path))
             {
-                throw std::runtime_error("Missing IPL path!");
+                ipl_loaded = n64_impl_.LoadIPL(ipl_path);
+            }
+            else
+            {
+                Logger::Warn("No IPL found, booting without one");
+                hle_boot = true;
             }
-            bool ipl_status = n64_impl_.LoadIPL(ipl_path);
-            ipl_loaded = ipl_status;
         }
+        n64_impl_.SetHLEBoot(hle_boot);
         bool opened = n64_impl_.LoadCartridge(path);
-        Loaded = opened && ipl_loaded;
+        if (opened)
+        {
+            // Saves are named after the ROM file
+            auto save_dir = EmulatorFactory::GetSavePath() + "n64/";
+            std::filesystem::create_directories(save_dir);
+            n64_impl_.OpenSave(save_dir + std::filesystem::path(path).stem().string(),
+                               !run_ahead_instance_);
+            n64_impl_.SetMuted(run_ahead_instance_);
+        }
+        Loaded = opened && (ipl_loaded || hle_boot);
+        n64_impl_.SetNative16Bit(user_data.Has("Native16BitFramebuffer") &&
+                                 user_data.Get("Native16BitFramebuffer") == "true");
+        // Audio sync unless the setting says otherwise
+        std::string sync_mode = user_data.Has("SyncMode") ? user_data.Get("SyncMode") : "";
+        if (sync_mode == "Video")
+        {
+            n64_impl_.SetSyncMode(N64::SyncMode::Video);
+        }
+        else if (sync_mode == "Unthrottled")
+        {
+            n64_impl_.SetSyncMode(N64::SyncMode::Unthrottled);
+        }
+        else
+        {
+            n64_impl_.SetSyncMode(N64::SyncMode::Audio);
+        }
+        if (Loaded && user_data.Has("RDPCapturePath"))
+        {
+            // Started before the first frame, replays need every command list since reset
+            if (!n64_impl_.StartRDPCapture(user_data.Get("RDPCapturePath")))
+            {
+                Logger::Warn("Failed to start the RDP capture, running without it");
+            }
+        }
         return Loaded;
     }
 
@@ -122,11 +162,25 @@ namespace hydra::N64
         n64_impl_.Reset();
     }
 
+    bool N64_TKPWrapper::save_state(StateWriter& writer)
+    {
+        n64_impl_.Serialize(writer);
+        return true;
+    }
+
+    bool N64_TKPWrapper::load_state(StateReader& reader)
+    {
+        n64_impl_.Serialize(reader);
+        return true;
+    }
+
     void N64_TKPWrapper::update()
     {
         try
         {
+            // Each update runs a whole VI frame
             n64_impl_.Update();
+            end_frame();
         } catch (std::exception& ex)
         {
             fmt::print("{}\n", ex.what());
@@ -135,7 +189,7 @@ namespace hydra::N64
         }
     }
 
-    void N64_TKPWrapper::HandleKeyDown(uint32_t key)
+    void N64_TKPWrapper::handle_key_down(uint32_t key)
     {
         if (key_mappings_.find(key) != key_mappings_.end())
         {
@@ -143,7 +197,7 @@ namespace hydra::N64
         }
     }
 
-    void N64_TKPWrapper::HandleKeyUp(uint32_t key)
+    void N64_TKPWrapper::handle_key_up(uint32_t key)
     {
         if (key_mappings_.find(key) != key_mappings_.end())
         {
@@ -151,7 +205,7 @@ namespace hydra::N64
         }
     }
 
-    void N64_TKPWrapper::HandleMouseMove(int32_t x, int32_t y)
+    void N64_TKPWrapper::handle_mouse_move(int32_t x, int32_t y)
     {
         n64_impl_.SetMousePos(x, y);
     }
@@ -29,7 +29,38 @@ namespace hydra::N64
             return n64_impl_.GetHeight();
         }
 
-        void HandleMouseMove(int32_t, int32_t) override;
+        std::pair<int, int> TakeDirtyRows() override
+        {
+            return n64_impl_.TakeDirtyRows();
+        }
+
+        ScreenFormat GetScreenFormat() override
+        {
+            return n64_impl_.IsColorData16Bit() ? ScreenFormat::RGBA5551 : ScreenFormat::RGBA8888;
+        }
+
+        int GetScreenRowLength() override
+        {
+            return n64_impl_.GetColorDataRowLength();
+        }
+
+        bool HandsOverScreenData() override
+        {
+            return true;
+        }
+
+        void handle_mouse_move(int32_t, int32_t) override;
+        bool save_state(StateWriter& writer) override;
+        bool load_state(StateReader& reader) override;
+
+        void wait_for_next_frame() override
+        {
+            n64_impl_.WaitForNextFrame();
+        }
+        void set_presenting(bool presenting) override
+        {
+            n64_impl_.SetPresenting(presenting);
+        }
 
         std::map<uint32_t, uint32_t> key_mappings_;
 
@@ -19,6 +19,8 @@ class AngrylionReplayerImpl
 public:
     AngrylionReplayerImpl();
     ~AngrylionReplayerImpl();
+    void WriteMemory(uint32_t address, const uint8_t* data, size_t size);
+    void ReadMemory(uint32_t address, uint8_t* data, size_t size) const;
 
 private:
     n64video_config config_ = {};
@@ -30,9 +32,11 @@ private:
 
 std::unique_ptr<AngrylionReplayerImpl> AngrylionReplayer::impl_;
 Framebuffer AngrylionReplayer::framebuffer_;
+int AngrylionReplayer::warnings_ = 0;
 
 void AngrylionReplayer::Init()
 {
+    AngrylionReplayer::warnings_ = 0;
     AngrylionReplayer::impl_ = std::make_unique<AngrylionReplayerImpl>();
 }
 
@@ -47,6 +51,16 @@ void AngrylionReplayer::RunCommand(const std::vector<uint64_t>& command)
     rdp_cmd(0, command32.data());
 }
 
+void AngrylionReplayer::WriteMemory(uint32_t address, const uint8_t* data, size_t size)
+{
+    AngrylionReplayer::impl_->WriteMemory(address, data, size);
+}
+
+void AngrylionReplayer::ReadMemory(uint32_t address, uint8_t* data, size_t size)
+{
+    AngrylionReplayer::impl_->ReadMemory(address, data, size);
+}
+
 Framebuffer AngrylionReplayer::GetFramebuffer()
 {
     n64video_update_screen();
@@ -59,6 +73,11 @@ void AngrylionReplayer::Cleanup()
     AngrylionReplayer::impl_.reset();
 }
 
+int AngrylionReplayer::GetWarnings()
+{
+    return AngrylionReplayer::warnings_;
+}
+
 void vdac_init(struct n64video_config*) {}
 
 void vdac_write(struct frame_buffer* fb)
@@ -83,6 +102,7 @@ void vdac_close() {}
 
 void msg_error(const char* err, ...)
 {
+    AngrylionReplayer::warnings_++;
     va_list va;
     va_start(va, err);
     char buffer[16 * 1024];
@@ -93,6 +113,7 @@ void msg_error(const char* err, ...)
 
 void msg_warning(const char* err, ...)
 {
+    AngrylionReplayer::warnings_++;
     va_list va;
     va_start(va, err);
     char buffer[16 * 1024];
@@ -148,3 +169,20 @@ AngrylionReplayerImpl::~AngrylionReplayerImpl()
 {
     n64video_close();
 }
+
+void AngrylionReplayerImpl::WriteMemory(uint32_t address, const uint8_t* data, size_t size)
+{
+    // angrylion keeps RDRAM as host endian words
+    for (size_t i = 0; i < size && address + i < rdram_.size(); i++)
+    {
+        rdram_[(address + i) ^ 3] = data[i];
+    }
+}
+
+void AngrylionReplayerImpl::ReadMemory(uint32_t address, uint8_t* data, size_t size) const
+{
+    for (size_t i = 0; i < size && address + i < rdram_.size(); i++)
+    {
+        data[i] = rdram_[(address + i) ^ 3];
+    }
+}
@@ -26,9 +26,15 @@ struct AngrylionReplayer
 {
     static void Init();
     static void RunCommand(const std::vector<uint64_t>& command);
+    // Bytes are in N64 (big endian) order
+    static void WriteMemory(uint32_t address, const uint8_t* data, size_t size);
+    static void ReadMemory(uint32_t address, uint8_t* data, size_t size);
     static Framebuffer GetFramebuffer();
     static void Cleanup();
+    // Warnings and errors logged since Init, such as the RDP crashing on invalid modes
+    static int GetWarnings();
 
     static std::unique_ptr<AngrylionReplayerImpl> impl_;
     static Framebuffer framebuffer_;
+    static int warnings_;
 };
\ No newline at end of file
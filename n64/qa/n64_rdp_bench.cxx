@@ -0,0 +1,362 @@
+#include <algorithm>
+#include <chrono>
+#include <fmt/format.h>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <n64/core/n64_rdp.hxx>
+#include <n64/core/n64_rdp_capture.hxx>
+#include <n64/core/n64_rdp_commands.hxx>
+#include <n64/qa/n64_angrylion_replayer.hxx>
+#include <n64/qa/n64_rdp_streams.hxx>
+#include <string>
+#include <vector>
+
+// Times command streams on the RDP, and optionally on angrylion-rdp-plus. The built-in streams
+// are generated from fixed seeds and captures are replayed as they are, so every run renders
+// exactly the same thing. Each stream runs a few times on a fresh RDP and the fastest run is
+// reported.
+//
+// Usage: rdp_bench [--runs N] [--angrylion] [--no-synthetic] [--baseline FILE]
+//                  [--save-baseline FILE] [capture...]
+
+using namespace hydra::N64;
+
+namespace
+{
+    struct CommandTiming
+    {
+        uint64_t count = 0;
+        std::chrono::nanoseconds time{0};
+    };
+
+    struct RunResult
+    {
+        std::chrono::nanoseconds time{0};
+        uint64_t pixels = 0;
+        uint64_t primitives = 0;
+        std::map<uint8_t, CommandTiming> commands;
+    };
+
+    std::string_view command_name(uint8_t id)
+    {
+        switch (id)
+        {
+#define X(name, opcode, length) \
+    case opcode:                \
+        return #name;
+            RDP_COMMANDS
+#undef X
+            default:
+                return "Unknown";
+        }
+    }
+
+    bool is_primitive(uint8_t id)
+    {
+        switch (static_cast<RDPCommandType>(id))
+        {
+            case RDPCommandType::Rectangle:
+            case RDPCommandType::TextureRectangle:
+            case RDPCommandType::TextureRectangleFlip:
+                return true;
+            default:
+                return id >= 0x08 && id <= 0x0F;
+        }
+    }
+
+    bool is_load(uint8_t id)
+    {
+        switch (static_cast<RDPCommandType>(id))
+        {
+            case RDPCommandType::LoadTile:
+            case RDPCommandType::LoadBlock:
+            case RDPCommandType::LoadTLUT:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    uint64_t with_id(uint64_t full, RDPCommandType id)
+    {
+        return full | (static_cast<uint64_t>(id) << 56);
+    }
+
+    std::vector<RDPStream> synthetic_streams()
+    {
+        std::vector<RDPStream> streams;
+
+        {
+            RDPStreamBuilder builder("fill_rectangles", 1);
+            builder.OtherModes(3, false);
+            for (int i = 0; i < 1000; i++)
+            {
+                builder.Add({with_id(static_cast<uint32_t>(builder.Random(0, 0x7FFF'FFFF)),
+                                     RDPCommandType::SetFillColor)});
+                builder.Rectangle(RDPCommandType::Rectangle, 100, 0, 0);
+            }
+            streams.push_back(builder.Build());
+        }
+
+        {
+            RDPStreamBuilder builder("shade_triangles", 2);
+            builder.OtherModes(0, false);
+            builder.CombineMode(8, 8, 31, 4, 7, 7, 7, 4);
+            for (int i = 0; i < 2000; i++)
+            {
+                builder.Triangle(RDPCommandType::TriangleShade, 24);
+            }
+            streams.push_back(builder.Build());
+        }
+
+        {
+            RDPStreamBuilder builder("texture_depth_triangles", 3);
+            builder.OtherModes(0, true);
+            builder.CombineMode(1, 8, 4, 7, 1, 7, 4, 7);
+            for (int i = 0; i < 2000; i++)
+            {
+                if (i % 100 == 0)
+                {
+                    builder.LoadTile(builder.Random(0, 32), builder.Random(0, 32));
+                }
+                builder.Triangle(RDPCommandType::TriangleShadeTextureDepth, 24);
+            }
+            streams.push_back(builder.Build());
+        }
+
+        {
+            RDPStreamBuilder builder("texture_rectangles", 4);
+            builder.OtherModes(0, false);
+            builder.CombineMode(8, 8, 31, 1, 7, 7, 7, 1);
+            for (int i = 0; i < 500; i++)
+            {
+                if (i % 10 == 0)
+                {
+                    builder.LoadTile(builder.Random(0, 32), builder.Random(0, 32));
+                }
+                builder.Rectangle(RDPCommandType::TextureRectangle, 64, 0x400, 0x400);
+            }
+            streams.push_back(builder.Build());
+        }
+
+        {
+            RDPStreamBuilder builder("copy_rectangles", 5);
+            builder.OtherModes(2, false);
+            for (int i = 0; i < 500; i++)
+            {
+                builder.Rectangle(RDPCommandType::TextureRectangle, 64, 0x1000, 0x400);
+            }
+            streams.push_back(builder.Build());
+        }
+
+        return streams;
+    }
+
+    template <class Memory, class Command>
+    RunResult run_stream(const RDPStream& stream, Memory&& memory, Command&& command)
+    {
+        RunResult result;
+        for (const auto& record : stream.records)
+        {
+            if (record.type == RDPCaptureRecordType::Memory)
+            {
+                memory(record.address, record.bytes);
+                continue;
+            }
+
+            // Timing each command costs a few dozen nanoseconds, little next to a primitive
+            for (const auto& words : record.commands)
+            {
+                uint8_t id = (words[0] >> 56) & 0b111111;
+                auto start = std::chrono::steady_clock::now();
+                command(words);
+                auto time = std::chrono::steady_clock::now() - start;
+
+                CommandTiming& timing = result.commands[id];
+                timing.count++;
+                timing.time += time;
+                result.time += time;
+                result.primitives += is_primitive(id);
+            }
+        }
+        return result;
+    }
+
+    RunResult run_hydra(const RDPStream& stream)
+    {
+        std::vector<uint8_t> rdram(0x800000);
+        MIInterrupt mi_interrupt;
+        auto rdp = std::make_unique<RDP>();
+        rdp->InstallBuses(rdram.data(), nullptr);
+        rdp->SetMIPtr(&mi_interrupt);
+        rdp->Reset();
+
+        RunResult result = run_stream(
+            stream,
+            [&](uint32_t address, const std::vector<uint8_t>& bytes) {
+                std::copy_n(bytes.begin(), std::min(bytes.size(), rdram.size() - address),
+                            rdram.begin() + address);
+            },
+            [&](const std::vector<uint64_t>& words) { rdp->SendCommand(words); });
+        result.pixels = rdp->GetPixelCount();
+        return result;
+    }
+
+    RunResult run_angrylion(const RDPStream& stream)
+    {
+        AngrylionReplayer::Init();
+        RunResult result = run_stream(
+            stream,
+            [](uint32_t address, const std::vector<uint8_t>& bytes) {
+                AngrylionReplayer::WriteMemory(address, bytes.data(), bytes.size());
+            },
+            [](const std::vector<uint64_t>& words) { AngrylionReplayer::RunCommand(words); });
+        AngrylionReplayer::Cleanup();
+        return result;
+    }
+
+    template <class Run>
+    RunResult fastest_run(const RDPStream& stream, int runs, Run&& run)
+    {
+        RunResult best;
+        for (int i = 0; i < runs; i++)
+        {
+            RunResult result = run(stream);
+            if (i == 0 || result.time < best.time)
+            {
+                best = std::move(result);
+            }
+        }
+        return best;
+    }
+
+    double milliseconds(std::chrono::nanoseconds time)
+    {
+        return std::chrono::duration<double, std::milli>(time).count();
+    }
+
+    std::map<std::string, double> load_baseline(const std::string& path)
+    {
+        std::map<std::string, double> baseline;
+        std::ifstream file(path);
+        std::string name;
+        double ms;
+        while (file >> name >> ms)
+        {
+            baseline[name] = ms;
+        }
+        return baseline;
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int runs = 5;
+    bool angrylion = false, synthetic = true;
+    std::string baseline_path, save_baseline_path;
+    std::vector<std::string> captures;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--runs" && has_value)
+            runs = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--angrylion")
+            angrylion = true;
+        else if (arg == "--no-synthetic")
+            synthetic = false;
+        else if (arg == "--baseline" && has_value)
+            baseline_path = argv[++i];
+        else if (arg == "--save-baseline" && has_value)
+            save_baseline_path = argv[++i];
+        else if (arg.starts_with("--"))
+        {
+            fmt::print("Usage: {} [--runs N] [--angrylion] [--no-synthetic] [--baseline FILE] "
+                       "[--save-baseline FILE] [capture...]\n",
+                       argv[0]);
+            return 1;
+        }
+        else
+            captures.push_back(arg);
+    }
+
+    std::vector<RDPStream> streams;
+    if (synthetic)
+    {
+        streams = synthetic_streams();
+    }
+    for (const auto& path : captures)
+    {
+        RDPStream stream;
+        if (!stream.Load(path))
+        {
+            return 1;
+        }
+        streams.push_back(std::move(stream));
+    }
+
+    auto baseline = baseline_path.empty() ? std::map<std::string, double>{}
+                                          : load_baseline(baseline_path);
+    std::map<std::string, double> results;
+    for (const auto& stream : streams)
+    {
+        RunResult result = fastest_run(stream, runs, run_hydra);
+        double ms = milliseconds(result.time);
+        results[stream.name] = ms;
+
+        fmt::print("{}: {:.2f} ms, {:.1f} Mpixels/s, {:.0f} primitives/s", stream.name, ms,
+                   result.pixels / (ms * 1000.0), result.primitives / (ms / 1000.0));
+        if (auto it = baseline.find(stream.name); it != baseline.end())
+        {
+            fmt::print(" (baseline {:.2f} ms, {:+.1f}%)", it->second,
+                       (ms / it->second - 1.0) * 100.0);
+        }
+        fmt::print("\n");
+
+        // Primitives and texture loads by type, state changes are cheap and lumped together
+        std::vector<std::pair<std::string_view, CommandTiming>> commands;
+        CommandTiming other;
+        for (const auto& [id, timing] : result.commands)
+        {
+            if (is_primitive(id) || is_load(id))
+            {
+                commands.push_back({command_name(id), timing});
+            }
+            else
+            {
+                other.count += timing.count;
+                other.time += timing.time;
+            }
+        }
+        std::sort(commands.begin(), commands.end(),
+                  [](auto& a, auto& b) { return a.second.time > b.second.time; });
+        if (other.count != 0)
+        {
+            commands.push_back({"Other", other});
+        }
+        for (const auto& [name, timing] : commands)
+        {
+            double command_ms = milliseconds(timing.time);
+            fmt::print("    {:<28} {:>7} {:>10.3f} ms {:>10.3f} us/command\n", name,
+                       timing.count, command_ms, command_ms * 1000.0 / timing.count);
+        }
+
+        if (angrylion)
+        {
+            double angrylion_ms = milliseconds(fastest_run(stream, runs, run_angrylion).time);
+            fmt::print("    angrylion: {:.2f} ms, {:.2f}x the time of this RDP\n", angrylion_ms,
+                       angrylion_ms / ms);
+        }
+    }
+
+    if (!save_baseline_path.empty())
+    {
+        std::ofstream file(save_baseline_path);
+        for (const auto& [name, ms] : results)
+        {
+            file << name << ' ' << ms << '\n';
+        }
+    }
+    return 0;
+}
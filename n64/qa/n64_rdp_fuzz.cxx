@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <fmt/format.h>
+#include <n64/qa/n64_rdp_streams.hxx>
+#include <string>
+#include <vector>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.hxx"
+
+// Renders random command streams on the RDP and on angrylion-rdp-plus and compares the color
+// images. A stream that renders differently is cut down to the commands the difference needs,
+// then saved to the output directory as a capture next to PNGs of what angrylion rendered and,
+// as <name>.known.png, of what the RDP renders today. Copying them to n64/qa/data/regressions
+// and adding the name to known_failures.txt there makes n64_qa check them.
+//
+// Usage: rdp_fuzz [--seed N] [--iterations N] [--commands N] [--failures N] [--out DIR]
+
+using namespace hydra::N64;
+
+namespace
+{
+    RDPStream random_stream(uint32_t seed, int commands)
+    {
+        RDPStreamBuilder builder(fmt::format("fuzz_{}", seed), seed, seed & 1 ? 32 : 16);
+        for (int i = 0; i < commands; i++)
+        {
+            // About two state changes per primitive
+            if (builder.Random(0, 2) == 0)
+            {
+                builder.RandomPrimitive();
+            }
+            else
+            {
+                builder.RandomState();
+            }
+        }
+        return builder.Build();
+    }
+
+    bool renders_differ(const RDPStream& stream)
+    {
+        RDPColorImage expected = GetColorImage(stream, RenderStreamAngrylion(stream));
+        try
+        {
+            return GetColorImage(stream, RenderStream(stream)).rgba != expected.rgba;
+        }
+        catch (const std::exception& e)
+        {
+            fmt::print("{}: {}\n", stream.name, e.what());
+            return true;
+        }
+    }
+
+    // Removes runs of commands for as long as the renders still differ, halving the run length
+    // whenever none can go. The first `keep` commands set up the images and TMEM and stay
+    RDPStream minimise(RDPStream stream, size_t keep)
+    {
+        size_t length = std::max<size_t>(1, (stream.records.back().commands.size() - keep) / 2);
+        while (true)
+        {
+            size_t i = keep;
+            while (i < stream.records.back().commands.size())
+            {
+                RDPStream candidate = stream;
+                auto& commands = candidate.records.back().commands;
+                commands.erase(commands.begin() + i,
+                               commands.begin() + std::min(i + length, commands.size()));
+                if (renders_differ(candidate))
+                {
+                    stream = std::move(candidate);
+                }
+                else
+                {
+                    i += length;
+                }
+            }
+
+            if (length == 1)
+            {
+                return stream;
+            }
+            length /= 2;
+        }
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint32_t seed = 1;
+    int iterations = 1000, commands = 200, max_failures = 10;
+    std::filesystem::path out = ".";
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--seed" && has_value)
+            seed = std::stoul(argv[++i]);
+        else if (arg == "--iterations" && has_value)
+            iterations = std::stoi(argv[++i]);
+        else if (arg == "--commands" && has_value)
+            commands = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--failures" && has_value)
+            max_failures = std::stoi(argv[++i]);
+        else if (arg == "--out" && has_value)
+            out = argv[++i];
+        else
+        {
+            fmt::print("Usage: {} [--seed N] [--iterations N] [--commands N] [--failures N] "
+                       "[--out DIR]\n",
+                       argv[0]);
+            return 1;
+        }
+    }
+
+    std::filesystem::create_directories(out);
+    // The builder adds the same setup commands to every stream
+    size_t prologue = RDPStreamBuilder("", 0).Build().records.back().commands.size();
+
+    int failures = 0;
+    for (int i = 0; i < iterations && failures < max_failures; i++)
+    {
+        RDPStream stream = random_stream(seed + i, commands);
+        if (!renders_differ(stream))
+        {
+            continue;
+        }
+
+        failures++;
+        size_t original = stream.records.back().commands.size() - prologue;
+        stream = minimise(std::move(stream), prologue);
+        size_t minimised = stream.records.back().commands.size() - prologue;
+
+        RDPColorImage expected = GetColorImage(stream, RenderStreamAngrylion(stream));
+        RDPColorImage known = GetColorImage(stream, RenderStream(stream));
+        std::string capture = (out / (stream.name + ".rdp")).string();
+        std::string png = (out / (stream.name + ".png")).string();
+        std::string known_png = (out / (stream.name + ".known.png")).string();
+        if (!stream.Save(capture) ||
+            !stbi_write_png(png.c_str(), expected.width, expected.height, 4,
+                            expected.rgba.data(), 0) ||
+            !stbi_write_png(known_png.c_str(), known.width, known.height, 4, known.rgba.data(),
+                            0))
+        {
+            fmt::print("Could not save {}\n", stream.name);
+            return 1;
+        }
+        fmt::print("{}: renders differ, {} of {} commands needed, saved to {}\n", stream.name,
+                   minimised, original, capture);
+    }
+
+    fmt::print("{} streams rendered differently\n", failures);
+    return failures != 0;
+}
@@ -1,13 +1,33 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
 #include <gtest/gtest.h>
+#include <mapped_file.hxx>
+#include <memory>
+#include <numeric>
+#include <n64/core/n64_addresses.hxx>
+#include <n64/core/n64_dirty_map.hxx>
+#include <n64/core/n64_game_db.hxx>
+#include <n64/core/n64_impl.hxx>
 #include <n64/core/n64_rdp.hxx>
+#include <n64/core/n64_rdp_capture.hxx>
 #include <n64/core/n64_rdp_commands.hxx>
+#include <n64/core/n64_rdp_perspective.hxx>
+#include <n64/core/n64_rom.hxx>
+#include <n64/core/n64_sample_ring.hxx>
+#include <n64/core/n64_vi.hxx>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.hxx"
 #include <fstream>
+#include <random>
+#include <set>
+#include <rewind.hxx>
+#include <state.hxx>
 #include <n64/qa/n64_angrylion_replayer.hxx>
+#include <n64/qa/n64_rdp_streams.hxx>
 
 using namespace hydra::N64;
 
@@ -18,20 +38,24 @@ protected:
     {
         std::fill(framebuffer.begin(), framebuffer.end(), 0);
         rdp.InstallBuses(framebuffer.data(), nullptr);
+        rdp.Reset();
 
         SetColorImageCommand color_image;
         color_image.dram_address = 0;
         color_image.width = my_width - 1;
         color_image.format = 0;
         color_image.size = 3;
+        color_image.command = static_cast<uint8_t>(RDPCommandType::SetColorImage);
         rdp.SendCommand({color_image.full});
 
         SetFillColorCommand fill_color;
         fill_color.color = 0xffffffff;
+        fill_color.command = static_cast<uint8_t>(RDPCommandType::SetFillColor);
         rdp.SendCommand({fill_color.full});
 
         SetOtherModesCommand other_modes;
         other_modes.cycle_type = 3;
+        other_modes.command = static_cast<uint8_t>(RDPCommandType::SetOtherModes);
         rdp.SendCommand({other_modes.full});
 
         SetScissorCommand scissor;
@@ -39,6 +63,7 @@ protected:
         scissor.YH = 0;
         scissor.XL = my_width << 2;
         scissor.YL = my_height << 2;
+        scissor.command = static_cast<uint8_t>(RDPCommandType::SetScissor);
         rdp.SendCommand({scissor.full});
     }
 
@@ -143,6 +168,1122 @@ protected:
 // TRIANGLE_TEST(Same_XH_XM_XL, 0x088002bc02bc0258, 0x00e1000000000000, 0x00e10000fffe0000,
 //               0x00e1000000000000);
 
+TEST_F(RDPTest, Fill_Rectangle_Includes_Lower_Right)
+{
+    RectangleCommand rectangle;
+    rectangle.xh = 10 << 2;
+    rectangle.yh = 20 << 2;
+    rectangle.xl = 30 << 2;
+    rectangle.yl = 40 << 2;
+    rectangle.full |= static_cast<uint64_t>(RDPCommandType::Rectangle) << 56;
+    rdp.SendCommand({rectangle.full});
+
+    auto filled = [this](int x, int y) {
+        return framebuffer[(y * my_width + x) * my_channels] != 0;
+    };
+    EXPECT_TRUE(filled(10, 20));
+    EXPECT_TRUE(filled(30, 40));
+    EXPECT_FALSE(filled(9, 20));
+    EXPECT_FALSE(filled(31, 40));
+    EXPECT_FALSE(filled(30, 41));
+}
+
+// With a scissor wider than the framebuffer, rectangles past its right edge don't get clamped
+// into the last column
+TEST_F(RDPTest, Rectangles_Past_The_Right_Edge_Draw_Nothing)
+{
+    SetScissorCommand scissor;
+    scissor.XL = 1000 << 2;
+    scissor.YL = my_height << 2;
+    scissor.command = static_cast<uint8_t>(RDPCommandType::SetScissor);
+    rdp.SendCommand({scissor.full});
+
+    RectangleCommand rectangle;
+    rectangle.xh = my_width << 2;
+    rectangle.yh = 20 << 2;
+    rectangle.xl = (my_width + 10) << 2;
+    rectangle.yl = 40 << 2;
+
+    std::fill(framebuffer.begin(), framebuffer.end(), 0xAB);
+    auto expected = framebuffer;
+    rectangle.full |= static_cast<uint64_t>(RDPCommandType::Rectangle) << 56;
+    rdp.SendCommand({rectangle.full});
+    EXPECT_EQ(framebuffer, expected);
+
+    // The copy fast path only handles 16bpp framebuffers
+    SetColorImageCommand color_image;
+    color_image.width = my_width - 1;
+    color_image.size = 2;
+    color_image.command = static_cast<uint8_t>(RDPCommandType::SetColorImage);
+    rdp.SendCommand({color_image.full});
+
+    SetOtherModesCommand other_modes;
+    other_modes.cycle_type = 2;
+    other_modes.command = static_cast<uint8_t>(RDPCommandType::SetOtherModes);
+    rdp.SendCommand({other_modes.full});
+
+    RectangleCommand texture_rectangle;
+    texture_rectangle.full = rectangle.full & ~(0xFFull << 56);
+    texture_rectangle.full |= static_cast<uint64_t>(RDPCommandType::TextureRectangle) << 56;
+    rdp.SendCommand({texture_rectangle.full, 0x0000'0000'1000'0400});
+    EXPECT_EQ(framebuffer, expected);
+}
+
+// Not a correctness test, run with GTEST_ALSO_RUN_DISABLED_TESTS=1 to time texture fetching
+TEST_F(RDPTest, DISABLED_Benchmark_Texture_Rectangles)
+{
+    auto with_id = [](uint64_t full, RDPCommandType id) {
+        return full | (static_cast<uint64_t>(id) << 56);
+    };
+
+    SetOtherModesCommand other_modes;
+    other_modes.cycle_type = 0;
+    other_modes.command = static_cast<uint8_t>(RDPCommandType::SetOtherModes);
+    rdp.SendCommand({other_modes.full});
+
+    // A 32x32 RGBA16 texture, loaded from whatever is below the visible part of the framebuffer
+    SetTextureImageCommand texture_image;
+    texture_image.DRAMAddress = my_width * (my_height - 32) * my_channels;
+    texture_image.width = 31;
+    texture_image.size = 2;
+    rdp.SendCommand({with_id(texture_image.full, RDPCommandType::SetTextureImage)});
+
+    SetTileCommand tile;
+    tile.size = 2;
+    tile.Line = 8;
+    tile.MaskS = 5;
+    tile.MaskT = 5;
+    rdp.SendCommand({with_id(tile.full, RDPCommandType::SetTile)});
+
+    LoadBlockCommand load_block;
+    load_block.SH = 32 * 32;
+    rdp.SendCommand({with_id(load_block.full, RDPCommandType::LoadBlock)});
+
+    RectangleCommand rectangle;
+    rectangle.xl = my_width << 2;
+    rectangle.yl = (my_height - 32) << 2;
+    // S = T = 0, DsDx = DtDy = 1.0
+    std::vector<uint64_t> texture_rectangle = {
+        with_id(rectangle.full, RDPCommandType::TextureRectangle), 0x0000'0000'0400'0400};
+
+    constexpr int frames = 50;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        rdp.SendCommand(texture_rectangle);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    printf("%d texture rectangles: %.2f ms, %.2f Mpixels/s\n", frames, ms,
+           frames * my_width * (my_height - 32) / (ms * 1000.0));
+}
+
+// Renders the same random triangles with and without the SIMD span kernel, in the 1-cycle modes
+// it covers. Does nothing useful on CPUs without AVX2, where both renders use the scalar path
+TEST_F(RDPTest, Simd_Spans_Match_Scalar)
+{
+    auto with_id = [](uint64_t full, RDPCommandType id) {
+        return full | (static_cast<uint64_t>(id) << 56);
+    };
+
+    // Color image in the top half, depth in the third quarter, texture in the last quarter
+    constexpr int height = my_height / 2;
+    constexpr uint32_t depth_address = my_width * height * 4;
+    constexpr uint32_t texture_address = depth_address + my_width * height * 2;
+
+    auto combiner = [](int a, int b, int c, int d, int alpha_a, int alpha_b, int alpha_c,
+                       int alpha_d) {
+        SetCombineModeCommand command;
+        command.sub_A_RGB_1 = a;
+        command.sub_B_RGB_1 = b;
+        command.mul_RGB_1 = c;
+        command.add_RGB_1 = d;
+        command.sub_A_Alpha_1 = alpha_a;
+        command.sub_B_Alpha_1 = alpha_b;
+        command.mul_Alpha_1 = alpha_c;
+        command.add_Alpha_1 = alpha_d;
+        command.command = static_cast<uint8_t>(RDPCommandType::SetCombineMode);
+        return command.full;
+    };
+    const uint64_t combine_modes[] = {
+        combiner(8, 8, 31, 4, 7, 7, 7, 4), // shade
+        combiner(8, 8, 31, 1, 7, 7, 7, 1), // texel
+        combiner(1, 8, 4, 7, 1, 7, 4, 7),  // texel * shade
+        combiner(1, 5, 11, 3, 1, 3, 1, 5), // (texel - env) * shade alpha + prim
+    };
+
+    auto render = [&](int pixel_size, bool simd) {
+        std::mt19937 rng(pixel_size);
+        auto random = [&rng](int32_t min, int32_t max) {
+            return std::uniform_int_distribution<int32_t>(min, max)(rng);
+        };
+        std::generate(framebuffer.begin(), framebuffer.end(), rng);
+
+        auto renderer = std::make_unique<RDP>();
+        renderer->InstallBuses(framebuffer.data(), nullptr);
+        renderer->Reset();
+        renderer->SetSimdSpans(simd);
+
+        SetColorImageCommand color_image;
+        color_image.width = my_width - 1;
+        color_image.size = pixel_size == 16 ? 2 : 3;
+        renderer->SendCommand({with_id(color_image.full, RDPCommandType::SetColorImage)});
+        renderer->SendCommand({with_id(depth_address, RDPCommandType::SetZImage)});
+
+        SetScissorCommand scissor;
+        scissor.XL = my_width << 2;
+        scissor.YL = height << 2;
+        renderer->SendCommand({with_id(scissor.full, RDPCommandType::SetScissor)});
+
+        SetTextureImageCommand texture_image;
+        texture_image.DRAMAddress = texture_address;
+        texture_image.width = 31;
+        texture_image.size = 2;
+        renderer->SendCommand({with_id(texture_image.full, RDPCommandType::SetTextureImage)});
+
+        SetTileCommand tile;
+        tile.size = 2;
+        tile.Line = 8;
+        tile.MaskS = 5;
+        tile.MaskT = 5;
+        tile.ms = 1;
+        renderer->SendCommand({with_id(tile.full, RDPCommandType::SetTile)});
+
+        LoadBlockCommand load_block;
+        load_block.SH = 32 * 32;
+        renderer->SendCommand({with_id(load_block.full, RDPCommandType::LoadBlock)});
+
+        for (auto id : {RDPCommandType::SetPrimitiveColor, RDPCommandType::SetEnvironmentColor,
+                        RDPCommandType::SetBlendColor, RDPCommandType::SetFogColor})
+        {
+            renderer->SendCommand({with_id(static_cast<uint32_t>(rng()), id)});
+        }
+
+        for (int i = 0; i < 64; i++)
+        {
+            // Anything but the cycle type, which the kernel only handles in 1-cycle mode
+            SetOtherModesCommand other_modes;
+            other_modes.full = rng();
+            other_modes.full |= static_cast<uint64_t>(rng()) << 32;
+            other_modes.cycle_type = 0;
+            renderer->SendCommand({with_id(other_modes.full & 0x00FF'FFFF'FFFF'FFFF,
+                                      RDPCommandType::SetOtherModes)});
+            renderer->SendCommand({combine_modes[i % std::size(combine_modes)]});
+            renderer->SendCommand({with_id(rng(), RDPCommandType::SetPrimDepth)});
+
+            EdgeCoefficientsCommand edges;
+            edges.YH = random(0, (height - 20) * 4);
+            edges.YM = edges.YH + random(0, 40);
+            edges.YL = std::min<int>(edges.YM + random(0, 40), height * 4);
+            edges.lft = random(0, 1);
+            edges.command = static_cast<uint8_t>(RDPCommandType::TriangleShadeTextureDepth);
+            std::vector<uint64_t> triangle = {edges.full};
+
+            int32_t center = random(0, my_width);
+            for (int edge = 0; edge < 3; edge++)
+            {
+                uint32_t x = (center + random(-60, 60)) << 16;
+                uint32_t slope = random(-0x40000, 0x40000);
+                triangle.push_back((static_cast<uint64_t>(x & 0x0FFF'FFFF) << 32) |
+                                   (slope & 0x3FFF'FFFF));
+            }
+
+            // Shade and texture coefficients, 16.16 values split in integer and fractional halves
+            auto attributes = [&](std::array<int32_t, 4> start, int32_t delta) {
+                std::array<int32_t, 4> values[4] = {start};
+                for (int j = 1; j < 4; j++)
+                {
+                    for (int k = 0; k < 4; k++)
+                    {
+                        values[j][k] = random(-delta, delta);
+                    }
+                }
+                auto word = [](const std::array<int32_t, 4>& v, bool integer) {
+                    uint64_t result = 0;
+                    for (int32_t value : v)
+                    {
+                        uint16_t half = integer ? value >> 16 : value;
+                        result = (result << 16) | half;
+                    }
+                    return result;
+                };
+                // Start and DxDx, then DxDe and DxDy
+                for (int pair : {0, 2})
+                {
+                    const auto& a = values[pair == 0 ? 0 : 2];
+                    const auto& b = values[pair == 0 ? 1 : 3];
+                    triangle.insert(triangle.end(),
+                                    {word(a, true), word(b, true), word(a, false), word(b, false)});
+                }
+            };
+            attributes({random(0, 0xFF'0000), random(0, 0xFF'0000), random(0, 0xFF'0000),
+                        random(0, 0xFF'0000)},
+                       0x4'0000);
+            attributes({random(0, 0x40'0000), random(0, 0x40'0000),
+                        random(0x1000'0000, 0x3FFF'FFFF), 0},
+                       0x4'0000);
+
+            uint32_t z = random(0, 0x7FFF'0000);
+            uint32_t DzDx = random(-0x10'0000, 0x10'0000);
+            uint32_t DzDe = random(-0x10'0000, 0x10'0000);
+            uint32_t DzDy = random(-0x10'0000, 0x10'0000);
+            triangle.push_back((static_cast<uint64_t>(z) << 32) | DzDx);
+            triangle.push_back((static_cast<uint64_t>(DzDe) << 32) | DzDy);
+            renderer->SendCommand(triangle);
+        }
+
+        return framebuffer;
+    };
+
+    for (int pixel_size : {16, 32})
+    {
+        auto scalar = render(pixel_size, false);
+        auto simd = render(pixel_size, true);
+        EXPECT_TRUE(scalar == simd) << pixel_size << "bpp renders differ";
+    }
+}
+
+// The divider and the clamp after it, as angrylion implements them
+static int32_t reference_perspective_divide(int32_t coordinate, int32_t w)
+{
+    int16_t sw = w >> 16;
+    bool w_carry = sw <= 0;
+    uint32_t entry = perspective_lut[sw & 0x7FFF];
+    int32_t shift = entry & 0xF;
+    int32_t reciprocal = entry >> 4;
+    int32_t product = static_cast<int16_t>(coordinate >> 16) * reciprocal;
+    int32_t mask = ((1 << 30) - 1) & -((1 << 29) >> shift);
+    int32_t out_of_bounds = product & mask;
+    int32_t quotient;
+    if (shift != 0xE)
+    {
+        quotient = product = product >> (13 - shift);
+    }
+    else
+    {
+        quotient = product << 1;
+    }
+    int32_t over_under = 0;
+    if (out_of_bounds != mask && out_of_bounds != 0)
+    {
+        over_under = (product & (1 << 29)) ? 1 << 17 : 2 << 17;
+    }
+    if (w_carry)
+    {
+        over_under |= 2 << 17;
+    }
+    int32_t result = (quotient & 0x1FFFF) | over_under;
+    int32_t clamped;
+    if (result & 0x40000)
+    {
+        clamped = 0x7FFF;
+    }
+    else if (result & 0x20000)
+    {
+        clamped = 0x8000;
+    }
+    else if ((result & 0x18000) == 0x8000)
+    {
+        clamped = 0x7FFF;
+    }
+    else if ((result & 0x18000) == 0x10000)
+    {
+        clamped = 0x8000;
+    }
+    else
+    {
+        clamped = result & 0xFFFF;
+    }
+    return static_cast<int16_t>(clamped) >> 5;
+}
+
+// The combiner and blender as they were evaluated per pixel before their equations were compiled,
+// for the inputs that are constant over a rectangle. Colors are 0xAABBGGRR like in the RDP
+namespace PerPixel
+{
+    struct Inputs
+    {
+        uint32_t primitive, environment, blend, fog, memory;
+        uint32_t combined = 0;
+    };
+
+    uint32_t replicate(uint32_t alpha)
+    {
+        return alpha * 0x01010101;
+    }
+
+    uint32_t color(const Inputs& in, int index, bool multiplier)
+    {
+        switch (index)
+        {
+            case 0:
+                return in.combined;
+            case 3:
+                return in.primitive;
+            case 5:
+                return in.environment;
+            case 6:
+                return multiplier ? 0 : 0xFFFF'FFFF;
+            case 10:
+                return multiplier ? replicate(in.primitive >> 24) : 0;
+            case 12:
+                return multiplier ? replicate(in.environment >> 24) : 0;
+            default:
+                return 0;
+        }
+    }
+
+    uint32_t alpha(const Inputs& in, int index)
+    {
+        switch (index)
+        {
+            case 0:
+                return in.combined >> 24;
+            case 3:
+                return in.primitive >> 24;
+            case 5:
+                return in.environment >> 24;
+            case 6:
+                return 0xFF;
+            default:
+                return 0;
+        }
+    }
+
+    uint8_t combine(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    {
+        return (a - b) * c / 0xFF + d;
+    }
+
+    uint32_t combiner(const Inputs& in, int a, int b, int c, int d, int alpha_a, int alpha_b,
+                      int alpha_c, int alpha_d)
+    {
+        uint32_t result = 0;
+        for (int shift = 0; shift < 24; shift += 8)
+        {
+            result |= combine(color(in, a, false) >> shift, color(in, b, false) >> shift,
+                              color(in, c, true) >> shift, color(in, d, false) >> shift)
+                      << shift;
+        }
+        uint32_t alpha_c_value = alpha_c == 7 ? 0 : alpha(in, alpha_c);
+        return result | combine(alpha(in, alpha_a), alpha(in, alpha_b), alpha_c_value,
+                                alpha(in, alpha_d))
+                            << 24;
+    }
+
+    uint32_t blender(const Inputs& in, int m1a, int m1b, int m2a, int m2b)
+    {
+        uint32_t colors[] = {in.combined, in.memory, in.blend, in.fog};
+        uint32_t color1 = colors[m1a], color2 = colors[m2a];
+        uint32_t multipliers[] = {in.combined >> 24, in.fog >> 24, 0, 0};
+        uint32_t multiplier1 = multipliers[m1b];
+        uint32_t multiplier2 = m2b == 0 ? 0xFF - multiplier1 : m2b == 2 ? 0xFF : 0;
+        if (multiplier1 + multiplier2 == 0)
+        {
+            multiplier1 = 0xFF;
+        }
+        uint32_t result = 0;
+        for (int shift = 0; shift < 24; shift += 8)
+        {
+            uint32_t c1 = (color1 >> shift) & 0xFF, c2 = (color2 >> shift) & 0xFF;
+            result |= (c1 * multiplier1 + c2 * multiplier2) / (multiplier1 + multiplier2)
+                      << shift;
+        }
+        return result;
+    }
+} // namespace PerPixel
+
+TEST_F(RDPTest, Compiled_Equations_Match_Per_Pixel_Evaluation)
+{
+    auto with_id = [](uint64_t full, RDPCommandType id) {
+        return full | (static_cast<uint64_t>(id) << 56);
+    };
+    PerPixel::Inputs in = {0x80'40'C0'20, 0x30'F0'10'90, 0x11'22'33'44, 0xC0'A0'60'E0,
+                           0x5A'3C'96'D2};
+    // Command colors are 0xRRGGBBAA
+    auto command_color = [](uint32_t color) { return hydra::bswap32(color); };
+    rdp.SendCommand(
+        {with_id(command_color(in.primitive), RDPCommandType::SetPrimitiveColor)});
+    rdp.SendCommand(
+        {with_id(command_color(in.environment), RDPCommandType::SetEnvironmentColor)});
+    rdp.SendCommand({with_id(command_color(in.blend), RDPCommandType::SetBlendColor)});
+    rdp.SendCommand({with_id(command_color(in.fog), RDPCommandType::SetFogColor)});
+
+    struct Mode
+    {
+        // a, b, c, d, alpha a, alpha b, alpha c, alpha d of both cycles
+        std::array<int, 8> combiner[2];
+        // m1a, m1b, m2a, m2b of the cycle that's blended
+        std::array<int, 4> blender;
+        bool two_cycle;
+    };
+    const Mode modes[] = {
+        // Primitive color, blended with memory by its alpha
+        {{{{8, 8, 16, 3, 7, 7, 7, 3}}, {{8, 8, 16, 3, 7, 7, 7, 3}}}, {{0, 0, 1, 0}}, false},
+        // (prim - env) * env alpha + env, full blend of the fog color
+        {{{{3, 5, 12, 5, 3, 5, 5, 5}}, {{3, 5, 12, 5, 3, 5, 5, 5}}}, {{3, 1, 1, 2}}, false},
+        // prim * env, copied through
+        {{{{3, 8, 5, 7, 3, 7, 5, 7}}, {{3, 8, 5, 7, 3, 7, 5, 7}}}, {{0, 3, 0, 1}}, false},
+        // m1 and m2 both zero, the blender divides by m1 = 0xFF instead
+        {{{{6, 8, 10, 7, 6, 7, 3, 7}}, {{6, 8, 10, 7, 6, 7, 3, 7}}}, {{2, 3, 1, 3}}, false},
+        // Second cycle on top of the first one's combined color
+        {{{{3, 5, 10, 5, 3, 7, 5, 7}}, {{0, 5, 12, 3, 0, 7, 3, 5}}}, {{0, 0, 1, 0}}, true},
+    };
+
+    for (const Mode& mode : modes)
+    {
+        SetCombineModeCommand combine;
+        const auto& c0 = mode.combiner[0];
+        const auto& c1 = mode.combiner[1];
+        combine.sub_A_RGB_0 = c0[0], combine.sub_B_RGB_0 = c0[1];
+        combine.mul_RGB_0 = c0[2], combine.add_RGB_0 = c0[3];
+        combine.sub_A_Alpha_0 = c0[4], combine.sub_B_Alpha_0 = c0[5];
+        combine.mul_Alpha_0 = c0[6], combine.add_Alpha_0 = c0[7];
+        combine.sub_A_RGB_1 = c1[0], combine.sub_B_RGB_1 = c1[1];
+        combine.mul_RGB_1 = c1[2], combine.add_RGB_1 = c1[3];
+        combine.sub_A_Alpha_1 = c1[4], combine.sub_B_Alpha_1 = c1[5];
+        combine.mul_Alpha_1 = c1[6], combine.add_Alpha_1 = c1[7];
+        combine.command = static_cast<uint8_t>(RDPCommandType::SetCombineMode);
+        rdp.SendCommand({combine.full});
+
+        // Both blender cycles get the same inputs, only the last one is evaluated
+        SetOtherModesCommand other_modes;
+        other_modes.cycle_type = mode.two_cycle ? 1 : 0;
+        other_modes.b_m1a_0 = other_modes.b_m1a_1 = mode.blender[0];
+        other_modes.b_m1b_0 = other_modes.b_m1b_1 = mode.blender[1];
+        other_modes.b_m2a_0 = other_modes.b_m2a_1 = mode.blender[2];
+        other_modes.b_m2b_0 = other_modes.b_m2b_1 = mode.blender[3];
+        other_modes.command = static_cast<uint8_t>(RDPCommandType::SetOtherModes);
+        rdp.SendCommand({other_modes.full});
+
+        for (size_t i = 0; i < framebuffer.size(); i += 4)
+        {
+            std::memcpy(&framebuffer[i], &in.memory, 4);
+        }
+        RectangleCommand rectangle;
+        rectangle.xh = 10 << 2;
+        rectangle.yh = 20 << 2;
+        rectangle.xl = 30 << 2;
+        rectangle.yl = 40 << 2;
+        rdp.SendCommand({with_id(rectangle.full, RDPCommandType::Rectangle)});
+
+        PerPixel::Inputs pixel = in;
+        if (mode.two_cycle)
+        {
+            pixel.combined = PerPixel::combiner(pixel, c0[0], c0[1], c0[2], c0[3], c0[4], c0[5],
+                                                c0[6], c0[7]);
+        }
+        pixel.combined =
+            PerPixel::combiner(pixel, c1[0], c1[1], c1[2], c1[3], c1[4], c1[5], c1[6], c1[7]);
+        uint32_t expected = PerPixel::blender(pixel, mode.blender[0], mode.blender[1],
+                                              mode.blender[2], mode.blender[3]);
+        uint32_t drawn;
+        std::memcpy(&drawn, &framebuffer[(30 * my_width + 20) * 4], 4);
+        // The alpha byte holds the coverage
+        EXPECT_EQ(drawn & 0xFF'FFFF, expected) << "mode " << &mode - modes;
+    }
+}
+
+TEST(Perspective, SaturatesLikeTheRDP)
+{
+    // W <= 0 always saturates to the largest coordinate
+    for (int32_t w : {0, -1 << 16, INT32_MIN})
+    {
+        auto [s, t] = PerspectiveCorrection(0x100 << 16, -0x100 << 16, w);
+        EXPECT_EQ(s, PERSPECTIVE_MAX);
+        EXPECT_EQ(t, PERSPECTIVE_MAX);
+    }
+    // Quotients past 16 bits saturate towards their sign instead of wrapping
+    auto [over, under] = PerspectiveCorrection(0x4000 << 16, -0x4000 << 16, 1 << 16);
+    EXPECT_EQ(over, PERSPECTIVE_MAX);
+    EXPECT_EQ(under, PERSPECTIVE_MIN);
+
+    for (int32_t w = -0x8000; w < 0x8000; w += 0x7)
+    {
+        for (int32_t coordinate = -0x8000; coordinate < 0x8000; coordinate += 0x1F)
+        {
+            auto [s, t] = PerspectiveCorrection(coordinate << 16, ~coordinate << 16, w << 16);
+            ASSERT_EQ(s, reference_perspective_divide(coordinate << 16, w << 16))
+                << std::hex << coordinate << " / " << w;
+            ASSERT_EQ(t, reference_perspective_divide(~coordinate << 16, w << 16))
+                << std::hex << ~coordinate << " / " << w;
+        }
+    }
+}
+
+TEST(HiddenBits, FillKeepsNeighbours)
+{
+    HiddenBits bits(0x1000);
+    bits.Set(0x10, 0b11);
+    bits.Set(0x2A, 0b11);
+    // Unaligned on both ends so the head, memset and tail paths are all taken
+    bits.Fill(0x12, 12, 0b10);
+    EXPECT_EQ(bits.Get(0x10), 0b11);
+    EXPECT_EQ(bits.Get(0x2A), 0b11);
+    for (uint32_t address = 0x12; address < 0x2A; address += 2)
+    {
+        EXPECT_EQ(bits.Get(address), 0b10);
+    }
+    // The two bytes of a halfword share the same hidden bits
+    EXPECT_EQ(bits.Get(0x13), 0b10);
+}
+
+TEST(Vi, RedrawsOnlyDirtyRows)
+{
+    std::vector<uint8_t> rdram(0x800000);
+    DirtyMap dirty_map(rdram.size());
+    Vi vi;
+    vi.InstallBuses(rdram.data());
+    vi.SetDirtyMap(&dirty_map);
+
+    // 320x240 RGBA5551, rows are 640 bytes so they start on a block boundary every 5 rows
+    constexpr uint32_t origin = 0x100000;
+    vi.WriteWord(VI_CTRL, 0b10);
+    vi.WriteWord(VI_ORIGIN, origin);
+    vi.WriteWord(VI_WIDTH, 320);
+    vi.WriteWord(VI_H_VIDEO, (0x6C << 16) | (0x6C + 640));
+    vi.WriteWord(VI_V_VIDEO, (0x25 << 16) | (0x25 + 480));
+    vi.WriteWord(VI_X_SCALE, 0x200);
+    vi.WriteWord(VI_Y_SCALE, 0x400);
+
+    EXPECT_TRUE(vi.Redraw());
+    EXPECT_EQ(vi.TakeDirtyRows(), std::make_pair(0, 240));
+    vi.GetFramebufferPtr();
+    EXPECT_FALSE(vi.Redraw());
+    EXPECT_EQ(vi.TakeDirtyRows().second, 0);
+
+    // Rows changed over several redraws are merged until they're taken
+    dirty_map.Mark(origin + 10 * 640 + 100);
+    EXPECT_TRUE(vi.Redraw());
+    dirty_map.Mark(origin + 50 * 640, 640);
+    EXPECT_TRUE(vi.Redraw());
+    EXPECT_EQ(vi.TakeDirtyRows(), std::make_pair(10, 41));
+    vi.GetFramebufferPtr();
+
+    // Rows that were taken but never converted are handed over again with the next ones
+    dirty_map.Mark(origin + 20 * 640);
+    EXPECT_TRUE(vi.Redraw());
+    EXPECT_EQ(vi.TakeDirtyRows(), std::make_pair(20, 1));
+    dirty_map.Mark(origin + 30 * 640);
+    EXPECT_TRUE(vi.Redraw());
+    EXPECT_EQ(vi.TakeDirtyRows(), std::make_pair(20, 11));
+    vi.GetFramebufferPtr();
+
+    // Writes outside the framebuffer don't cause a redraw, moving it does
+    dirty_map.Mark(origin - 1);
+    dirty_map.Mark(origin + 240 * 640);
+    EXPECT_FALSE(vi.Redraw());
+    vi.WriteWord(VI_ORIGIN, origin + 0x100000);
+    EXPECT_TRUE(vi.Redraw());
+    EXPECT_EQ(vi.TakeDirtyRows(), std::make_pair(0, 240));
+    vi.GetFramebufferPtr();
+    EXPECT_EQ(vi.GetFramebufferRange(), std::make_pair(origin + 0x100000, size_t(240 * 640)));
+
+    // Loading a state only redraws everything if it shows another framebuffer
+    std::vector<uint8_t> state;
+    {
+        hydra::StateWriter writer(state);
+        vi.Serialize(writer);
+    }
+    hydra::StateReader same(state);
+    vi.Serialize(same);
+    EXPECT_TRUE(same.Ok());
+    EXPECT_FALSE(vi.Redraw());
+    vi.WriteWord(VI_ORIGIN, origin);
+    EXPECT_TRUE(vi.Redraw());
+    vi.TakeDirtyRows();
+    vi.GetFramebufferPtr();
+    hydra::StateReader moved(state);
+    vi.Serialize(moved);
+    EXPECT_TRUE(vi.Redraw());
+    EXPECT_EQ(vi.TakeDirtyRows(), std::make_pair(0, 240));
+}
+
+TEST(Vi, ConvertsEveryRGBA5551Color)
+{
+    std::vector<uint8_t> rdram(0x800000);
+    Vi vi;
+    vi.InstallBuses(rdram.data());
+
+    // 250 pixels wide so every row has a few pixels left over for the narrower kernels
+    constexpr uint32_t origin = 0x100000;
+    uint16_t* colors = reinterpret_cast<uint16_t*>(&rdram[origin]);
+    for (int i = 0; i < 0x10000; i++)
+    {
+        colors[i] = i;
+    }
+    vi.WriteWord(VI_CTRL, 0b10);
+    vi.WriteWord(VI_ORIGIN, origin);
+    vi.WriteWord(VI_WIDTH, 256);
+    vi.WriteWord(VI_H_VIDEO, (0x6C << 16) | (0x6C + 500));
+    vi.WriteWord(VI_V_VIDEO, (0x25 << 16) | (0x25 + 512));
+    vi.WriteWord(VI_X_SCALE, 0x200);
+    vi.WriteWord(VI_Y_SCALE, 0x400);
+    vi.Redraw();
+    vi.TakeDirtyRows();
+    ASSERT_EQ(vi.GetWidth(), 250);
+    ASSERT_EQ(vi.GetHeight(), 256);
+
+    const uint8_t* pixels = vi.GetFramebufferPtr();
+    for (int y = 0; y < 256; y++)
+    {
+        for (int x = 0; x < 250; x++)
+        {
+            uint16_t color = y * 256 + x;
+            auto expand = [](int channel) { return (channel << 3) | (channel >> 2); };
+            const uint8_t* pixel = &pixels[(y * 250 + x) * 4];
+            ASSERT_EQ(pixel[0], expand((color >> 11) & 0x1F)) << color;
+            ASSERT_EQ(pixel[1], expand((color >> 6) & 0x1F)) << color;
+            ASSERT_EQ(pixel[2], expand((color >> 1) & 0x1F)) << color;
+            ASSERT_EQ(pixel[3], 0xFF) << color;
+        }
+    }
+
+    // Native output is the rows as they were at the redraw, later writes to RDRAM don't show
+    // up until the next one
+    vi.SetNative16Bit(true);
+    vi.Redraw();
+    vi.TakeDirtyRows();
+    colors[0] = 0xFFFF;
+    const uint16_t* native = reinterpret_cast<const uint16_t*>(vi.GetFramebufferPtr());
+    for (int y = 0; y < 256; y++)
+    {
+        ASSERT_EQ(std::memcmp(&native[y * 250], &colors[y * 256], 250 * 2) != 0, y == 0) << y;
+    }
+
+    // Nor do redraws, until the frame they copied is handed over
+    vi.Redraw();
+    native = reinterpret_cast<const uint16_t*>(vi.GetFramebufferPtr());
+    EXPECT_EQ(native[0], 0);
+    vi.TakeDirtyRows();
+    native = reinterpret_cast<const uint16_t*>(vi.GetFramebufferPtr());
+    EXPECT_EQ(native[0], 0xFFFF);
+}
+
+TEST(SampleRing, ReadsAcrossTheWrapAround)
+{
+    SampleRing ring(8);
+    for (int i = 0; i < 6; i++)
+    {
+        ASSERT_TRUE(ring.Push(i, -i));
+    }
+    ring.Pop(5);
+    for (int i = 6; i < 13; i++)
+    {
+        ASSERT_TRUE(ring.Push(i, -i));
+    }
+    EXPECT_FALSE(ring.Push(13, -13));
+    ASSERT_EQ(ring.Size(), 8);
+
+    // The 8 frames start at index 5, so only 3 can be read before wrapping around
+    size_t frames = ring.Size();
+    const int16_t* samples = ring.Peek(frames);
+    ASSERT_EQ(frames, 3);
+    EXPECT_EQ(samples[0], 5);
+    EXPECT_EQ(samples[5], -7);
+    ring.Pop(frames);
+    frames = ring.Size();
+    samples = ring.Peek(frames);
+    ASSERT_EQ(frames, 5);
+    EXPECT_EQ(samples[0], 8);
+    EXPECT_EQ(samples[9], -12);
+}
+
+TEST(RDPCapture, RejectsCountsLargerThanTheFile)
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "hydra_qa.rdp";
+    {
+        RDPCaptureWriter writer(0x1000);
+        ASSERT_TRUE(writer.Open(path.string()));
+        writer.WriteCommand({0x2900'0000'0000'0000});
+        writer.EndCommandList();
+    }
+    {
+        // A commands record that claims far more commands than there are bytes left
+        std::ofstream ofs(path, std::ios::binary | std::ios::app);
+        ofs.put(static_cast<char>(RDPCaptureRecordType::Commands));
+        uint32_t count = 0xFFFF'FFFF;
+        ofs.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        ofs.put(1);
+    }
+
+    RDPCaptureReader reader;
+    ASSERT_TRUE(reader.Open(path.string()));
+    RDPCaptureRecord record;
+    ASSERT_TRUE(reader.Read(record));
+    EXPECT_EQ(record.commands.size(), 1);
+    EXPECT_FALSE(reader.Read(record));
+    EXPECT_LT(record.commands.capacity(), 16);
+    std::filesystem::remove(path);
+}
+
+TEST(MappedFile, PadsWithZeroesAndLeavesTheFileAlone)
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "hydra_qa.z64";
+    {
+        std::ofstream ofs(path, std::ios::binary);
+        ofs.write("\x80\x37\x12\x40", 4);
+    }
+    hydra::MappedFile file;
+    ASSERT_TRUE(file.Open(path.string(), 0x10000));
+    EXPECT_EQ(file.Size(), 4);
+    ASSERT_EQ(file.MappedSize(), 0x10000);
+    EXPECT_EQ(file.Data()[0], 0x80);
+    EXPECT_EQ(file.Data()[0xFFFF], 0);
+    file.Data()[0] = 0;
+    file.Close();
+
+    std::ifstream ifs(path, std::ios::binary);
+    EXPECT_EQ(ifs.get(), 0x80);
+    ifs.close();
+    std::filesystem::remove(path);
+    EXPECT_FALSE(file.Open(path.string()));
+}
+
+TEST(MappedFile, WritableFilesAreReplacedOnSync)
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "hydra_qa.sra";
+    std::filesystem::remove(path);
+    hydra::MappedFile file;
+    ASSERT_TRUE(file.OpenWritable(path.string(), 0x8000, 0x10000, 0xFF));
+    EXPECT_EQ(file.Size(), 0x8000);
+    ASSERT_EQ(file.MappedSize(), 0x10000);
+    EXPECT_EQ(file.Data()[0x7FFF], 0xFF);
+    EXPECT_EQ(file.Data()[0x8000], 0);
+    file.Data()[0] = 0x12;
+    file.Data()[0x8000] = 0x34;
+    auto read_first = [&] {
+        std::ifstream ifs(path, std::ios::binary);
+        return ifs.get();
+    };
+    // Nothing reaches the file before it's synced
+    EXPECT_EQ(read_first(), 0xFF);
+    ASSERT_TRUE(file.Sync());
+    EXPECT_EQ(read_first(), 0x12);
+    EXPECT_EQ(std::filesystem::file_size(path), 0x8000);
+    EXPECT_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+    // What wasn't synced is dropped
+    file.Data()[0] = 0x56;
+    file.Close();
+
+    // Existing files keep their contents, shorter ones are padded with zeroes
+    ASSERT_TRUE(file.OpenWritable(path.string(), 0x8000));
+    EXPECT_EQ(file.Data()[0], 0x12);
+    EXPECT_EQ(file.Data()[1], 0xFF);
+    file.Close();
+    std::filesystem::resize_file(path, 0x10);
+    ASSERT_TRUE(file.OpenWritable(path.string(), 0x8000));
+    EXPECT_EQ(file.Size(), 0x8000);
+    EXPECT_EQ(file.Data()[0xF], 0xFF);
+    EXPECT_EQ(file.Data()[0x7FFF], 0);
+    ASSERT_TRUE(file.Sync());
+    EXPECT_EQ(std::filesystem::file_size(path), 0x8000);
+    file.Close();
+    std::filesystem::remove(path);
+}
+
+TEST(Rom, NormalizesEveryByteOrder)
+{
+    // Odd number of words so the scalar tail gets used too
+    std::vector<uint8_t> z64(0x1004);
+    std::mt19937 rng(64);
+    for (auto& byte : z64)
+    {
+        byte = rng();
+    }
+    const uint8_t magic[] = {0x80, 0x37, 0x12, 0x40};
+    std::memcpy(z64.data(), magic, 4);
+    uint32_t crc = 0xFFFF'FFFF;
+    for (uint8_t byte : z64)
+    {
+        crc = hydra::crc32_u8(crc, byte);
+    }
+    crc ^= 0xFFFF'FFFF;
+
+    std::vector<uint8_t> v64 = z64, n64 = z64;
+    for (size_t i = 0; i < z64.size(); i += 4)
+    {
+        std::swap(v64[i], v64[i + 1]);
+        std::swap(v64[i + 2], v64[i + 3]);
+        std::reverse(&n64[i], &n64[i + 4]);
+    }
+    ASSERT_EQ(DetectRomFormat(v64.data()), RomFormat::V64);
+    ASSERT_EQ(DetectRomFormat(n64.data()), RomFormat::N64);
+    std::vector<uint8_t> copy = z64;
+    ASSERT_EQ(DetectRomFormat(copy.data()), RomFormat::Z64);
+    EXPECT_EQ(NormalizeRom(copy.data(), copy.size(), RomFormat::Z64), crc);
+    EXPECT_EQ(NormalizeRom(v64.data(), v64.size(), RomFormat::V64), crc);
+    EXPECT_EQ(NormalizeRom(n64.data(), n64.size(), RomFormat::N64), crc);
+    EXPECT_EQ(copy, z64);
+    EXPECT_EQ(v64, z64);
+    EXPECT_EQ(n64, z64);
+    EXPECT_EQ(DetectRomFormat(&z64[4]), RomFormat::Unknown);
+}
+
+TEST(HLEBoot, LeavesTheStateIPL3Would)
+{
+    // A header and IPL3 that match no CIC, so the PIF gets the seed of CIC-6102, followed by the
+    // game code
+    std::vector<uint8_t> rom(0x3000);
+    std::mt19937 rng(45);
+    for (auto& byte : rom)
+    {
+        byte = rng();
+    }
+    const uint8_t header[] = {0x80, 0x37, 0x12, 0x40, 0x00, 0x00, 0x00, 0x0F,
+                              0x80, 0x00, 0x04, 0x00};
+    std::memcpy(rom.data(), header, sizeof(header));
+    rom[0x3E] = 'E';
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "hydra_qa.z64";
+    {
+        std::ofstream ofs(path, std::ios::binary);
+        ofs.write(reinterpret_cast<const char*>(rom.data()), rom.size());
+    }
+
+    bool should_draw = false;
+    auto n64 = std::make_unique<N64>(should_draw);
+    n64->SetHLEBoot(true);
+    ASSERT_TRUE(n64->LoadCartridge(path.string()));
+    n64->Reset();
+
+    EXPECT_EQ(n64->GetPC(), 0xFFFF'FFFF'8000'0400);
+    // The game is copied to the entry point, past the end of the ROM with zeroes
+    std::vector<uint8_t> code(0x3000);
+    n64->ReadPhysical(code.data(), 0x400, code.size());
+    EXPECT_TRUE(std::equal(rom.begin() + 0x1000, rom.end(), code.begin()));
+    EXPECT_TRUE(
+        std::all_of(code.begin() + 0x2000, code.end(), [](uint8_t byte) { return byte == 0; }));
+    // and the header and IPL3 to DMEM
+    std::vector<uint8_t> dmem(0x1000);
+    n64->ReadPhysical(dmem.data(), 0x0400'0000, dmem.size());
+    EXPECT_TRUE(std::equal(dmem.begin(), dmem.end(), rom.begin()));
+
+    // s3: ROM, s4: NTSC, s5: cold reset, s6: CIC seed, s7: version
+    EXPECT_EQ(n64->GetGPR(19), 0);
+    EXPECT_EQ(n64->GetGPR(20), 1);
+    EXPECT_EQ(n64->GetGPR(21), 0);
+    EXPECT_EQ(n64->GetGPR(22), 0x3F);
+    EXPECT_EQ(n64->GetGPR(23), 0);
+    EXPECT_EQ(n64->GetGPR(29), 0xFFFF'FFFF'A400'1FF0);
+
+    // PAL games are told so
+    rom[0x3E] = 'P';
+    {
+        std::ofstream ofs(path, std::ios::binary);
+        ofs.write(reinterpret_cast<const char*>(rom.data()), rom.size());
+    }
+    ASSERT_TRUE(n64->LoadCartridge(path.string()));
+    n64->Reset();
+    EXPECT_EQ(n64->GetGPR(20), 0);
+
+    n64.reset();
+    std::filesystem::remove(path);
+}
+
+TEST(GameDatabase, FindsGamesByHeaderCrc)
+{
+    uint8_t header[0x40] = {};
+    const uint8_t mario_64[] = {0x63, 0x5A, 0x2B, 0xFF, 0x8B, 0x02, 0x23, 0x26};
+    std::memcpy(&header[0x10], mario_64, sizeof(mario_64));
+    const GameInfo* game = FindGame(header);
+    ASSERT_NE(game, nullptr);
+    EXPECT_EQ(game->save_type, SaveType::Eeprom4K);
+
+    // Revisions of a game have their own checksums and entries
+    const uint8_t ocarina_1_2[] = {0x69, 0x3B, 0xA2, 0xAE, 0xB7, 0xF1, 0x4E, 0x9F};
+    std::memcpy(&header[0x10], ocarina_1_2, sizeof(ocarina_1_2));
+    game = FindGame(header);
+    ASSERT_NE(game, nullptr);
+    EXPECT_EQ(game->save_type, SaveType::Sram);
+
+    // Only CRC2 differs
+    header[0x17] ^= 1;
+    EXPECT_EQ(FindGame(header), nullptr);
+}
+
+TEST(SaveState, RoundTripsAndRejectsMismatches)
+{
+    HiddenBits bits(0x1000);
+    bits.Fill(0x20, 8, 0b01, 0b10);
+    std::atomic<uint32_t> counter = 7;
+    std::vector<uint8_t> state;
+    {
+        hydra::StateWriter writer(state);
+        writer.Section("TEST", 1);
+        writer(bits, counter);
+    }
+
+    HiddenBits loaded(0x1000);
+    counter = 0;
+    hydra::StateReader reader(state);
+    reader.Section("TEST", 1);
+    reader(loaded, counter);
+    EXPECT_TRUE(reader.Ok());
+    EXPECT_EQ(counter, 7u);
+    for (uint32_t address = 0x20; address < 0x30; address += 2)
+    {
+        EXPECT_EQ(loaded.Get(address), bits.Get(address));
+    }
+
+    hydra::StateReader newer(state);
+    newer.Section("TEST", 2);
+    EXPECT_FALSE(newer.Ok());
+
+    // Memories of another size are from another configuration
+    HiddenBits bigger(0x2000);
+    hydra::StateReader resized(state);
+    resized.Section("TEST", 1);
+    resized(bigger, counter);
+    EXPECT_FALSE(resized.Ok());
+
+    hydra::StateReader truncated(std::span<const uint8_t>(state).first(state.size() - 1));
+    truncated.Section("TEST", 1);
+    truncated(loaded, counter);
+    EXPECT_FALSE(truncated.Ok());
+
+    // The build ID follows the magic
+    state[4] ^= 1;
+    hydra::StateReader other_build(state);
+    other_build.Section("TEST", 1);
+    other_build(loaded, counter);
+    EXPECT_FALSE(other_build.Ok());
+}
+
+TEST(Rewind, DeltasGoBackToThePreviousState)
+{
+    std::vector<uint8_t> previous(1000);
+    std::iota(previous.begin(), previous.end(), 0);
+    std::vector<uint8_t> current = previous;
+    current[3] ^= 1;
+    current[500] ^= 0xFF;
+    current.resize(1010, 0x55);
+
+    std::vector<uint8_t> delta;
+    hydra::RewindBuffer::EncodeDelta(previous, current, delta);
+    EXPECT_LT(delta.size(), 100u);
+    std::vector<uint8_t> state = current;
+    ASSERT_TRUE(hydra::RewindBuffer::ApplyDelta(delta, state));
+    EXPECT_EQ(state, previous);
+    // And the other way around, from a longer state to a shorter one
+    hydra::RewindBuffer::EncodeDelta(current, previous, delta);
+    ASSERT_TRUE(hydra::RewindBuffer::ApplyDelta(delta, state));
+    EXPECT_EQ(state, current);
+    EXPECT_FALSE(hydra::RewindBuffer::ApplyDelta(delta, state));
+}
+
+TEST(Rewind, StepsBackThroughTheHistory)
+{
+    hydra::RewindBuffer rewind;
+    // Room for a few deltas only, the oldest ones get dropped
+    rewind.SetBudget(100, 300);
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        // Waits for the last push to go through before reusing the staging buffer
+        EXPECT_LE(rewind.Snapshots(), i);
+        rewind.Staging().assign(256, 0);
+        rewind.Staging()[i * 16] = i;
+        rewind.Push();
+    }
+    size_t snapshots = rewind.Snapshots();
+    EXPECT_GT(snapshots, 1u);
+    EXPECT_LT(snapshots, 10u);
+    for (size_t i = 0; i < snapshots; i++)
+    {
+        std::span<const uint8_t> state = rewind.Newest();
+        uint8_t frame = 9 - i;
+        ASSERT_EQ(state.size(), 256u);
+        EXPECT_EQ(state[frame * 16], frame);
+        rewind.StepBack();
+    }
+    // The oldest state stays once there's nothing before it
+    EXPECT_EQ(rewind.Snapshots(), 1u);
+    EXPECT_EQ(rewind.Newest()[(10 - snapshots) * 16], 10 - snapshots);
+}
+
+// The fuzzer's random streams have to be valid input, or the differences it finds are just
+// angrylion refusing to render them
+TEST(RDPStreams, Random_Streams_Run_Without_Errors)
+{
+    for (uint32_t seed = 1; seed <= 20; seed++)
+    {
+        RDPStreamBuilder builder("random", seed, seed & 1 ? 32 : 16);
+        for (int i = 0; i < 200; i++)
+        {
+            if (builder.Random(0, 2) == 0)
+            {
+                builder.RandomPrimitive();
+            }
+            else
+            {
+                builder.RandomState();
+            }
+        }
+        RenderStreamAngrylion(builder.Build());
+        EXPECT_EQ(AngrylionReplayer::GetWarnings(), 0) << "seed " << seed;
+    }
+}
+
+// Streams rdp_fuzz found to render differently from angrylion-rdp-plus, next to PNGs of what
+// angrylion rendered. The ones in known_failures.txt still do, they're checked against
+// <name>.known.png instead, what the RDP rendered when they were added, so a change to how they
+// render still shows. One that renders like angrylion should come off the list
+TEST(RDPRegression, Streams_Match_Reference)
+{
+    const std::filesystem::path directory = "n64/qa/data/regressions";
+    if (!std::filesystem::exists(directory))
+    {
+        GTEST_SKIP() << "No regression streams in " << directory;
+    }
+
+    std::set<std::string> known_failures;
+    std::ifstream list(directory / "known_failures.txt");
+    std::string line;
+    while (std::getline(list, line))
+    {
+        if (!line.empty() && line[0] != '#')
+        {
+            known_failures.insert(line);
+        }
+    }
+
+    auto matches = [](const RDPColorImage& image, const std::filesystem::path& png) {
+        int width, height, channels;
+        stbi_uc* data = stbi_load(png.string().c_str(), &width, &height, &channels, 4);
+        EXPECT_NE(data, nullptr) << png;
+        bool equal = data && image.width == width && image.height == height &&
+                     std::equal(image.rgba.begin(), image.rgba.end(), data);
+        stbi_image_free(data);
+        return equal;
+    };
+
+    int streams = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory))
+    {
+        if (entry.path().extension() != ".rdp")
+        {
+            continue;
+        }
+
+        RDPStream stream;
+        ASSERT_TRUE(stream.Load(entry.path().string()));
+        RDPColorImage image = GetColorImage(stream, RenderStream(stream));
+        std::filesystem::path png = std::filesystem::path(entry.path()).replace_extension(".png");
+        if (known_failures.count(entry.path().stem().string()))
+        {
+            EXPECT_FALSE(matches(image, png))
+                << stream.name << " renders like angrylion now, take it off known_failures.txt";
+            EXPECT_TRUE(matches(image, std::filesystem::path(png).replace_extension(".known.png")))
+                << stream.name << " renders differently from its known failure";
+        }
+        else
+        {
+            EXPECT_TRUE(matches(image, png)) << stream.name << " renders differently";
+        }
+        streams++;
+    }
+    EXPECT_GT(streams, 0) << "No regression streams in " << directory;
+}
+
 TEST(RDPCompare, test)
 {
     AngrylionReplayer::Init();
@@ -0,0 +1,75 @@
+#include <chrono>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#include <memory>
+#include <n64/core/n64_rdp.hxx>
+#include <n64/core/n64_rdp_capture.hxx>
+#include <vector>
+
+// Replays a capture made with RDP::StartCapture on a standalone RDP, then prints a hash of the
+// resulting RDRAM so two RDP builds can be compared. Optionally dumps the RDRAM to a file
+int main(int argc, char** argv)
+{
+    using namespace hydra::N64;
+
+    if (argc < 2)
+    {
+        fmt::print("Usage: {} <capture> [rdram dump]\n", argv[0]);
+        return 1;
+    }
+
+    RDPCaptureReader reader;
+    if (!reader.Open(argv[1]))
+    {
+        return 1;
+    }
+
+    std::vector<uint8_t> rdram(reader.GetRdramSize());
+    MIInterrupt mi_interrupt;
+    auto rdp = std::make_unique<RDP>();
+    rdp->InstallBuses(rdram.data(), nullptr);
+    rdp->SetMIPtr(&mi_interrupt);
+    rdp->Reset();
+
+    size_t command_records = 0, commands = 0, memory_bytes = 0;
+    std::chrono::nanoseconds rdp_time{0};
+    RDPCaptureRecord record;
+    while (reader.Read(record))
+    {
+        if (record.type == RDPCaptureRecordType::Memory)
+        {
+            std::memcpy(&rdram[record.address], record.bytes.data(), record.bytes.size());
+            memory_bytes += record.bytes.size();
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& command : record.commands)
+        {
+            rdp->SendCommand(command);
+        }
+        rdp_time += std::chrono::steady_clock::now() - start;
+        command_records++;
+        commands += record.commands.size();
+    }
+
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325;
+    for (uint8_t byte : rdram)
+    {
+        hash = (hash ^ byte) * 0x100000001b3;
+    }
+
+    fmt::print("{} command records, {} commands, {} bytes of memory\n", command_records, commands,
+               memory_bytes);
+    fmt::print("RDP time: {:.3f} ms\n", rdp_time.count() / 1e6);
+    fmt::print("RDRAM hash: {:016x}\n", hash);
+
+    if (argc >= 3)
+    {
+        std::ofstream dump(argv[2], std::ios::binary);
+        dump.write(reinterpret_cast<const char*>(rdram.data()), rdram.size());
+    }
+    return 0;
+}
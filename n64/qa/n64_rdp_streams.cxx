@@ -0,0 +1,599 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <n64/qa/n64_angrylion_replayer.hxx>
+#include <n64/qa/n64_rdp_streams.hxx>
+
+namespace
+{
+    using namespace hydra::N64;
+
+    constexpr size_t stream_rdram_size = 0x800000;
+
+    uint64_t with_id(uint64_t full, RDPCommandType id)
+    {
+        return full | (static_cast<uint64_t>(id) << 56);
+    }
+
+    template <class Memory, class Command>
+    void run_records(const RDPStream& stream, Memory&& memory, Command&& command)
+    {
+        for (const auto& record : stream.records)
+        {
+            if (record.type == RDPCaptureRecordType::Memory)
+            {
+                memory(record.address, record.bytes);
+                continue;
+            }
+
+            for (const auto& words : record.commands)
+            {
+                command(words);
+            }
+        }
+    }
+} // namespace
+
+namespace hydra::N64
+{
+    bool RDPStream::Load(const std::string& path)
+    {
+        RDPCaptureReader reader;
+        if (!reader.Open(path))
+        {
+            return false;
+        }
+
+        name = std::filesystem::path(path).stem().string();
+        records.clear();
+        RDPCaptureRecord record;
+        while (reader.Read(record))
+        {
+            records.push_back(std::move(record));
+        }
+        return true;
+    }
+
+    bool RDPStream::Save(const std::string& path) const
+    {
+        RDPCaptureWriter writer(stream_rdram_size);
+        if (!writer.Open(path))
+        {
+            return false;
+        }
+
+        // The writer stores changes against what it has written so far, so give it the memory
+        // as it is at each record
+        std::vector<uint8_t> rdram(stream_rdram_size);
+        run_records(
+            *this,
+            [&](uint32_t address, const std::vector<uint8_t>& bytes) {
+                size_t size = std::min(bytes.size(), rdram.size() - address);
+                std::copy_n(bytes.begin(), size, rdram.begin() + address);
+                writer.WriteMemory(rdram.data(), address, size);
+            },
+            [&](const std::vector<uint64_t>& words) { writer.WriteCommand(words); });
+        writer.EndCommandList();
+        return true;
+    }
+
+    std::vector<uint8_t> RenderStream(const RDPStream& stream)
+    {
+        std::vector<uint8_t> rdram(stream_rdram_size);
+        MIInterrupt mi_interrupt;
+        auto rdp = std::make_unique<RDP>();
+        rdp->InstallBuses(rdram.data(), nullptr);
+        rdp->SetMIPtr(&mi_interrupt);
+        rdp->Reset();
+
+        run_records(
+            stream,
+            [&](uint32_t address, const std::vector<uint8_t>& bytes) {
+                std::copy_n(bytes.begin(), std::min(bytes.size(), rdram.size() - address),
+                            rdram.begin() + address);
+            },
+            [&](const std::vector<uint64_t>& words) { rdp->SendCommand(words); });
+        return rdram;
+    }
+
+    std::vector<uint8_t> RenderStreamAngrylion(const RDPStream& stream)
+    {
+        AngrylionReplayer::Init();
+        run_records(
+            stream,
+            [](uint32_t address, const std::vector<uint8_t>& bytes) {
+                AngrylionReplayer::WriteMemory(address, bytes.data(), bytes.size());
+            },
+            [](const std::vector<uint64_t>& words) { AngrylionReplayer::RunCommand(words); });
+
+        std::vector<uint8_t> rdram(stream_rdram_size);
+        AngrylionReplayer::ReadMemory(0, rdram.data(), rdram.size());
+        AngrylionReplayer::Cleanup();
+        return rdram;
+    }
+
+    RDPColorImage GetColorImage(const RDPStream& stream, const std::vector<uint8_t>& rdram)
+    {
+        SetColorImageCommand color_image;
+        SetScissorCommand scissor;
+        for (const auto& record : stream.records)
+        {
+            for (const auto& words : record.commands)
+            {
+                switch (static_cast<RDPCommandType>((words[0] >> 56) & 0b111111))
+                {
+                    case RDPCommandType::SetColorImage:
+                        color_image.full = words[0];
+                        break;
+                    case RDPCommandType::SetScissor:
+                        scissor.full = words[0];
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
+        RDPColorImage image;
+        int pixel_size = color_image.size == 3 ? 4 : 2;
+        image.width = color_image.width + 1;
+        image.height = scissor.YL >> 2;
+        size_t end = color_image.dram_address +
+                     static_cast<size_t>(image.width) * image.height * pixel_size;
+        if (end > rdram.size())
+        {
+            image.height = 0;
+        }
+
+        image.rgba.resize(static_cast<size_t>(image.width) * image.height * 4);
+        for (size_t i = 0; i < image.rgba.size() / 4; i++)
+        {
+            const uint8_t* pixel = &rdram[color_image.dram_address + i * pixel_size];
+            uint8_t* rgba = &image.rgba[i * 4];
+            if (pixel_size == 4)
+            {
+                std::copy_n(pixel, 4, rgba);
+                continue;
+            }
+
+            // RGBA5551, with the upper bits repeated in the lower ones
+            uint16_t color = (pixel[0] << 8) | pixel[1];
+            auto expand = [](uint8_t value) { return (value << 3) | (value >> 2); };
+            rgba[0] = expand((color >> 11) & 0x1F);
+            rgba[1] = expand((color >> 6) & 0x1F);
+            rgba[2] = expand((color >> 1) & 0x1F);
+            rgba[3] = (color & 1) ? 0xFF : 0;
+        }
+        return image;
+    }
+
+    RDPStreamBuilder::RDPStreamBuilder(std::string name, uint32_t seed, int pixel_size)
+        : rng_(seed), pixel_size_(pixel_size)
+    {
+        stream_.name = std::move(name);
+
+        // A 64x64 RGBA16 texture of noise
+        RDPCaptureRecord texture;
+        texture.type = RDPCaptureRecordType::Memory;
+        texture.address = texture_address;
+        texture.bytes.resize(64 * 64 * 2);
+        std::generate(texture.bytes.begin(), texture.bytes.end(), std::ref(rng_));
+        stream_.records.push_back(std::move(texture));
+
+        commands_.type = RDPCaptureRecordType::Commands;
+
+        // The reference renderer keeps TMEM and tiles from previous streams, so start from
+        // zeroed ones
+        SetTextureImageCommand zero_image;
+        zero_image.DRAMAddress = zero_address;
+        zero_image.size = 2;
+        Add({with_id(zero_image.full, RDPCommandType::SetTextureImage)});
+        SetTileCommand zero_tile;
+        zero_tile.Tile = 7;
+        zero_tile.size = 2;
+        Add({with_id(zero_tile.full, RDPCommandType::SetTile)});
+        // 2048 RGBA16 texels fill all 4 KiB of TMEM
+        LoadBlockCommand load_block;
+        load_block.tile = 7;
+        load_block.SH = 2047;
+        Add({with_id(load_block.full, RDPCommandType::LoadBlock)});
+        for (int i = 0; i < 8; i++)
+        {
+            SetTileCommand tile;
+            tile.Tile = i;
+            Add({with_id(tile.full, RDPCommandType::SetTile)});
+            SetTileSizeCommand tile_size;
+            tile_size.Tile = i;
+            Add({with_id(tile_size.full, RDPCommandType::SetTileSize)});
+        }
+
+        SetColorImageCommand color_image;
+        color_image.dram_address = color_address;
+        color_image.width = screen_width - 1;
+        color_image.size = pixel_size == 16 ? 2 : 3;
+        Add({with_id(color_image.full, RDPCommandType::SetColorImage)});
+        Add({with_id(depth_address, RDPCommandType::SetZImage)});
+
+        SetScissorCommand scissor;
+        scissor.XL = screen_width << 2;
+        scissor.YL = screen_height << 2;
+        Add({with_id(scissor.full, RDPCommandType::SetScissor)});
+
+        SetTextureImageCommand texture_image;
+        texture_image.DRAMAddress = texture_address;
+        texture_image.width = 63;
+        texture_image.size = 2;
+        Add({with_id(texture_image.full, RDPCommandType::SetTextureImage)});
+
+        // 32x32 texels of it, repeating
+        SetTileCommand tile;
+        tile.size = 2;
+        tile.Line = 8;
+        tile.MaskS = 5;
+        tile.MaskT = 5;
+        Add({with_id(tile.full, RDPCommandType::SetTile)});
+        LoadTile(0, 0);
+
+        for (auto id : {RDPCommandType::SetPrimitiveColor, RDPCommandType::SetEnvironmentColor,
+                        RDPCommandType::SetBlendColor, RDPCommandType::SetFogColor})
+        {
+            Add({with_id(rng_(), id)});
+        }
+
+        // The rest of the state carries over from previous streams too. 1-cycle shaded
+        // primitives without depth, everything else zero
+        OtherModes(0, false);
+        CombineMode(15, 15, 31, 4, 7, 7, 7, 4);
+        for (auto id : {RDPCommandType::SetFillColor, RDPCommandType::SetPrimDepth,
+                        RDPCommandType::SetKeyGB, RDPCommandType::SetKeyR,
+                        RDPCommandType::SetConvert})
+        {
+            Add({with_id(0, id)});
+        }
+    }
+
+    void RDPStreamBuilder::Add(std::vector<uint64_t> command)
+    {
+        commands_.commands.push_back(std::move(command));
+    }
+
+    void RDPStreamBuilder::LoadTile(int s, int t)
+    {
+        LoadTileCommand load_tile;
+        load_tile.SL = s << 2;
+        load_tile.TL = t << 2;
+        load_tile.SH = (s + 31) << 2;
+        load_tile.TH = (t + 31) << 2;
+        Add({with_id(load_tile.full, RDPCommandType::LoadTile)});
+    }
+
+    void RDPStreamBuilder::OtherModes(int cycle_type, bool depth)
+    {
+        SetOtherModesCommand other_modes;
+        other_modes.cycle_type = cycle_type;
+        other_modes.z_compare_en = depth;
+        other_modes.z_update_en = depth;
+        Add({with_id(other_modes.full, RDPCommandType::SetOtherModes)});
+    }
+
+    void RDPStreamBuilder::CombineMode(int a, int b, int c, int d, int alpha_a, int alpha_b,
+                                       int alpha_c, int alpha_d)
+    {
+        // Both cycles get the same inputs, the core resolves the first cycle's too and zeroes
+        // there would select inputs it doesn't implement, such as the LOD fraction
+        SetCombineModeCommand command;
+        command.sub_A_RGB_0 = command.sub_A_RGB_1 = a;
+        command.sub_B_RGB_0 = command.sub_B_RGB_1 = b;
+        command.mul_RGB_0 = command.mul_RGB_1 = c;
+        command.add_RGB_0 = command.add_RGB_1 = d;
+        command.sub_A_Alpha_0 = command.sub_A_Alpha_1 = alpha_a;
+        command.sub_B_Alpha_0 = command.sub_B_Alpha_1 = alpha_b;
+        command.mul_Alpha_0 = command.mul_Alpha_1 = alpha_c;
+        command.add_Alpha_0 = command.add_Alpha_1 = alpha_d;
+        Add({with_id(command.full, RDPCommandType::SetCombineMode)});
+    }
+
+    void RDPStreamBuilder::Triangle(RDPCommandType id, int radius, int tile)
+    {
+        struct Vertex
+        {
+            double x, y;
+            std::array<double, 4> shade;
+            std::array<double, 3> texture;
+            double z;
+        };
+
+        std::array<Vertex, 3> v;
+        double area = 0;
+        do
+        {
+            int cx = Random(0, screen_width - 1), cy = Random(0, screen_height - 1);
+            for (auto& vertex : v)
+            {
+                vertex.x = cx + Random(-radius, radius);
+                vertex.y = cy + Random(-radius, radius);
+                for (auto& channel : vertex.shade)
+                {
+                    channel = Random(0, 255);
+                }
+                // S and T in 10.5 texel coordinates, W only used with perspective correction
+                vertex.texture = {Random(0, 64 * 32) * 1.0, Random(0, 64 * 32) * 1.0,
+                                  Random(1, 0x7FFF) * 1.0};
+                vertex.z = Random(0, 0x7FFF);
+            }
+            std::sort(v.begin(), v.end(), [](auto& a, auto& b) { return a.y < b.y; });
+            area =
+                (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+        } while (area == 0 || v[0].y == v[2].y);
+
+        auto fixed = [](double value) { return static_cast<int32_t>(std::lround(value * 65536)); };
+        auto slope = [](const Vertex& a, const Vertex& b) {
+            return b.y == a.y ? 0.0 : (b.x - a.x) / (b.y - a.y);
+        };
+        double slope_h = slope(v[0], v[2]);
+        double slope_m = slope(v[0], v[1]);
+        double slope_l = slope(v[1], v[2]);
+
+        EdgeCoefficientsCommand edges;
+        edges.YH = static_cast<int>(v[0].y) << 2;
+        edges.YM = static_cast<int>(v[1].y) << 2;
+        edges.YL = static_cast<int>(v[2].y) << 2;
+        edges.tile = tile;
+        // Set when the major edge is on the left
+        edges.lft = v[0].x + slope_h * (v[1].y - v[0].y) <= v[1].x;
+        std::vector<uint64_t> triangle = {with_id(edges.full, id)};
+        auto edge = [&](double x, double dxdy) {
+            return (static_cast<uint64_t>(fixed(x) & 0x0FFF'FFFF) << 32) |
+                   (fixed(dxdy) & 0x3FFF'FFFF);
+        };
+        triangle.push_back(edge(v[1].x, slope_l));
+        triangle.push_back(edge(v[0].x, slope_h));
+        triangle.push_back(edge(v[0].x, slope_m));
+
+        // Gradients of the plane through the three vertex values
+        auto gradients = [&](auto value) {
+            double d1 = value(v[1]) - value(v[0]), d2 = value(v[2]) - value(v[0]);
+            double dx = (d1 * (v[2].y - v[0].y) - d2 * (v[1].y - v[0].y)) / area;
+            double dy = (d2 * (v[1].x - v[0].x) - d1 * (v[2].x - v[0].x)) / area;
+            return std::array<int32_t, 4>{fixed(value(v[0])), fixed(dx), fixed(dy + dx * slope_h),
+                                          fixed(dy)};
+        };
+
+        // Start, DxDx, DxDe and DxDy of four attributes, split in integer and fractional halves
+        auto attributes = [&](const std::array<std::array<int32_t, 4>, 4>& values) {
+            auto word = [&](int which, bool integer) {
+                uint64_t result = 0;
+                for (const auto& attribute : values)
+                {
+                    uint16_t half = integer ? attribute[which] >> 16 : attribute[which];
+                    result = (result << 16) | half;
+                }
+                return result;
+            };
+            triangle.insert(triangle.end(), {word(0, true), word(1, true), word(0, false),
+                                             word(1, false), word(2, true), word(3, true),
+                                             word(2, false), word(3, false)});
+        };
+
+        uint8_t type = static_cast<uint8_t>(id);
+        if (type & 0b100)
+        {
+            std::array<std::array<int32_t, 4>, 4> shade;
+            for (int i = 0; i < 4; i++)
+            {
+                shade[i] = gradients([i](const Vertex& vertex) { return vertex.shade[i]; });
+            }
+            attributes(shade);
+        }
+        if (type & 0b010)
+        {
+            std::array<std::array<int32_t, 4>, 4> texture = {};
+            for (int i = 0; i < 3; i++)
+            {
+                texture[i] = gradients([i](const Vertex& vertex) { return vertex.texture[i]; });
+            }
+            attributes(texture);
+        }
+        if (type & 0b001)
+        {
+            auto z = gradients([](const Vertex& vertex) { return vertex.z; });
+            triangle.push_back((static_cast<uint64_t>(static_cast<uint32_t>(z[0])) << 32) |
+                               static_cast<uint32_t>(z[1]));
+            triangle.push_back((static_cast<uint64_t>(static_cast<uint32_t>(z[2])) << 32) |
+                               static_cast<uint32_t>(z[3]));
+        }
+        Add(std::move(triangle));
+    }
+
+    void RDPStreamBuilder::Rectangle(RDPCommandType id, int max_size, int16_t dsdx, int16_t dtdy,
+                                     int tile)
+    {
+        RectangleCommand rectangle;
+        rectangle.xh = Random(0, screen_width - 1) << 2;
+        rectangle.yh = Random(0, screen_height - 1) << 2;
+        rectangle.xl = rectangle.xh + (Random(1, max_size) << 2);
+        rectangle.yl = rectangle.yh + (Random(1, max_size) << 2);
+        rectangle.tile = tile;
+        std::vector<uint64_t> command = {with_id(rectangle.full, id)};
+        if (id != RDPCommandType::Rectangle)
+        {
+            command.push_back((static_cast<uint64_t>(Random(0, 31 << 5)) << 48) |
+                              (static_cast<uint64_t>(Random(0, 31 << 5)) << 32) |
+                              (static_cast<uint64_t>(static_cast<uint16_t>(dsdx)) << 16) |
+                              static_cast<uint16_t>(dtdy));
+        }
+        Add(std::move(command));
+    }
+
+    void RDPStreamBuilder::RandomState()
+    {
+        auto random_bits = [this](int bits) {
+            uint64_t value = (static_cast<uint64_t>(rng_()) << 32) | rng_();
+            return value & ((1ull << bits) - 1);
+        };
+
+        switch (Random(0, 6))
+        {
+            case 0:
+            {
+                // Every cycle type, blender input, coverage and depth mode the RDP accepts. Fill
+                // mode can't read the color or depth image or write depth, and copy mode can't
+                // write 32-bit pixels, the hardware hangs on these
+                SetOtherModesCommand other_modes;
+                other_modes.full = random_bits(56);
+                if (other_modes.cycle_type == 2 && pixel_size_ == 32)
+                {
+                    other_modes.cycle_type = Random(0, 1);
+                }
+                if (other_modes.cycle_type == 3)
+                {
+                    other_modes.image_read_en = 0;
+                    other_modes.z_compare_en = 0;
+                    other_modes.z_update_en = 0;
+                }
+                Add({with_id(other_modes.full, RDPCommandType::SetOtherModes)});
+                break;
+            }
+            case 1:
+            {
+                // Any combiner input, except the key and LOD ones that the RDP core doesn't
+                // implement. The ones past the last listed input all select zero
+                constexpr uint8_t color_sub_b[] = {0, 1, 2, 3, 4, 5, 8};
+                constexpr uint8_t color_mul[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 10, 11, 12, 16};
+                constexpr uint8_t alpha_mul[] = {1, 2, 3, 4, 5, 7};
+                auto pick = [this](const auto& inputs) {
+                    return inputs[Random(0, static_cast<int32_t>(std::size(inputs)) - 1)];
+                };
+
+                SetCombineModeCommand combine_mode;
+                combine_mode.full = random_bits(56);
+                combine_mode.sub_B_RGB_0 = pick(color_sub_b);
+                combine_mode.sub_B_RGB_1 = pick(color_sub_b);
+                combine_mode.mul_RGB_0 = pick(color_mul);
+                combine_mode.mul_RGB_1 = pick(color_mul);
+                combine_mode.mul_Alpha_0 = pick(alpha_mul);
+                combine_mode.mul_Alpha_1 = pick(alpha_mul);
+                Add({with_id(combine_mode.full, RDPCommandType::SetCombineMode)});
+                break;
+            }
+            case 2:
+            {
+                constexpr RDPCommandType colors[] = {
+                    RDPCommandType::SetPrimitiveColor, RDPCommandType::SetEnvironmentColor,
+                    RDPCommandType::SetBlendColor, RDPCommandType::SetFogColor,
+                    RDPCommandType::SetFillColor};
+                auto id = colors[Random(0, static_cast<int32_t>(std::size(colors)) - 1)];
+                Add({with_id(random_bits(32), id)});
+                break;
+            }
+            case 3:
+            {
+                Add({with_id(random_bits(32), RDPCommandType::SetPrimDepth)});
+                break;
+            }
+            case 4:
+            {
+                // Any format and size, reading the noise texture with a different pitch. Loads
+                // of 4-bit images hang the hardware
+                SetTextureImageCommand texture_image;
+                texture_image.DRAMAddress = texture_address;
+                texture_image.width = Random(7, 63);
+                texture_image.size = Random(1, 3);
+                texture_image.format = Random(0, 4);
+                Add({with_id(texture_image.full, RDPCommandType::SetTextureImage)});
+                break;
+            }
+            case 5:
+            {
+                SetTileCommand tile;
+                tile.full = random_bits(24);
+                tile.Tile = Random(0, 7);
+                tile.TMemAddress = Random(0, 511);
+                tile.Line = Random(1, 16);
+                tile.MaskS = Random(0, 6);
+                tile.MaskT = Random(0, 6);
+                tile.size = Random(0, 3);
+                tile.format = Random(0, 4);
+                Add({with_id(tile.full, RDPCommandType::SetTile)});
+
+                SetTileSizeCommand tile_size;
+                tile_size.Tile = tile.Tile;
+                tile_size.SL = Random(0, 63 << 2);
+                tile_size.TL = Random(0, 63 << 2);
+                tile_size.SH = tile_size.SL + Random(0, 63 << 2);
+                tile_size.TH = tile_size.TL + Random(0, 63 << 2);
+                Add({with_id(tile_size.full, RDPCommandType::SetTileSize)});
+                break;
+            }
+            case 6:
+            {
+                // Small loads, so they stay within TMEM and the texture
+                LoadTileCommand load;
+                load.tile = Random(0, 7);
+                switch (Random(0, 2))
+                {
+                    case 0:
+                    {
+                        load.SL = Random(0, 48) << 2;
+                        load.TL = Random(0, 48) << 2;
+                        load.SH = load.SL + (Random(0, 15) << 2);
+                        load.TH = load.TL + (Random(0, 15) << 2);
+                        Add({with_id(load.full, RDPCommandType::LoadTile)});
+                        break;
+                    }
+                    case 1:
+                    {
+                        LoadBlockCommand load_block;
+                        load_block.full = load.full;
+                        load_block.SH = Random(0, 511);
+                        load_block.DxT = Random(0, 0xFFF);
+                        Add({with_id(load_block.full, RDPCommandType::LoadBlock)});
+                        break;
+                    }
+                    case 2:
+                    {
+                        load.SH = Random(0, 255) << 2;
+                        Add({with_id(load.full, RDPCommandType::LoadTLUT)});
+                        break;
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    void RDPStreamBuilder::RandomPrimitive()
+    {
+        switch (Random(0, 2))
+        {
+            case 0:
+            {
+                Triangle(static_cast<RDPCommandType>(Random(0x08, 0x0F)), Random(4, 64),
+                         Random(0, 7));
+                break;
+            }
+            case 1:
+            {
+                Rectangle(RDPCommandType::Rectangle, 64, 0, 0);
+                break;
+            }
+            case 2:
+            {
+                auto id = Random(0, 1) ? RDPCommandType::TextureRectangle
+                                       : RDPCommandType::TextureRectangleFlip;
+                Rectangle(id, 64, Random(-0x1000, 0x1000), Random(-0x1000, 0x1000),
+                          Random(0, 7));
+                break;
+            }
+        }
+    }
+
+    RDPStream RDPStreamBuilder::Build()
+    {
+        stream_.records.push_back(std::move(commands_));
+        return std::move(stream_);
+    }
+} // namespace hydra::N64
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <n64/core/n64_rdp.hxx>
+#include <n64/core/n64_rdp_capture.hxx>
+#include <n64/core/n64_rdp_commands.hxx>
+#include <random>
+#include <string>
+#include <vector>
+
+// Command streams for the RDP QA tools: generated ones, captures, and renders of both
+
+namespace hydra::N64
+{
+    // A sequence of capture records, see n64_rdp_capture.hxx
+    struct RDPStream
+    {
+        std::string name;
+        std::vector<RDPCaptureRecord> records;
+
+        bool Load(const std::string& path);
+        bool Save(const std::string& path) const;
+    };
+
+    struct RDPColorImage
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> rgba;
+    };
+
+    // Renders the stream from a reset RDP and zeroed RDRAM, returns the RDRAM
+    std::vector<uint8_t> RenderStream(const RDPStream& stream);
+    std::vector<uint8_t> RenderStreamAngrylion(const RDPStream& stream);
+
+    // The last color image the stream set, down to the lower edge of the last scissor box
+    RDPColorImage GetColorImage(const RDPStream& stream, const std::vector<uint8_t>& rdram);
+
+    class RDPStreamBuilder
+    {
+    public:
+        static constexpr uint32_t color_address = 0x100000;
+        static constexpr uint32_t depth_address = 0x200000;
+        static constexpr uint32_t texture_address = 0x300000;
+        // Never written, loaded to clear TMEM
+        static constexpr uint32_t zero_address = 0x400000;
+        static constexpr int screen_width = 320;
+        static constexpr int screen_height = 240;
+
+        // Sets up a color image, a depth image, a 64x64 texture of noise and 32x32 RGBA16 texels
+        // of it in tile 0. TMEM and the other tiles are cleared
+        RDPStreamBuilder(std::string name, uint32_t seed, int pixel_size = 16);
+
+        void Add(std::vector<uint64_t> command);
+        void LoadTile(int s, int t);
+        void OtherModes(int cycle_type, bool depth);
+        // (a - b) * c + d for color and alpha, 1-cycle
+        void CombineMode(int a, int b, int c, int d, int alpha_a, int alpha_b, int alpha_c,
+                         int alpha_d);
+        // A triangle around a random point, with attributes interpolated from random vertex
+        // values the way a microcode would set them up
+        void Triangle(RDPCommandType id, int radius, int tile = 0);
+        // DsDx and DtDy in s5.10
+        void Rectangle(RDPCommandType id, int max_size, int16_t dsdx, int16_t dtdy,
+                       int tile = 0);
+
+        // Any state command with random but valid arguments: modes, colors, tiles and loads
+        void RandomState();
+        // Any triangle or rectangle
+        void RandomPrimitive();
+
+        int32_t Random(int32_t min, int32_t max)
+        {
+            return std::uniform_int_distribution<int32_t>(min, max)(rng_);
+        }
+
+        RDPStream Build();
+
+    private:
+        std::mt19937 rng_;
+        int pixel_size_;
+        RDPStream stream_;
+        RDPCaptureRecord commands_;
+    };
+} // namespace hydra::N64
@@ -12,6 +12,13 @@ namespace hydra::NES
         void Tick();
         void Reset();
 
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("EAPU", 1);
+            ar(should_tick_, clock_, sq1_timer_);
+        }
+
     private:
         void invalidate(uint8_t addr, uint8_t data);
         inline void tick_impl();
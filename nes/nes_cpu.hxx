@@ -27,6 +27,13 @@ namespace hydra::NES
         void HandleKeyUp(uint32_t key);
         void SetKeys(std::unordered_map<uint32_t, Button> keys);
 
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("ECPU", 1);
+            ar(A, X, Y, SP, P, PC, cycles_, fetched_, was_prefetched_, nmi_queued_, data_, addr_);
+        }
+
     private:
         CPUBus& bus_;
         inline void delay(uint8_t i);
@@ -41,6 +41,14 @@ namespace hydra::NES
         bool LoadCartridge(std::string path);
         void Reset();
 
+        // The fast map only points into RAM and PRG ROM, which stay where they are
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("EBUS", 1);
+            ar(ram_, last_read_, joypad1_, joypad2_);
+        }
+
     private:
         uint8_t read(uint16_t addr);
         inline uint8_t redirect_address_r(uint16_t addr);
@@ -94,6 +94,7 @@ namespace hydra::NES
                 // crt_demodulate(&crt, noise);
                 field ^= 1;
                 std::swap(screen_color_data_, screen_color_data_second_);
+                frame_finished_ = true;
             }
             if (nmi_output_)
             {
@@ -529,10 +530,13 @@ namespace hydra::NES
                 blue = 255;
             }
         }
-        screen_color_data_second_.at(pixel) = red;
-        screen_color_data_second_.at(pixel + 1) = green;
-        screen_color_data_second_.at(pixel + 2) = blue;
-        screen_color_data_second_.at(pixel + 3) = 255;
+        if (presenting_)
+        {
+            screen_color_data_second_.at(pixel) = red;
+            screen_color_data_second_.at(pixel + 1) = green;
+            screen_color_data_second_.at(pixel + 2) = blue;
+            screen_color_data_second_.at(pixel + 3) = 255;
+        }
         cur_x_++;
         piso_bg_low_ <<= 1;
         piso_bg_high_ <<= 1;
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <functional>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 namespace hydra::NES
@@ -28,6 +29,34 @@ namespace hydra::NES
         uint8_t* GetScreenData();
         void SetNMI(std::function<void()> func);
 
+        // Whether a frame was finished since the last call
+        bool TakeFrameFinished()
+        {
+            return std::exchange(frame_finished_, false);
+        }
+
+        // Frames that are never shown are emulated without writing their pixels
+        void SetPresenting(bool presenting)
+        {
+            presenting_ = presenting;
+        }
+
+        // The palette and grid overlays are settings, CHR is saved as it may be RAM
+        template <class Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Section("EPPU", 1);
+            ar(ppu_ctrl_, ppu_mask_, ppu_status_, oam_addr_, oam_data_, ppu_data_, oam_dma_,
+               open_bus_, vram_addr_latch_, vram_addr_, scanline_, scanline_cycle_, pixel_cycle_,
+               nt_latch_, at_latch_, pt_low_latch_, pt_high_latch_, piso_bg_low_, piso_bg_high_,
+               piso_at_, nt_addr_, cur_y_, cur_x_, fetch_x_, fetch_y_, fine_x_);
+            ar(vram_incr_vertical_, sprite_pattern_address_, background_pattern_address_,
+               sprite_size_, ppu_master_, nmi_output_, write_toggle_, vram_, screen_color_data_,
+               screen_color_data_second_, oam_, secondary_oam_, sprite_shift_registers_,
+               attribute_latches_, sprite_counters_, sprite_active_, scanline_sprite_count_,
+               background_palettes_, sprite_palettes_, chr_rom_, master_clock_dbg_);
+        }
+
     private:
         uint8_t ppu_ctrl_ = 0, ppu_mask_ = 0, ppu_status_ = 0, oam_addr_ = 0, oam_data_ = 0,
                 ppu_data_ = 0, oam_dma_ = 0;
@@ -76,6 +105,8 @@ namespace hydra::NES
         bool draw_tile_grid_ = false;
         bool draw_metatile_grid_ = false;
         bool draw_attribute_grid_ = false;
+        bool frame_finished_ = false;
+        bool presenting_ = true;
         using Palettes = std::array<std::array<std::array<uint8_t, 3>, 4>, 4>;
         Palettes background_palettes_{};
         Palettes sprite_palettes_{};
@@ -1,6 +1,7 @@
 #include "nes_tkpwrapper.hxx"
 #include <emulator_settings.hxx>
 #include <log.hxx>
+#include <state.hxx>
 
 namespace hydra::NES
 {
@@ -8,6 +9,8 @@ namespace hydra::NES
     {
         using hydra::NES::Button;
         instrs_per_frame_ = 1789773 / 60;
+        // A frame is 89342 dots at three dots a CPU cycle, one less every other frame
+        frame_rate_ = 1789773.0 * 3 / 89341.5;
         ppu_.SetNMI(std::bind(&CPU::NMI, &cpu_));
         KeyMappings& mappings = EmulatorSettings::GetEmulatorData(EmuType::NES).Mappings;
         std::unordered_map<uint32_t, Button> keymap;
@@ -34,12 +37,12 @@ namespace hydra::NES
 
     NES_TKPWrapper::~NES_TKPWrapper() {}
 
-    void NES_TKPWrapper::HandleKeyDown(uint32_t key)
+    void NES_TKPWrapper::handle_key_down(uint32_t key)
     {
         cpu_.HandleKeyDown(key);
     }
 
-    void NES_TKPWrapper::HandleKeyUp(uint32_t key)
+    void NES_TKPWrapper::handle_key_up(uint32_t key)
     {
         cpu_.HandleKeyUp(key);
     }
@@ -55,21 +58,42 @@ namespace hydra::NES
         cpu_.Reset();
     }
 
+    bool NES_TKPWrapper::save_state(StateWriter& writer)
+    {
+        writer(cpubus_, ppu_, apu_, cpu_);
+        return true;
+    }
+
+    bool NES_TKPWrapper::load_state(StateReader& reader)
+    {
+        reader(cpubus_, ppu_, apu_, cpu_);
+        return true;
+    }
+
     void NES_TKPWrapper::update()
     {
-        static int ticks = 0;
-        ticks++;
         cpu_.Tick();
-        if (ticks > instrs_per_frame_)
+        if (ppu_.TakeFrameFinished())
+        {
+            end_frame();
+        }
+    }
+
+    void NES_TKPWrapper::set_presenting(bool presenting)
+    {
+        ppu_.SetPresenting(presenting);
+    }
+
+    // Frames are paced here, outside of DataMutex, and never on the run-ahead instance as it's
+    // only ever updated directly
+    void NES_TKPWrapper::wait_for_next_frame()
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start_frame_time_;
+        if (elapsed < std::chrono::milliseconds(16))
         {
-            auto elapsed = std::chrono::high_resolution_clock::now() - start_frame_time_;
-            if (elapsed < std::chrono::milliseconds(16))
-            {
-                std::this_thread::sleep_for(std::chrono::milliseconds(16) - elapsed);
-            }
-            start_frame_time_ = std::chrono::high_resolution_clock::now();
-            ticks = 0;
+            std::this_thread::sleep_for(std::chrono::milliseconds(16) - elapsed);
         }
+        start_frame_time_ = std::chrono::steady_clock::now();
     }
 
     bool NES_TKPWrapper::load_file(const std::string& path)
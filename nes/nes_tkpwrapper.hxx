@@ -17,7 +17,11 @@ namespace hydra::NES
         APU apu_{};
         CPUBus cpubus_{ppu_, apu_};
         CPU cpu_{cpubus_, Paused};
+        bool save_state(StateWriter& writer) override;
+        bool load_state(StateReader& reader) override;
+        void wait_for_next_frame() override;
+        void set_presenting(bool presenting) override;
 
-        std::chrono::time_point<std::chrono::high_resolution_clock> start_frame_time_{};
+        std::chrono::steady_clock::time_point start_frame_time_{};
     };
 } // namespace hydra::NES
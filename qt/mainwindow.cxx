@@ -4,6 +4,7 @@
 #include "qthelper.hxx"
 #include "settingswindow.hxx"
 #include "shadereditor.hxx"
+#include <algorithm>
 #include <emulator_settings.hxx>
 #include <error_factory.hxx>
 #include <iostream>
@@ -35,6 +36,8 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent), tools_{}, tools_o
     create_menus();
     QString message = tr("A context menu is available by right-clicking");
     statusBar()->showMessage(message);
+    frame_time_label_ = new QLabel(this);
+    statusBar()->addPermanentWidget(frame_time_label_);
     setMinimumSize(160, 160);
     resize(640, 480);
     setWindowTitle("hydra");
@@ -43,6 +46,9 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent), tools_{}, tools_o
     QTimer* timer = new QTimer(this);
     timer->start(16);
     connect(timer, SIGNAL(timeout()), this, SLOT(redraw_screen()));
+    QTimer* frame_time_timer = new QTimer(this);
+    frame_time_timer->start(500);
+    connect(frame_time_timer, SIGNAL(timeout()), this, SLOT(show_frame_time()));
     enable_emulation_actions(false);
     screen_->SetMouseMoveCallback([this](QMouseEvent* event) { on_mouse_move(event); });
     screen_->setMouseTracking(true);
@@ -95,6 +101,24 @@ void MainWindow::create_actions()
     shaders_act_->setStatusTip("Open the shader editor");
     shaders_act_->setIcon(QIcon(":/images/shaders.png"));
     connect(shaders_act_, &QAction::triggered, this, &MainWindow::open_shaders);
+    QActionGroup* run_ahead_group = new QActionGroup(this);
+    for (int i = 0; i < static_cast<int>(run_ahead_acts_.size()); i++)
+    {
+        run_ahead_acts_[i] = new QAction(i == 0   ? tr("&Off")
+                                         : i == 1 ? tr("&1 frame")
+                                                  : tr("&%1 frames").arg(i),
+                                         this);
+        run_ahead_acts_[i]->setCheckable(true);
+        run_ahead_acts_[i]->setStatusTip(tr("Show frames early to hide the game's input lag"));
+        run_ahead_group->addAction(run_ahead_acts_[i]);
+        connect(run_ahead_acts_[i], &QAction::triggered, this, [this, i] { set_run_ahead(i); });
+    }
+    int run_ahead = 0;
+    if (EmulatorSettings::GetGeneralSettings().Has("run_ahead"))
+    {
+        run_ahead = std::stoi(EmulatorSettings::GetGeneralSettings().Get("run_ahead"));
+    }
+    run_ahead_acts_[std::clamp<int>(run_ahead, 0, run_ahead_acts_.size() - 1)]->setChecked(true);
     tools_actions_[ET_Debugger] = new QAction(tr("&Debugger"), this);
     tools_actions_[ET_Debugger]->setShortcut(Qt::Key_F2);
     tools_actions_[ET_Debugger]->setStatusTip("Open the debugger");
@@ -127,6 +151,12 @@ void MainWindow::create_menus()
     emulation_menu_->addAction(pause_act_);
     emulation_menu_->addAction(reset_act_);
     emulation_menu_->addAction(stop_act_);
+    emulation_menu_->addSeparator();
+    QMenu* run_ahead_menu = emulation_menu_->addMenu(tr("Run &ahead"));
+    for (QAction* action : run_ahead_acts_)
+    {
+        run_ahead_menu->addAction(action);
+    }
     tools_menu_ = menuBar()->addMenu(tr("&Tools"));
     tools_menu_->addAction(shaders_act_);
     tools_menu_->addSeparator();
@@ -224,6 +254,8 @@ void MainWindow::open_file_impl(const std::string& path)
     }
     if (!emulator_->LoadFromFile(path))
         throw ErrorFactory::generate_exception(__func__, __LINE__, "Failed to open ROM");
+    emulator_type_ = type;
+    apply_run_ahead();
     screen_->setMinimumSize(emulator_->GetWidth(), emulator_->GetHeight());
     screen_->InitializeTexture(emulator_->GetWidth(), emulator_->GetHeight(), GL_UNSIGNED_BYTE,
                                emulator_->GetScreenData());
@@ -232,7 +264,6 @@ void MainWindow::open_file_impl(const std::string& path)
     auto func = [&]() { emulator_->Start(); };
     emulator_thread_ = std::thread(func);
     emulator_thread_.detach();
-    emulator_type_ = type;
     enable_emulation_actions(true);
     for (size_t i = 0; i < tools_.size(); i++)
     {
@@ -511,6 +542,48 @@ void MainWindow::stop_emulator()
     screen_->hide();
 }
 
+void MainWindow::set_run_ahead(int frames)
+{
+    EmulatorSettings::GetGeneralSettings().Set("run_ahead", std::to_string(frames));
+    apply_run_ahead();
+}
+
+void MainWindow::apply_run_ahead()
+{
+    if (!emulator_)
+    {
+        return;
+    }
+    int frames = 0;
+    for (int i = 0; i < static_cast<int>(run_ahead_acts_.size()); i++)
+    {
+        if (run_ahead_acts_[i]->isChecked())
+        {
+            frames = i;
+        }
+    }
+    auto instance = frames ? hydra::EmulatorFactory::Create(emulator_type_) : nullptr;
+    if (!emulator_->SetRunAhead(frames, std::move(instance)))
+    {
+        run_ahead_acts_[0]->setChecked(true);
+    }
+}
+
+void MainWindow::show_frame_time()
+{
+    if (!emulator_ || emulator_->Paused)
+    {
+        frame_time_label_->clear();
+        return;
+    }
+    QString text = tr("Frame: %1 ms").arg(emulator_->GetFrameTime(), 0, 'f', 1);
+    if (emulator_->GetRunAhead())
+    {
+        text += tr(" (run ahead: %1 ms)").arg(emulator_->GetRunAheadTime(), 0, 'f', 1);
+    }
+    frame_time_label_->setText(text);
+}
+
 void MainWindow::redraw_screen()
 {
     if (!emulator_)
@@ -522,10 +595,28 @@ void MainWindow::redraw_screen()
     {
         return;
     }
-    screen_->Redraw(emulator_->GetWidth(), emulator_->GetHeight(), GL_UNSIGNED_BYTE,
-                    emulator_->GetScreenData());
-    screen_->update();
     emulator_->IsReadyToDraw() = false;
+    // The run-ahead instance is only touched under the lock of the emulator that owns it
+    std::shared_ptr<hydra::Emulator> run_ahead = emulator_->GetRunAhead();
+    hydra::Emulator& presented = run_ahead ? *run_ahead : *emulator_;
+    // Static frames such as menus and pause screens don't need an upload at all
+    auto [first_row, rows] = presented.TakeDirtyRows();
+    if (rows == 0)
+    {
+        return;
+    }
+    int width = presented.GetWidth();
+    int height = presented.GetHeight();
+    int row_length = presented.GetScreenRowLength();
+    bool rgba5551 = presented.GetScreenFormat() == hydra::Emulator::ScreenFormat::RGBA5551;
+    // Frames that were handed over are converted without holding up the emulation thread
+    if (presented.HandsOverScreenData())
+    {
+        lock.unlock();
+    }
+    screen_->Redraw(width, height, rgba5551 ? GL_UNSIGNED_SHORT_5_5_5_1 : GL_UNSIGNED_BYTE,
+                    presented.GetScreenData(), first_row, rows, row_length);
+    screen_->update();
 }
 
 void MainWindow::empty_screen()
@@ -6,6 +6,7 @@
 #include <emulator_factory.hxx>
 #include <emulator_tool_factory.hxx>
 #include <memory>
+#include <QActionGroup>
 #include <QFileDialog>
 #include <QLabel>
 #include <QMainWindow>
@@ -42,9 +43,13 @@ private:
     void enable_emulation_actions(bool should);
     void setup_emulator_specific();
     void empty_screen();
+    // Runs `frames` frames ahead, saved in the general settings and applied to every game
+    void set_run_ahead(int frames);
+    void apply_run_ahead();
 
 private slots:
     void redraw_screen();
+    void show_frame_time();
     void on_mouse_move(QMouseEvent* event);
 
 public:
@@ -63,6 +68,9 @@ public:
     QAction* settings_act_;
     QAction* screenshot_act_;
     QAction* shaders_act_;
+    // Off, then one entry per frame of run-ahead
+    std::array<QAction*, 4> run_ahead_acts_;
+    QLabel* frame_time_label_;
     ScreenWidget* screen_;
     std::shared_ptr<hydra::Emulator> emulator_;
     hydra::EmuType emulator_type_;
@@ -39,24 +39,39 @@ void ScreenWidget::InitializeTexture(int width, int height, int bitdepth, void*
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glBindTexture(GL_TEXTURE_2D, 0);
+    texture_width_ = width;
+    texture_height_ = height;
     initialized_ = true;
 }
 
-void ScreenWidget::Redraw(int width, int height, int bitdepth, void* tdata)
+void ScreenWidget::Redraw(int width, int height, int bitdepth, void* tdata, int first_row,
+                          int rows, int row_length)
 {
     if (initialized_) [[likely]]
     {
-        if (bitdepth == GL_UNSIGNED_SHORT_5_5_5_1)
-        { // n64 (TODO: make a bool in this function that sets this)
-            glPixelStorei(GL_UNPACK_SWAP_BYTES, 1);
-        }
+        // 16-bit pixels come straight from emulated memory, which holds them in host byte
+        // order, with rows that can be wider than the screen
+        int pixel_bytes = bitdepth == GL_UNSIGNED_SHORT_5_5_5_1 ? 2 : 4;
+        row_length = row_length ? row_length : width;
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, pixel_bytes);
         glBindTexture(GL_TEXTURE_2D, texture_);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, bitdepth, tdata);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        if (bitdepth == GL_UNSIGNED_SHORT_5_5_5_1)
+        bool same_size = width == texture_width_ && height == texture_height_;
+        if (same_size && rows >= 0 && first_row >= 0 && first_row + rows <= height)
         {
-            glPixelStorei(GL_UNPACK_SWAP_BYTES, 0);
+            uint8_t* first = static_cast<uint8_t*>(tdata) + first_row * row_length * pixel_bytes;
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first_row, width, rows, GL_RGBA, bitdepth,
+                            first);
         }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, bitdepth, tdata);
+            texture_width_ = width;
+            texture_height_ = height;
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     }
 }
 
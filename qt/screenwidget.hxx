@@ -18,7 +18,10 @@ public:
     ScreenWidget(QWidget* parent = nullptr);
     ~ScreenWidget();
     void InitializeTexture(int width, int height, int bitdepth, void* data);
-    void Redraw(int width, int height, int bitdepth, void* data);
+    // Uploads `rows` rows starting at `first_row`, or all of them if the size changed. Rows of
+    // `data` are `row_length` pixels apart, or `width` if it's 0
+    void Redraw(int width, int height, int bitdepth, void* data, int first_row = 0,
+                int rows = -1, int row_length = 0);
     void ResetProgram(QString* vertex = nullptr, QString* fragment = nullptr);
 
     void SetMouseMoveCallback(std::function<void(QMouseEvent*)> callback)
@@ -39,6 +42,8 @@ private:
     QOpenGLVertexArrayObject vao_;
     QOpenGLBuffer vbo_;
     bool initialized_ = false;
+    int texture_width_ = 0;
+    int texture_height_ = 0;
 
     std::function<void(QMouseEvent*)> mouse_move_callback_;
 
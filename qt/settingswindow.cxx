@@ -4,6 +4,7 @@
 #include <emulator_settings.hxx>
 #include <emulator_types.hxx>
 #include <QCheckBox>
+#include <QComboBox>
 #include <QFileDialog>
 #include <QLabel>
 #include <QPushButton>
@@ -131,6 +132,27 @@ void SettingsWindow::create_tabs()
         n64_layout->addWidget(new QLabel("IPL bios path:"), 0, 0);
         n64_layout->addWidget(ipl_path_, 0, 1);
         n64_layout->addWidget(ipl_pick, 0, 2);
+        auto& n64_data = emu_data(hydra::EmuType::N64);
+        QCheckBox* native_16bit = new QCheckBox("Show 16-bit framebuffers without converting them");
+        native_16bit->setChecked(n64_data.Has("Native16BitFramebuffer") &&
+                                 n64_data.Get("Native16BitFramebuffer") == "true");
+        connect(native_16bit, SIGNAL(stateChanged(int)), this,
+                SLOT(on_n64_native_16bit_click(int)));
+        n64_layout->addWidget(native_16bit, 1, 0, 1, 3);
+        QCheckBox* hle_boot = new QCheckBox("Boot without the IPL");
+        hle_boot->setChecked(n64_data.Has("HLEBoot") && n64_data.Get("HLEBoot") == "true");
+        connect(hle_boot, SIGNAL(stateChanged(int)), this, SLOT(on_n64_hle_boot_click(int)));
+        n64_layout->addWidget(hle_boot, 3, 0, 1, 3);
+        QComboBox* sync_mode = new QComboBox;
+        sync_mode->addItems({"Audio", "Video", "Unthrottled"});
+        if (n64_data.Has("SyncMode"))
+        {
+            sync_mode->setCurrentText(n64_data.Get("SyncMode").c_str());
+        }
+        connect(sync_mode, SIGNAL(currentTextChanged(const QString&)), this,
+                SLOT(on_n64_sync_mode_change(const QString&)));
+        n64_layout->addWidget(new QLabel("Sync to:"), 2, 0);
+        n64_layout->addWidget(sync_mode, 2, 1, 1, 2);
         QWidget* n64_tab = new QWidget;
         n64_tab->setLayout(n64_layout);
         tab_show_->addTab(n64_tab, "N64");
@@ -163,6 +185,23 @@ void SettingsWindow::on_gb_skip_bios_click(int state)
     emu_data(hydra::EmuType::Gameboy).Set("skip_bios", str);
 }
 
+void SettingsWindow::on_n64_native_16bit_click(int state)
+{
+    auto str = (state == Qt::CheckState::Checked) ? "true" : "false";
+    emu_data(hydra::EmuType::N64).Set("Native16BitFramebuffer", str);
+}
+
+void SettingsWindow::on_n64_hle_boot_click(int state)
+{
+    auto str = (state == Qt::CheckState::Checked) ? "true" : "false";
+    emu_data(hydra::EmuType::N64).Set("HLEBoot", str);
+}
+
+void SettingsWindow::on_n64_sync_mode_change(const QString& mode)
+{
+    emu_data(hydra::EmuType::N64).Set("SyncMode", mode.toStdString());
+}
+
 void SettingsWindow::on_ipl_click()
 {
     auto path = QFileDialog::getOpenFileName(this, tr("Open IPL"), "", "Binary files (*.bin)");
@@ -23,6 +23,9 @@ private slots:
     void on_cgb_click();
     void on_ipl_click();
     void on_gb_skip_bios_click(int state);
+    void on_n64_native_16bit_click(int state);
+    void on_n64_hle_boot_click(int state);
+    void on_n64_sync_mode_change(const QString& mode);
 
 public:
     SettingsWindow(bool& open, QWidget* parent = nullptr);
@@ -1,10 +1,12 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <cmath>
 #include <emulator.hxx>
 #include <error_factory.hxx>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <log.hxx>
+#include <state.hxx>
 #include <str_hash.hxx>
 // TODO: add make target for profiling that includes this
 // #include <valgrind/callgrind.h>
@@ -23,20 +25,47 @@ namespace hydra
 
     void Emulator::HandleKeyDown(uint32_t keycode)
     {
-        Logger::WarnOnce("Key {} was pressed but Emulator::HandleKeyDown was not implemented",
-                         keycode);
+        handle_key_down(keycode);
+        if (auto instance = GetRunAhead())
+        {
+            instance->handle_key_down(keycode);
+        }
     }
 
     void Emulator::HandleKeyUp(uint32_t keycode)
     {
-        Logger::WarnOnce("Key {} was released but Emulator::HandleKeyUp was not implemented",
-                         keycode);
+        handle_key_up(keycode);
+        if (auto instance = GetRunAhead())
+        {
+            instance->handle_key_up(keycode);
+        }
     }
 
     void Emulator::HandleMouseMove(int x, int y)
+    {
+        handle_mouse_move(x, y);
+        if (auto instance = GetRunAhead())
+        {
+            instance->handle_mouse_move(x, y);
+        }
+    }
+
+    void Emulator::handle_key_down(uint32_t keycode)
+    {
+        Logger::WarnOnce("Key {} was pressed but Emulator::handle_key_down was not implemented",
+                         keycode);
+    }
+
+    void Emulator::handle_key_up(uint32_t keycode)
+    {
+        Logger::WarnOnce("Key {} was released but Emulator::handle_key_up was not implemented",
+                         keycode);
+    }
+
+    void Emulator::handle_mouse_move(int x, int y)
     {
         Logger::WarnOnce(
-            "Mouse movement was detected but Emulator::HandleMouseMove was not implemented");
+            "Mouse movement was detected but Emulator::handle_mouse_move was not implemented");
     }
 
     void* Emulator::GetScreenData()
@@ -66,15 +95,13 @@ namespace hydra
         do
         {
             std::unique_lock lock(DataMutex);
-            frame_start_ = std::chrono::system_clock::now();
-            for (; cur_instr_ < instrs_per_frame_; cur_instr_++)
+            frame_start_ = std::chrono::steady_clock::now();
+            // A rewound frame is loaded instead of run, so it plays no audio and saves nothing
+            bool rewinding = rewind_.Enabled() && Rewinding.load();
+            for (; cur_instr_ < instrs_per_frame_ && !frame_ended_ && !rewinding; cur_instr_++)
             {
                 update();
             }
-            auto end = std::chrono::system_clock::now();
-            auto dur =
-                std::chrono::duration_cast<std::chrono::milliseconds>(end - frame_start_).count();
-            last_frame_time_ms_ = dur;
             if (Stopped.load())
             {
                 return;
@@ -88,8 +115,22 @@ namespace hydra
                 reset();
                 reset_flag_ = false;
             }
+            if (rewind_.Enabled())
+            {
+                rewind_frame(rewinding);
+            }
+            if (run_ahead_)
+            {
+                run_ahead();
+            }
+            std::chrono::duration<double, std::milli> frame_time =
+                std::chrono::steady_clock::now() - frame_start_;
+            frame_time_ms_.store(frame_time.count(), std::memory_order_relaxed);
             should_draw_ = true;
             cur_instr_ = 0;
+            frame_ended_ = false;
+            lock.unlock();
+            wait_for_next_frame();
         } while (true);
         CALLGRIND_STOP_INSTRUMENTATION;
     paused:
@@ -114,9 +155,145 @@ namespace hydra
 
     bool Emulator::LoadFromFile(std::string path)
     {
+        path_ = path;
         return load_file(path);
     }
 
+    bool Emulator::SaveState(std::vector<uint8_t>& buffer)
+    {
+        std::shared_lock lock(DataMutex);
+        StateWriter writer(buffer);
+        return save_state(writer);
+    }
+
+    bool Emulator::LoadState(std::span<const uint8_t> buffer)
+    {
+        std::unique_lock lock(DataMutex);
+        StateReader reader(buffer);
+        return load_state(reader) && reader.Ok();
+    }
+
+    void Emulator::SetRewindBudget(int seconds, int mebibytes, int interval)
+    {
+        std::unique_lock lock(DataMutex);
+        rewind_interval_ = std::max(interval, 1);
+        rewind_frame_ = 0;
+        auto snapshots = static_cast<size_t>(std::ceil(std::max(seconds, 0) * frame_rate_ /
+                                                       rewind_interval_));
+        rewind_.SetBudget(snapshots, static_cast<size_t>(std::max(mebibytes, 0)) << 20);
+    }
+
+    // Snapshots are saved straight into the staging buffer and encoded by the rewind buffer's
+    // own thread. If it's still busy with the last one this one is skipped rather than waited on
+    void Emulator::rewind_frame(bool rewinding)
+    {
+        if (rewinding)
+        {
+            rewind_frame_ = 0;
+            std::span<const uint8_t> state = rewind_.Newest();
+            if (state.empty())
+            {
+                return;
+            }
+            StateReader reader(state);
+            if (!load_state(reader) || !reader.Ok())
+            {
+                Logger::Warn("Failed to rewind, dropping the rewind history");
+                rewind_.Clear();
+                return;
+            }
+            rewind_.StepBack();
+            return;
+        }
+        if (++rewind_frame_ < rewind_interval_ || !rewind_.Idle())
+        {
+            return;
+        }
+        rewind_frame_ = 0;
+        bool saved;
+        {
+            StateWriter writer(rewind_.Staging());
+            saved = save_state(writer);
+        }
+        if (!saved)
+        {
+            Logger::Warn("This emulator doesn't support save states, rewinding is disabled");
+            rewind_.SetBudget(0, 0);
+            return;
+        }
+        rewind_.Push();
+    }
+
+    bool Emulator::SetRunAhead(int frames, std::shared_ptr<Emulator> instance)
+    {
+        std::unique_lock lock(DataMutex);
+        set_run_ahead(nullptr);
+        run_ahead_frames_ = 0;
+        run_ahead_state_ = {};
+        run_ahead_time_ms_.store(0, std::memory_order_relaxed);
+        if (frames <= 0 || !instance)
+        {
+            return true;
+        }
+        instance->run_ahead_instance_ = true;
+        if (!instance->load_file(path_))
+        {
+            Logger::Warn("Failed to load the run-ahead instance, not running ahead");
+            return false;
+        }
+        instance->reset();
+        set_run_ahead(std::move(instance));
+        run_ahead_frames_ = frames;
+        return true;
+    }
+
+    std::shared_ptr<Emulator> Emulator::GetRunAhead()
+    {
+        std::lock_guard lock(run_ahead_mutex_);
+        return run_ahead_;
+    }
+
+    void Emulator::set_run_ahead(std::shared_ptr<Emulator> instance)
+    {
+        std::lock_guard lock(run_ahead_mutex_);
+        run_ahead_ = std::move(instance);
+    }
+
+    // The run-ahead instance starts every frame from a copy of this one's state, so it never
+    // drifts from it and whatever it mispredicts is thrown away on the next frame
+    void Emulator::run_ahead()
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool copied;
+        {
+            StateWriter writer(run_ahead_state_);
+            copied = save_state(writer);
+        }
+        if (copied)
+        {
+            StateReader reader(run_ahead_state_);
+            copied = run_ahead_->load_state(reader) && reader.Ok();
+        }
+        if (!copied)
+        {
+            Logger::Warn("Failed to copy the state to the run-ahead instance, not running ahead");
+            set_run_ahead(nullptr);
+            return;
+        }
+        run_ahead_->FastMode = FastMode;
+        for (int frame = 0; frame < run_ahead_frames_; frame++)
+        {
+            run_ahead_->set_presenting(frame == run_ahead_frames_ - 1);
+            run_ahead_->frame_ended_ = false;
+            for (int i = 0; i < run_ahead_->instrs_per_frame_ && !run_ahead_->frame_ended_; i++)
+            {
+                run_ahead_->update();
+            }
+        }
+        std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+        run_ahead_time_ms_.store(time.count(), std::memory_order_relaxed);
+    }
+
     void Emulator::Reset()
     {
         reset_flag_ = true;
@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mapped_file.hxx>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace hydra
+{
+    MappedFile::~MappedFile()
+    {
+        Close();
+        stop_thread();
+    }
+
+    // Writes the new contents next to where they go and renames them in place, so a half
+    // written file is never left behind
+    static bool replace_file(const std::string& path, const uint8_t* data, size_t size)
+    {
+        std::string temporary = path + ".tmp";
+#ifdef _WIN32
+        {
+            std::ofstream ofs(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!ofs.write(reinterpret_cast<const char*>(data), size) || !ofs.flush())
+            {
+                return false;
+            }
+        }
+#else
+        int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1)
+        {
+            return false;
+        }
+        size_t written = 0;
+        while (written < size)
+        {
+            ssize_t result = write(fd, data + written, size - written);
+            if (result <= 0)
+            {
+                break;
+            }
+            written += result;
+        }
+        // Renaming before the contents are on disk could leave an empty file after a crash
+        bool flushed = written == size && fsync(fd) == 0;
+        close(fd);
+        if (!flushed)
+        {
+            return false;
+        }
+#endif
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+        if (error)
+        {
+            return false;
+        }
+#ifndef _WIN32
+        // The rename itself only survives a crash once the directory is on disk too
+        std::string directory = std::filesystem::path(path).parent_path().string();
+        int directory_fd =
+            open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (directory_fd != -1)
+        {
+            fsync(directory_fd);
+            close(directory_fd);
+        }
+#endif
+        return true;
+    }
+
+    static bool create_file(const std::string& path, size_t size, uint8_t fill)
+    {
+        std::error_code error;
+        if (std::filesystem::exists(path, error))
+        {
+            return true;
+        }
+        std::vector<uint8_t> contents(size, fill);
+        return replace_file(path, contents.data(), contents.size());
+    }
+
+    bool MappedFile::Open(const std::string& path, size_t alignment)
+    {
+        return open(path, alignment, 0);
+    }
+
+    bool MappedFile::OpenWritable(const std::string& path, size_t size, size_t alignment,
+                                  uint8_t fill)
+    {
+        Close();
+        if (!create_file(path, size, fill) || !open(path, alignment, size))
+        {
+            return false;
+        }
+        size_ = std::max(size_, size);
+        path_ = path;
+        return true;
+    }
+
+    bool MappedFile::Sync()
+    {
+        if (path_.empty())
+        {
+            return true;
+        }
+        std::unique_lock lock(mutex_);
+        wait_idle(lock);
+        failed_ = !replace_file(path_, data_, size_);
+        return !failed_;
+    }
+
+    void MappedFile::SyncInBackground()
+    {
+        if (path_.empty())
+        {
+            return;
+        }
+        {
+            std::lock_guard lock(mutex_);
+            staging_.assign(data_, data_ + size_);
+            staging_path_ = path_;
+            pending_ = true;
+        }
+        if (!thread_.joinable())
+        {
+            thread_ = std::thread(&MappedFile::run, this);
+        }
+        cv_.notify_all();
+    }
+
+    bool MappedFile::SyncFailed()
+    {
+        std::lock_guard lock(mutex_);
+        return failed_;
+    }
+
+    void MappedFile::run()
+    {
+        std::unique_lock lock(mutex_);
+        while (true)
+        {
+            cv_.wait(lock, [this] { return pending_ || stop_; });
+            if (!pending_)
+            {
+                return;
+            }
+            // The next copy can be staged while this one is written
+            std::swap(staging_, writing_buffer_);
+            std::string path = std::move(staging_path_);
+            pending_ = false;
+            writing_ = true;
+            lock.unlock();
+            bool written = replace_file(path, writing_buffer_.data(), writing_buffer_.size());
+            lock.lock();
+            failed_ = !written;
+            writing_ = false;
+            cv_.notify_all();
+        }
+    }
+
+    void MappedFile::stop_thread()
+    {
+        if (!thread_.joinable())
+        {
+            return;
+        }
+        {
+            std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+        stop_ = false;
+    }
+
+    void MappedFile::wait_idle(std::unique_lock<std::mutex>& lock)
+    {
+        cv_.wait(lock, [this] { return !pending_ && !writing_; });
+    }
+
+#ifdef _WIN32
+    bool MappedFile::open(const std::string& path, size_t alignment, size_t min_size)
+    {
+        Close();
+        std::ifstream ifs(path, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!ifs.is_open())
+        {
+            return false;
+        }
+        size_t size = ifs.tellg();
+        ifs.seekg(0, std::ios::beg);
+        contents_.resize((std::max(size, min_size) + alignment - 1) / alignment * alignment);
+        ifs.read(reinterpret_cast<char*>(contents_.data()), size);
+        data_ = contents_.data();
+        size_ = size;
+        mapped_size_ = contents_.size();
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        {
+            std::unique_lock lock(mutex_);
+            wait_idle(lock);
+            failed_ = false;
+        }
+        contents_ = {};
+        path_.clear();
+        data_ = nullptr;
+        size_ = mapped_size_ = 0;
+    }
+#else
+    // Maps `size` bytes of the file into a zeroed, private region of at least `min_size` bytes
+    // rounded up to the alignment
+    static bool map_file(int fd, size_t size, size_t min_size, size_t alignment, uint8_t*& data,
+                         size_t& mapped_size)
+    {
+        mapped_size = (std::max(size, min_size) + alignment - 1) / alignment * alignment;
+        // The padding is reserved first and the file mapped over it, touching the padding past
+        // the last page of the file then reads zeroes instead of raising SIGBUS
+        void* base = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+        {
+            return false;
+        }
+        if (size != 0 &&
+            mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+        {
+            munmap(base, mapped_size);
+            return false;
+        }
+        data = static_cast<uint8_t*>(base);
+        return true;
+    }
+
+    bool MappedFile::open(const std::string& path, size_t alignment, size_t min_size)
+    {
+        Close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+        {
+            return false;
+        }
+        struct stat st;
+        bool mapped = fstat(fd, &st) == 0 && (st.st_size != 0 || min_size != 0) &&
+                      map_file(fd, st.st_size, min_size, alignment, data_, mapped_size_);
+        close(fd);
+        size_ = mapped ? st.st_size : 0;
+        return mapped;
+    }
+
+    void MappedFile::Close()
+    {
+        {
+            std::unique_lock lock(mutex_);
+            wait_idle(lock);
+            failed_ = false;
+        }
+        if (data_)
+        {
+            munmap(data_, mapped_size_);
+        }
+        path_.clear();
+        data_ = nullptr;
+        size_ = mapped_size_ = 0;
+    }
+#endif
+} // namespace hydra
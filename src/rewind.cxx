@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <compatibility.hxx>
+#include <cstring>
+#include <rewind.hxx>
+
+namespace
+{
+    // Deltas start with the sizes of the two states, then alternate between a run of bytes that
+    // are the same in both and a run of literal bytes XORed together:
+    //   uint64_t previous_size, current_size
+    //   { uint32_t same, literal; uint8_t xored[literal]; } ...
+    struct DeltaHeader
+    {
+        uint64_t previous_size;
+        uint64_t current_size;
+    };
+
+    struct DeltaRun
+    {
+        uint32_t same;
+        uint32_t literal;
+    };
+
+    constexpr size_t BLOCK_SIZE = 16;
+
+    hydra_inline bool block_same(const uint8_t* a, const uint8_t* b)
+    {
+#ifdef __x86_64__
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) == 0xFFFF;
+#else
+        return std::memcmp(a, b, BLOCK_SIZE) == 0;
+#endif
+    }
+
+    void xor_bytes(uint8_t* dst, const uint8_t* a, const uint8_t* b, size_t size)
+    {
+        size_t i = 0;
+#ifdef __x86_64__
+        for (; i + BLOCK_SIZE <= size; i += BLOCK_SIZE)
+        {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(va, vb));
+        }
+#endif
+        for (; i < size; i++)
+        {
+            dst[i] = a[i] ^ b[i];
+        }
+    }
+
+    size_t skip_same(const uint8_t* a, const uint8_t* b, size_t i, size_t size)
+    {
+        while (i + BLOCK_SIZE <= size && block_same(a + i, b + i))
+        {
+            i += BLOCK_SIZE;
+        }
+        while (i < size && a[i] == b[i])
+        {
+            i++;
+        }
+        return i;
+    }
+
+    // Literal runs only end at a whole block that's the same in both, shorter gaps cost less
+    // to keep in the run than to start a new one
+    size_t skip_different(const uint8_t* a, const uint8_t* b, size_t i, size_t size)
+    {
+        while (i + BLOCK_SIZE <= size && !block_same(a + i, b + i))
+        {
+            i += BLOCK_SIZE;
+        }
+        return i + BLOCK_SIZE > size ? size : i;
+    }
+
+    template <class T>
+    void append(std::vector<uint8_t>& buffer, const T& value)
+    {
+        size_t offset = buffer.size();
+        buffer.resize(offset + sizeof(T));
+        std::memcpy(buffer.data() + offset, &value, sizeof(T));
+    }
+
+    // Appends a run whose literal bytes are a ^ b
+    void append_run(std::vector<uint8_t>& delta, size_t same, const uint8_t* a, const uint8_t* b,
+                    size_t literal)
+    {
+        append(delta, DeltaRun{static_cast<uint32_t>(same), static_cast<uint32_t>(literal)});
+        size_t offset = delta.size();
+        delta.resize(offset + literal);
+        xor_bytes(delta.data() + offset, a, b, literal);
+    }
+} // namespace
+
+namespace hydra
+{
+    RewindBuffer::~RewindBuffer()
+    {
+        SetBudget(0, 0);
+    }
+
+    void RewindBuffer::SetBudget(size_t max_snapshots, size_t bytes)
+    {
+        if (thread_.joinable())
+        {
+            {
+                std::unique_lock lock(mutex_);
+                wait_idle(lock);
+                stop_ = true;
+            }
+            cv_.notify_all();
+            thread_.join();
+            stop_ = false;
+        }
+        entries_.clear();
+        newest_ = {};
+        staging_ = {};
+        delta_ = {};
+        ring_ = {};
+        max_snapshots_ = bytes != 0 ? max_snapshots : 0;
+        if (max_snapshots_ != 0)
+        {
+            ring_.resize(bytes);
+            thread_ = std::thread(&RewindBuffer::run, this);
+        }
+    }
+
+    void RewindBuffer::Clear()
+    {
+        std::unique_lock lock(mutex_);
+        wait_idle(lock);
+        entries_.clear();
+        newest_.clear();
+    }
+
+    bool RewindBuffer::Idle()
+    {
+        std::lock_guard lock(mutex_);
+        return job_ == Job::None;
+    }
+
+    void RewindBuffer::Push()
+    {
+        start_job(Job::Push);
+    }
+
+    std::span<const uint8_t> RewindBuffer::Newest()
+    {
+        std::unique_lock lock(mutex_);
+        wait_idle(lock);
+        return newest_;
+    }
+
+    void RewindBuffer::StepBack()
+    {
+        {
+            std::unique_lock lock(mutex_);
+            wait_idle(lock);
+            if (entries_.empty())
+            {
+                return;
+            }
+        }
+        start_job(Job::StepBack);
+    }
+
+    size_t RewindBuffer::Snapshots()
+    {
+        std::unique_lock lock(mutex_);
+        wait_idle(lock);
+        return newest_.empty() ? 0 : entries_.size() + 1;
+    }
+
+    void RewindBuffer::EncodeDelta(std::span<const uint8_t> previous,
+                                   std::span<const uint8_t> current, std::vector<uint8_t>& delta)
+    {
+        delta.clear();
+        append(delta, DeltaHeader{previous.size(), current.size()});
+        const uint8_t* a = previous.data();
+        const uint8_t* b = current.data();
+        size_t common = std::min(previous.size(), current.size());
+        // End of the last literal run, the next run counts the bytes that are the same from it
+        size_t run_end = 0;
+        size_t i = 0;
+        while (i < common)
+        {
+            i = skip_same(a, b, i, common);
+            size_t literal_start = i;
+            i = skip_different(a, b, i, common);
+            if (i != literal_start)
+            {
+                append_run(delta, literal_start - run_end, a + literal_start, b + literal_start,
+                           i - literal_start);
+                run_end = i;
+            }
+        }
+        // Past the end of the shorter state its bytes count as zeroes
+        std::span<const uint8_t> longer = previous.size() > common ? previous : current;
+        if (longer.size() > common)
+        {
+            const uint8_t* tail = longer.data() + common;
+            size_t size = longer.size() - common;
+            append(delta, DeltaRun{static_cast<uint32_t>(common - run_end),
+                                   static_cast<uint32_t>(size)});
+            delta.insert(delta.end(), tail, tail + size);
+        }
+    }
+
+    bool RewindBuffer::ApplyDelta(std::span<const uint8_t> delta, std::vector<uint8_t>& state)
+    {
+        DeltaHeader header;
+        if (delta.size() < sizeof(header))
+        {
+            return false;
+        }
+        std::memcpy(&header, delta.data(), sizeof(header));
+        if (header.current_size != state.size())
+        {
+            return false;
+        }
+        state.resize(std::max(header.previous_size, header.current_size));
+        size_t offset = sizeof(header);
+        size_t position = 0;
+        while (offset + sizeof(DeltaRun) <= delta.size())
+        {
+            DeltaRun run;
+            std::memcpy(&run, delta.data() + offset, sizeof(run));
+            offset += sizeof(run);
+            position += run.same;
+            if (position + run.literal > state.size() || offset + run.literal > delta.size())
+            {
+                return false;
+            }
+            uint8_t* bytes = state.data() + position;
+            xor_bytes(bytes, bytes, delta.data() + offset, run.literal);
+            offset += run.literal;
+            position += run.literal;
+        }
+        state.resize(header.previous_size);
+        return offset == delta.size();
+    }
+
+    void RewindBuffer::run()
+    {
+        std::unique_lock lock(mutex_);
+        while (true)
+        {
+            cv_.wait(lock, [this] { return job_ != Job::None || stop_; });
+            if (stop_)
+            {
+                return;
+            }
+            Job job = job_;
+            lock.unlock();
+            if (job == Job::Push)
+            {
+                push();
+            }
+            else
+            {
+                step_back();
+            }
+            lock.lock();
+            job_ = Job::None;
+            cv_.notify_all();
+        }
+    }
+
+    void RewindBuffer::push()
+    {
+        if (newest_.empty())
+        {
+            std::swap(newest_, staging_);
+            return;
+        }
+        EncodeDelta(newest_, staging_, delta_);
+        std::swap(newest_, staging_);
+        size_t size = delta_.size();
+        if (size > ring_.size())
+        {
+            // Doesn't fit even alone, the history can't go back past the new state anymore
+            entries_.clear();
+            return;
+        }
+        size_t end = entries_.empty() ? 0 : entries_.back().offset + entries_.back().size;
+        size_t offset = end;
+        if (offset + size > ring_.size())
+        {
+            offset = 0;
+            // Deltas between the end of the newest one and the end of the ring are the oldest
+            while (!entries_.empty() && entries_.front().offset >= end)
+            {
+                entries_.pop_front();
+            }
+        }
+        while (!entries_.empty() && entries_.front().offset < offset + size &&
+               offset < entries_.front().offset + entries_.front().size)
+        {
+            entries_.pop_front();
+        }
+        std::memcpy(ring_.data() + offset, delta_.data(), size);
+        entries_.push_back({offset, size});
+        // The newest state counts as a snapshot too
+        while (entries_.size() >= max_snapshots_)
+        {
+            entries_.pop_front();
+        }
+    }
+
+    void RewindBuffer::step_back()
+    {
+        const Entry& entry = entries_.back();
+        if (!ApplyDelta(std::span(ring_).subspan(entry.offset, entry.size), newest_))
+        {
+            // The states after this one can't be rebuilt from it either
+            entries_.clear();
+            newest_.clear();
+            return;
+        }
+        entries_.pop_back();
+    }
+
+    void RewindBuffer::start_job(Job job)
+    {
+        {
+            std::lock_guard lock(mutex_);
+            job_ = job;
+        }
+        cv_.notify_all();
+    }
+
+    void RewindBuffer::wait_idle(std::unique_lock<std::mutex>& lock)
+    {
+        cv_.wait(lock, [this] { return job_ == Job::None; });
+    }
+} // namespace hydra